@@ -9,9 +9,13 @@
  */
 #include "adc.h"
 
+#include <stddef.h>
+#include <stdint.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
 
 #include "../../mrubyc/src/mrubyc.h"
+#include "../app/profiler.h"
 #include "../drv/adc.h"
 #include "../lib/fn.h"
 #include "api.h"
@@ -19,11 +23,27 @@
 
 LOG_MODULE_REGISTER(api_adc, LOG_LEVEL_DBG);
 
+/**
+ * @brief Maximum number of samples returned by one ADC.read_block call
+ */
+#define API_ADC_BLOCK_MAX 64U
+
+/**
+ * @brief Maximum number of channels written by ADC.read_mv_all
+ */
+#define API_ADC_CHANNEL_MAX 8U
+
 /**
  * @brief Forward declarations for ADC methods
  */
 static void c_update_adc(mrb_vm *vm, mrb_value *v, int argc);
 static void c_get_adc(mrb_vm *vm, mrb_value *v, int argc);
+static void c_get_mv_adc(mrb_vm *vm, mrb_value *v, int argc);
+static void c_get_mv_all_adc(mrb_vm *vm, mrb_value *v, int argc);
+static void c_start_adc(mrb_vm *vm, mrb_value *v, int argc);
+static void c_stop_adc(mrb_vm *vm, mrb_value *v, int argc);
+static void c_read_block_adc(mrb_vm *vm, mrb_value *v, int argc);
+static void c_window_adc(mrb_vm *vm, mrb_value *v, int argc);
 
 /**
  * @brief Defines the ADC class and methods for mruby/c
@@ -35,6 +55,12 @@ fn_t api_adc_define(void) {
   class_adc = mrbc_define_class(0, "ADC", mrbc_class_object);
   mrbc_define_method(0, class_adc, "update!", c_update_adc);
   mrbc_define_method(0, class_adc, "read", c_get_adc);
+  mrbc_define_method(0, class_adc, "read_mv", c_get_mv_adc);
+  mrbc_define_method(0, class_adc, "read_mv_all", c_get_mv_all_adc);
+  mrbc_define_method(0, class_adc, "start", c_start_adc);
+  mrbc_define_method(0, class_adc, "stop", c_stop_adc);
+  mrbc_define_method(0, class_adc, "read_block", c_read_block_adc);
+  mrbc_define_method(0, class_adc, "window", c_window_adc);
   return kSuccess;
 }
 
@@ -46,6 +72,7 @@ fn_t api_adc_define(void) {
  * @param argc The argument count
  */
 static void c_update_adc(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Adc);
   if (kSuccess == drv_adc_update()) {
     SET_TRUE_RETURN();
   } else {
@@ -61,8 +88,136 @@ static void c_update_adc(mrb_vm *vm, mrb_value *v, int argc) {
  * @param argc The argument count
  */
 static void c_get_adc(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Adc);
   SET_FLOAT_RETURN(0.0f);
   if (true == MRBC_ISNUMERIC(v[1])) {
     SET_FLOAT_RETURN((float)(drv_adc_get(GET_INT_ARG(1))) / 1000);
   }
 }
+
+/**
+ * @brief Gets the current ADC reading in millivolts (Integer, no Float boxing)
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_get_mv_adc(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Adc);
+  SET_INT_RETURN(-1);
+  if (true == MRBC_ISNUMERIC(v[1])) {
+    SET_INT_RETURN(drv_adc_get((uint8_t)GET_INT_ARG(1)));
+  }
+}
+
+/**
+ * @brief Writes the readings of all channels (mV) into an existing Array
+ *
+ * @details Only the elements the Array already holds are overwritten, so no
+ * memory is allocated. Returns the number of elements written.
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_get_mv_all_adc(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Adc);
+  int32_t mv[API_ADC_CHANNEL_MAX] = {0};
+  SET_INT_RETURN(0);
+
+  if ((1 > argc) || (MRBC_TT_ARRAY != v[1].tt)) {
+    return;
+  }
+  const size_t kStored = (size_t)v[1].array->n_stored;
+  const size_t kNum = drv_adc_get_all(mv, MIN(kStored, API_ADC_CHANNEL_MAX));
+  for (size_t i = 0U; i < kNum; i++) {
+    mrb_value value = mrbc_integer_value(mv[i]);
+    mrbc_array_set(&v[1], (int)i, &value);
+  }
+  SET_INT_RETURN((mrbc_int_t)kNum);
+}
+
+/**
+ * @brief Starts the background acquisition of all channels
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_start_adc(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Adc);
+  SET_FALSE_RETURN();
+  if ((1 <= argc) && (MRBC_TT_INTEGER == v[1].tt) && (0 < GET_INT_ARG(1))) {
+    if (kSuccess == drv_adc_start((uint32_t)GET_INT_ARG(1))) {
+      SET_TRUE_RETURN();
+    }
+  }
+}
+
+/**
+ * @brief Stops the background acquisition
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_stop_adc(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Adc);
+  if (kSuccess == drv_adc_stop()) {
+    SET_TRUE_RETURN();
+  } else {
+    SET_FALSE_RETURN();
+  }
+}
+
+/**
+ * @brief Drains up to n samples (mV) of a channel from the acquisition ring
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_read_block_adc(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Adc);
+  int32_t samples[API_ADC_BLOCK_MAX] = {0};
+  size_t count = 0U;
+
+  if ((2 <= argc) && (true == MRBC_ISNUMERIC(v[1])) &&
+      (MRBC_TT_INTEGER == v[2].tt) && (0 < GET_INT_ARG(2))) {
+    const size_t kRequest = MIN((size_t)GET_INT_ARG(2), API_ADC_BLOCK_MAX);
+    count = drv_adc_read_block((uint8_t)GET_INT_ARG(1), samples, kRequest);
+  }
+
+  mrb_value ret = mrbc_array_new(vm, (int)count);
+  for (size_t i = 0U; i < count; i++) {
+    mrb_value sample = mrbc_integer_value(samples[i]);
+    mrbc_array_set(&ret, (int)i, &sample);
+  }
+  SET_RETURN(ret);
+}
+
+/**
+ * @brief Gets the last [min, max, mean] window (mV) of a channel
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_window_adc(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Adc);
+  drv_adc_window_t window = {0};
+  SET_NIL_RETURN();
+
+  if ((1 > argc) || (false == MRBC_ISNUMERIC(v[1])) ||
+      (kSuccess != drv_adc_get_window((uint8_t)GET_INT_ARG(1), &window))) {
+    return;
+  }
+
+  mrb_value ret = mrbc_array_new(vm, 3);
+  const int32_t kValues[3] = {window.min, window.max, window.mean};
+  for (int i = 0; i < 3; i++) {
+    mrb_value value = mrbc_integer_value(kValues[i]);
+    mrbc_array_set(&ret, i, &value);
+  }
+  SET_RETURN(ret);
+}
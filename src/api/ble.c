@@ -11,6 +11,7 @@
 
 #include "../../mrubyc/src/mrubyc.h"
 #include "../app/comm.h"
+#include "../app/profiler.h"
 #include "../lib/fn.h"
 
 /**
@@ -47,6 +48,7 @@ fn_t api_ble_define(void) {
  * @param argc The argument count
  */
 static void c_get_ble(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Ble);
   enum {
     kOff = 0,         /**< BLE is off */
     kAdvertising = 1, /**< BLE is advertising */
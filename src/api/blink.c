@@ -9,11 +9,15 @@
  */
 #include "blink.h"
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "../../mrubyc/src/mrubyc.h"
 #include "../app/mrubyc_vm.h"
+#include "../app/profiler.h"
+#include "../app/sampler.h"
+#include "../app/task_monitor.h"
 #include "../lib/fn.h"
-static bool watchdog_enable[MAX_VM_COUNT];
-static bool watchdog_feed[MAX_VM_COUNT];
 
 /**
  * @brief Forward declaration for reload status getter method
@@ -24,6 +28,42 @@ static bool watchdog_feed[MAX_VM_COUNT];
  */
 static void c_get_reload(mrb_vm *vm, mrb_value *v, int argc);
 
+/**
+ * @brief Forward declaration for run time budget setter method
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_set_cpu_budget(mrb_vm *vm, mrb_value *v, int argc);
+
+/**
+ * @brief Forward declaration for profiler statistics getter method
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_get_stats(mrb_vm *vm, mrb_value *v, int argc);
+
+/**
+ * @brief Forward declaration for sampler histogram print method
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_dump_samples(mrb_vm *vm, mrb_value *v, int argc);
+
+/**
+ * @brief Forward declaration for heap statistics getter method
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_get_heap(mrb_vm *vm, mrb_value *v, int argc);
+
 /**
  * @brief Sample method for string handling
  *
@@ -69,6 +109,10 @@ fn_t api_blink_define(void) {
   mrb_class *class_blink;
   class_blink = mrbc_define_class(0, "Blink", mrbc_class_object);
   mrbc_define_method(0, class_blink, "req_reload?", c_get_reload);
+  mrbc_define_method(0, class_blink, "cpu_budget", c_set_cpu_budget);
+  mrbc_define_method(0, class_blink, "stats", c_get_stats);
+  mrbc_define_method(0, class_blink, "dump_samples", c_dump_samples);
+  mrbc_define_method(0, class_blink, "heap", c_get_heap);
   mrbc_define_method(0, class_blink, "sample_string", c_sample_string);
   mrbc_define_method(0, class_blink, "sample_array", c_sample_array);
   mrbc_define_method(0, class_blink, "sample_array2", c_sample_array2);
@@ -84,6 +128,7 @@ fn_t api_blink_define(void) {
  * @param argc The argument count
  */
 static void c_sample_string(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Blink);
   char tmp_char[255];
   size_t tmp_size = 0;
 
@@ -107,6 +152,7 @@ static void c_sample_string(mrb_vm *vm, mrb_value *v, int argc) {
  * @param argc The argument count
  */
 static void c_sample_array(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Blink);
   uint8_t array[3] = {0};
   if (MRBC_TT_ARRAY == v[1].tt) {
     if (3 != v[1].array->n_stored) return;
@@ -124,6 +170,7 @@ static void c_sample_array(mrb_vm *vm, mrb_value *v, int argc) {
  * @param argc The argument count
  */
 static void c_sample_array2(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Blink);
   uint8_t c_array[3] = {0};
   if (MRBC_TT_ARRAY == v[1].tt) {
     if (3 == v[1].array->n_stored) {
@@ -144,6 +191,7 @@ static void c_sample_array2(mrb_vm *vm, mrb_value *v, int argc) {
  * @param argc The argument count
  */
 static void c_sample_array3(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Blink);
   float tmp[3] = {0.0f, 1.0f, 3.14f};
   mrb_value ret = mrbc_array_new(vm, 3);
 
@@ -163,42 +211,162 @@ static void c_sample_array3(mrb_vm *vm, mrb_value *v, int argc) {
  * @param argc The argument count
  */
 static void c_get_reload(mrb_vm *vm, mrb_value *v, int argc) {
-  const uint8_t kVmId = (vm->vm_id - 1);
-  if (MAX_VM_COUNT > kVmId) {
-    watchdog_feed[kVmId] = true;
-    watchdog_enable[kVmId] = true;
-  }
+  PROFILER_SCOPE(Blink);
   SET_BOOL_RETURN(app_mrubyc_vm_get_reload());
 }
 
 /**
- * @brief Initializes the Blink subsystem
+ * @brief Sets the run time budget of the calling slot task
  *
- * @return fn_t kSuccess if successful, kFailure otherwise
+ * @details Blink.cpu_budget(ms); 0 removes the limit. Returns false for tasks
+ * created with Task.create, which are not monitored.
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
  */
-fn_t api_blink_init(void) {
-  for (size_t i = 0; i < MAX_VM_COUNT; i++) {
-    watchdog_enable[i] = false;
-    watchdog_feed[i] = true;
+static void c_set_cpu_budget(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Blink);
+  SET_FALSE_RETURN();
+  if ((1 > argc) || (MRBC_TT_INTEGER != v[1].tt) || (0 > v[1].i)) {
+    return;
   }
-  return kSuccess;
+  if (kSuccess == task_monitor_set_budget(MRBC_VM2TCB(vm), (uint32_t)v[1].i)) {
+    SET_TRUE_RETURN();
+  }
+}
+
+/**
+ * @brief Sets a value in a hash under a symbol key
+ *
+ * @param hash The hash
+ * @param kKey Key name
+ * @param value Value (ownership moves to the hash)
+ */
+static void blink_hash_set(mrb_value *const hash, const char *const kKey,
+                           mrb_value value) {
+  mrb_value key = mrbc_symbol_value(mrbc_str_to_symid(kKey));
+  mrbc_hash_set(hash, &key, &value);
 }
 
 /**
- * @brief Performs normality check for watchdog functionality
+ * @brief Gets the profiler statistics
+ *
+ * @details Returns nil unless built with CONFIG_OPENBLINK_PROFILER
  *
- * @return fn_t kSuccess if all VMs are responding, kFailure otherwise
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
  */
-fn_t api_blink_normality_check(void) {
-  fn_t ret = kSuccess;
-  for (size_t i = 0; i < MAX_VM_COUNT; i++) {
-    if (true == watchdog_enable[i]) {
-      if (true == watchdog_feed[i]) {
-        watchdog_feed[i] = false;
-      } else {
-        ret = kFailure;
+static void c_get_stats(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Blink);
+  static const char *const kLabels[] = {
+#define PROFILER_CLASS_LABEL(kName, kLabel) kLabel,
+      PROFILER_CLASSES(PROFILER_CLASS_LABEL)
+#undef PROFILER_CLASS_LABEL
+  };
+  static profiler_stats_t stats;
+  SET_NIL_RETURN();
+  if (kSuccess != profiler_get(&stats)) {
+    return;
+  }
+  mrb_value ret = mrbc_hash_new(vm, 4);
+  mrb_value tasks = mrbc_array_new(vm, MAX_VM_COUNT);
+  blink_hash_set(&ret, "elapsed_ms", mrbc_integer_value(stats.elapsed_ms));
+  blink_hash_set(&ret, "idle_ms", mrbc_integer_value(stats.idle_ms));
+  blink_hash_set(&ret, "overhead_us", mrbc_integer_value(stats.overhead_us));
+  for (size_t i = 0; MAX_VM_COUNT > i; i++) {
+    const profiler_task_stats_t *const kTask = &stats.tasks[i];
+    if (0U == kTask->vm_id) {
+      continue;
+    }
+    mrb_value task = mrbc_hash_new(vm, 6);
+    mrb_value methods = mrbc_hash_new(vm, kProfilerClassNum);
+    blink_hash_set(&task, "id", mrbc_integer_value(kTask->vm_id));
+    blink_hash_set(&task, "run_ms", mrbc_integer_value(kTask->run_ms));
+    blink_hash_set(&task, "dispatches",
+                   mrbc_integer_value(kTask->dispatches));
+    blink_hash_set(&task, "sleep_ms", mrbc_integer_value(kTask->sleep_ms));
+    blink_hash_set(&task, "heap_peak", mrbc_integer_value(kTask->heap_peak));
+    for (size_t j = 0; kProfilerClassNum > j; j++) {
+      if (0U < kTask->method_us[j]) {
+        blink_hash_set(&methods, kLabels[j],
+                       mrbc_integer_value(kTask->method_us[j]));
       }
     }
+    blink_hash_set(&task, "method_us", methods);
+    mrbc_array_push(&tasks, &task);
   }
-  return ret;
+  blink_hash_set(&ret, "tasks", tasks);
+  SET_RETURN(ret);
 }
+
+/**
+ * @brief Prints the sampler histogram to the console
+ *
+ * @details Returns false unless built with CONFIG_OPENBLINK_SAMPLER
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_dump_samples(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Blink);
+  SET_FALSE_RETURN();
+  if (kSuccess == sampler_dump()) {
+    SET_TRUE_RETURN();
+  }
+}
+
+/**
+ * @brief Gets the VM heap statistics
+ *
+ * @details The fragmentation is the share of free memory outside the largest
+ * free block, in percent
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_get_heap(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Blink);
+  mrubyc_vm_heap_stats_t stats;
+  app_mrubyc_vm_heap_update();
+  app_mrubyc_vm_heap_stats(&stats);
+  const uint32_t kFragmentation =
+      (0U < stats.free)
+          ? (100U - (uint32_t)(((uint64_t)stats.largest_free * 100U) /
+                               stats.free))
+          : 0U;
+  mrb_value ret = mrbc_hash_new(vm, 11);
+  mrb_value allocs = mrbc_array_new(vm, MRUBYC_VM_HEAP_CLASSES);
+  mrb_value live = mrbc_array_new(vm, MRUBYC_VM_HEAP_CLASSES);
+  for (size_t i = 0; MRUBYC_VM_HEAP_CLASSES > i; i++) {
+    mrb_value count = mrbc_integer_value(stats.allocs[i]);
+    mrbc_array_push(&allocs, &count);
+    count = mrbc_integer_value(stats.live[i]);
+    mrbc_array_push(&live, &count);
+  }
+  blink_hash_set(&ret, "total", mrbc_integer_value(stats.total));
+  blink_hash_set(&ret, "used", mrbc_integer_value(stats.used));
+  blink_hash_set(&ret, "free", mrbc_integer_value(stats.free));
+  blink_hash_set(&ret, "largest_free", mrbc_integer_value(stats.largest_free));
+  blink_hash_set(&ret, "fragmentation", mrbc_integer_value(kFragmentation));
+  blink_hash_set(&ret, "free_blocks", mrbc_integer_value(stats.free_blocks));
+  blink_hash_set(&ret, "peak", mrbc_integer_value(stats.peak));
+  blink_hash_set(&ret, "allocs", allocs);
+  blink_hash_set(&ret, "live", live);
+  blink_hash_set(&ret, "slab_total", mrbc_integer_value(stats.slab_total));
+  blink_hash_set(&ret, "slab_used", mrbc_integer_value(stats.slab_used));
+  SET_RETURN(ret);
+}
+
+/**
+ * @brief Initializes the Blink subsystem
+ *
+ * @details Starts the task monitor that replaces the Blink.req_reload?
+ * heartbeat of the watchdog
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t api_blink_init(void) { return task_monitor_init(); }
@@ -26,11 +26,4 @@ fn_t api_blink_init(void);
  */
 fn_t api_blink_define(void);
 
-/**
- * @brief Performs normality check for watchdog functionality
- *
- * @return fn_t kSuccess if all VMs are responding, kFailure otherwise
- */
-fn_t api_blink_normality_check(void);
-
 #endif
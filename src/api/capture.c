@@ -0,0 +1,266 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file capture.c
+ * @brief Implementation of Capture API for mruby/c
+ * @details Implements the Capture class and methods for mruby/c scripts. The
+ * measurements are computed from a snapshot of the edge timestamps recorded by
+ * the capture driver, so scripts may call them at any rate.
+ */
+#include "capture.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+#include "../../mrubyc/src/mrubyc.h"
+#include "../app/profiler.h"
+#include "../drv/capture.h"
+#include "../lib/fn.h"
+
+LOG_MODULE_REGISTER(api_capture, LOG_LEVEL_DBG);
+
+/**
+ * @brief Forward declarations for Capture methods
+ */
+static void c_capture_start(mrb_vm *vm, mrb_value *v, int argc);
+static void c_capture_stop(mrb_vm *vm, mrb_value *v, int argc);
+static void c_capture_count(mrb_vm *vm, mrb_value *v, int argc);
+static void c_capture_period(mrb_vm *vm, mrb_value *v, int argc);
+static void c_capture_frequency(mrb_vm *vm, mrb_value *v, int argc);
+static void c_capture_pulse_width(mrb_vm *vm, mrb_value *v, int argc);
+
+/** @brief Snapshot buffer (VM thread only) */
+static drv_capture_snapshot_t snapshot;
+
+/**
+ * @brief Defines the Capture class and methods for mruby/c
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t api_capture_define(void) {
+  mrb_class *class_capture;
+  class_capture = mrbc_define_class(0, "Capture", mrbc_class_object);
+  mrbc_define_method(0, class_capture, "start", c_capture_start);
+  mrbc_define_method(0, class_capture, "stop", c_capture_stop);
+  mrbc_define_method(0, class_capture, "count", c_capture_count);
+  mrbc_define_method(0, class_capture, "period", c_capture_period);
+  mrbc_define_method(0, class_capture, "frequency", c_capture_frequency);
+  mrbc_define_method(0, class_capture, "pulse_width", c_capture_pulse_width);
+  return kSuccess;
+}
+
+/**
+ * @brief Takes a snapshot of the channel given as the first argument
+ *
+ * @param v The value array
+ * @param argc The argument count
+ * @return true if the channel is running
+ */
+static bool capture_snapshot_arg(const mrb_value *const v, const int argc) {
+  if ((1 > argc) || (MRBC_TT_INTEGER != v[1].tt) || (0 > v[1].i) ||
+      (DRV_CAPTURE_CHANNELS <= v[1].i)) {
+    return false;
+  }
+  return (kSuccess == drv_capture_snapshot((uint8_t)v[1].i, &snapshot));
+}
+
+/**
+ * @brief Starts capturing the edges of a pin
+ *
+ * @details Capture.start(channel, pin, edge = :rising, pullup = false); pin is
+ * port * 32 + pin, edge is :rising, :falling or :both
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_capture_start(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Capture);
+  static const char *const kEdges[] = {
+      [kDrvCaptureEdgeRising] = "rising",
+      [kDrvCaptureEdgeFalling] = "falling",
+      [kDrvCaptureEdgeBoth] = "both",
+  };
+  drv_capture_edge_t edge = kDrvCaptureEdgeRising;
+  SET_FALSE_RETURN();
+  if ((2 > argc) || (MRBC_TT_INTEGER != v[1].tt) || (0 > v[1].i) ||
+      (UINT8_MAX < v[1].i) || (MRBC_TT_INTEGER != v[2].tt) ||
+      (0 > v[2].i) || (UINT8_MAX < v[2].i)) {
+    return;
+  }
+  if (3 <= argc) {
+    if (MRBC_TT_SYMBOL != v[3].tt) {
+      return;
+    }
+    const char *const kName = mrbc_symid_to_str(v[3].i);
+    size_t i = 0;
+    while ((ARRAY_SIZE(kEdges) > i) && (0 != strcmp(kEdges[i], kName))) {
+      i++;
+    }
+    if (ARRAY_SIZE(kEdges) <= i) {
+      return;
+    }
+    edge = (drv_capture_edge_t)i;
+  }
+  const bool kPullUp = (4 <= argc) && (MRBC_TT_TRUE == v[4].tt);
+  if (kSuccess ==
+      drv_capture_start((uint8_t)v[1].i, (uint8_t)v[2].i, edge, kPullUp)) {
+    SET_TRUE_RETURN();
+  }
+}
+
+/**
+ * @brief Stops a capture channel
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_capture_stop(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Capture);
+  SET_FALSE_RETURN();
+  if ((1 > argc) || (MRBC_TT_INTEGER != v[1].tt) || (0 > v[1].i) ||
+      (UINT8_MAX < v[1].i)) {
+    return;
+  }
+  if (kSuccess == drv_capture_stop((uint8_t)v[1].i)) {
+    SET_TRUE_RETURN();
+  }
+}
+
+/**
+ * @brief Gets the number of edges since the channel was started
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_capture_count(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Capture);
+  SET_NIL_RETURN();
+  if (true == capture_snapshot_arg(v, argc)) {
+    SET_INT_RETURN((mrbc_int_t)snapshot.count);
+  }
+}
+
+/**
+ * @brief Gets the average period over the recorded edges
+ *
+ * @details Only edges with the same level as the newest one are used, so
+ * :both gives full periods too. Returns microseconds, or nil if fewer than
+ * two such edges are recorded.
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_capture_period(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Capture);
+  SET_NIL_RETURN();
+  if ((false == capture_snapshot_arg(v, argc)) || (0U == snapshot.stored)) {
+    return;
+  }
+  const uint32_t kNewest = snapshot.stored - 1U;
+  uint32_t oldest = kNewest;
+  uint32_t intervals = 0U;
+  for (uint32_t i = 0U; kNewest > i; i++) {
+    if (snapshot.levels[i] == snapshot.levels[kNewest]) {
+      if (0U == intervals) {
+        oldest = i;
+      }
+      intervals++;
+    }
+  }
+  if (0U < intervals) {
+    const uint32_t kSpan =
+        snapshot.timestamps[kNewest] - snapshot.timestamps[oldest];
+    SET_INT_RETURN((mrbc_int_t)(kSpan / intervals));
+  }
+}
+
+/**
+ * @brief Gets the frequency over a time window
+ *
+ * @details Capture.frequency(channel, window_ms = 1000). Counts the edges
+ * with the level of the newest edge inside the window, so the result drops
+ * to 0 when the signal stops. If the ring does not reach back over the whole
+ * window, the average period of the recorded edges is used instead.
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_capture_frequency(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Capture);
+  SET_NIL_RETURN();
+  if ((2 <= argc) && ((MRBC_TT_INTEGER != v[2].tt) || (0 >= v[2].i) ||
+                      ((UINT32_MAX / 1000) < (uint32_t)v[2].i))) {
+    return;
+  }
+  const uint32_t kWindowUs = (2 <= argc) ? ((uint32_t)v[2].i * 1000U)
+                                         : (1000U * 1000U);
+  if (false == capture_snapshot_arg(v, argc)) {
+    return;
+  }
+  SET_FLOAT_RETURN(0.0f);
+  if (0U == snapshot.stored) {
+    return;
+  }
+  const uint8_t kLevel = snapshot.levels[snapshot.stored - 1U];
+  uint32_t edges = 0U;
+  uint32_t oldest = 0U;
+  uint32_t newest = 0U;
+  bool truncated = (snapshot.count > snapshot.stored);
+  for (uint32_t i = snapshot.stored; 0U < i; i--) {
+    const uint32_t kAge = snapshot.now - snapshot.timestamps[i - 1U];
+    if (kWindowUs < kAge) {
+      truncated = false;  // The ring covers the whole window
+      break;
+    }
+    if (kLevel == snapshot.levels[i - 1U]) {
+      if (0U == edges) {
+        newest = snapshot.timestamps[i - 1U];
+      }
+      oldest = snapshot.timestamps[i - 1U];
+      edges++;
+    }
+  }
+  if ((true == truncated) && (1U < edges) && (newest != oldest)) {
+    SET_FLOAT_RETURN(((float)(edges - 1U) * (float)DRV_CAPTURE_TIMER_HZ) /
+                     (float)(newest - oldest));
+  } else {
+    SET_FLOAT_RETURN(((float)edges * (float)DRV_CAPTURE_TIMER_HZ) /
+                     (float)kWindowUs);
+  }
+}
+
+/**
+ * @brief Gets the width of the latest complete high pulse
+ *
+ * @details Needs edge :both. Returns microseconds, or nil if no complete
+ * pulse is recorded.
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_capture_pulse_width(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Capture);
+  SET_NIL_RETURN();
+  if (false == capture_snapshot_arg(v, argc)) {
+    return;
+  }
+  for (uint32_t i = snapshot.stored; 1U < i; i--) {
+    if ((0U == snapshot.levels[i - 1U]) && (1U == snapshot.levels[i - 2U])) {
+      SET_INT_RETURN((mrbc_int_t)(snapshot.timestamps[i - 1U] -
+                                  snapshot.timestamps[i - 2U]));
+      return;
+    }
+  }
+}
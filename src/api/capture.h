@@ -0,0 +1,22 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file capture.h
+ * @brief Capture API for mruby/c
+ * @details Defines the Capture class and methods for mruby/c scripts
+ */
+#ifndef API_CAPTURE_H
+#define API_CAPTURE_H
+
+#include "../lib/fn.h"
+
+/**
+ * @brief Defines the Capture class and methods for mruby/c
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t api_capture_define(void);
+
+#endif
@@ -0,0 +1,166 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file gpio.c
+ * @brief Implementation of GPIO API for mruby/c
+ * @details Implements the GPIO class and methods for mruby/c scripts. Pins are
+ * given as a bit mask of one port, so a set of pins is read or written with a
+ * single call and a single register access.
+ */
+#include "gpio.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+#include "../../mrubyc/src/mrubyc.h"
+#include "../app/profiler.h"
+#include "../drv/gpio.h"
+#include "../lib/fn.h"
+
+LOG_MODULE_REGISTER(api_gpio, LOG_LEVEL_DBG);
+
+/**
+ * @brief Forward declarations for GPIO methods
+ */
+static void c_gpio_setup_port(mrb_vm *vm, mrb_value *v, int argc);
+static void c_gpio_read_port(mrb_vm *vm, mrb_value *v, int argc);
+static void c_gpio_write_port(mrb_vm *vm, mrb_value *v, int argc);
+
+/**
+ * @brief Pin mode of GPIO.setup_port
+ */
+typedef struct {
+  const char *name;          /**< Symbol name */
+  drv_gpio_port_mode_t mode; /**< Mode */
+} gpio_mode_t;
+
+/** @brief Modes accepted by GPIO.setup_port */
+static const gpio_mode_t kGpioModes[] = {
+    {"input", kDrvGpioPortInput},
+    {"input_pullup", kDrvGpioPortInputPullUp},
+    {"output", kDrvGpioPortOutput},
+    {"release", kDrvGpioPortDisconnect},
+};
+
+/**
+ * @brief Defines the GPIO class and methods for mruby/c
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t api_gpio_define(void) {
+  mrb_class *class_gpio;
+  class_gpio = mrbc_define_class(0, "GPIO", mrbc_class_object);
+  mrbc_define_method(0, class_gpio, "setup_port", c_gpio_setup_port);
+  mrbc_define_method(0, class_gpio, "read_port", c_gpio_read_port);
+  mrbc_define_method(0, class_gpio, "write_port", c_gpio_write_port);
+  return kSuccess;
+}
+
+/**
+ * @brief Reads the optional port argument
+ *
+ * @param v The value array
+ * @param kIndex Index of the port argument
+ * @param argc The argument count
+ * @param port Port index, 0 if the argument is omitted
+ * @return true if omitted or valid
+ */
+static bool gpio_port_arg(const mrb_value *const v, const int kIndex,
+                          const int argc, uint8_t *const port) {
+  *port = 0U;
+  if (kIndex > argc) {
+    return true;
+  }
+  if ((MRBC_TT_INTEGER != v[kIndex].tt) || (0 > v[kIndex].i) ||
+      ((mrbc_int_t)drv_gpio_port_count() <= v[kIndex].i)) {
+    return false;
+  }
+  *port = (uint8_t)v[kIndex].i;
+  return true;
+}
+
+/**
+ * @brief Sets the mode of port pins
+ *
+ * @details GPIO.setup_port(mask, mode, port = 0); mode is :input,
+ * :input_pullup, :output or :release
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_gpio_setup_port(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Gpio);
+  uint8_t port;
+  SET_FALSE_RETURN();
+  if ((2 > argc) || (MRBC_TT_INTEGER != v[1].tt) ||
+      (MRBC_TT_SYMBOL != v[2].tt) ||
+      (false == gpio_port_arg(v, 3, argc, &port))) {
+    return;
+  }
+  const char *const kName = mrbc_symid_to_str(v[2].i);
+  for (size_t i = 0; ARRAY_SIZE(kGpioModes) > i; i++) {
+    if (0 == strcmp(kGpioModes[i].name, kName)) {
+      if (kSuccess == drv_gpio_port_setup(port, (uint32_t)v[1].i,
+                                          kGpioModes[i].mode)) {
+        SET_TRUE_RETURN();
+      }
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Reads the raw levels of port pins at once
+ *
+ * @details GPIO.read_port(mask, port = 0); returns the levels masked by mask,
+ * or nil on error
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_gpio_read_port(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Gpio);
+  uint8_t port;
+  uint32_t value;
+  SET_NIL_RETURN();
+  if ((1 > argc) || (MRBC_TT_INTEGER != v[1].tt) ||
+      (false == gpio_port_arg(v, 2, argc, &port))) {
+    return;
+  }
+  if (kSuccess == drv_gpio_port_read(port, (uint32_t)v[1].i, &value)) {
+    SET_INT_RETURN((mrbc_int_t)value);
+  }
+}
+
+/**
+ * @brief Writes the raw levels of port output pins at once
+ *
+ * @details GPIO.write_port(mask, value, port = 0); pins outside mask keep
+ * their level
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_gpio_write_port(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Gpio);
+  uint8_t port;
+  SET_FALSE_RETURN();
+  if ((2 > argc) || (MRBC_TT_INTEGER != v[1].tt) ||
+      (MRBC_TT_INTEGER != v[2].tt) ||
+      (false == gpio_port_arg(v, 3, argc, &port))) {
+    return;
+  }
+  if (kSuccess ==
+      drv_gpio_port_write(port, (uint32_t)v[1].i, (uint32_t)v[2].i)) {
+    SET_TRUE_RETURN();
+  }
+}
@@ -0,0 +1,22 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file gpio.h
+ * @brief GPIO API for mruby/c
+ * @details Defines the GPIO class and methods for mruby/c scripts
+ */
+#ifndef API_GPIO_H
+#define API_GPIO_H
+
+#include "../lib/fn.h"
+
+/**
+ * @brief Defines the GPIO class and methods for mruby/c
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t api_gpio_define(void);
+
+#endif
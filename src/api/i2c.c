@@ -9,45 +9,271 @@
  */
 #include "i2c.h"
 
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include <zephyr/device.h>
 #include <zephyr/drivers/i2c.h>
+#include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
 
 #include "../../mrubyc/src/mrubyc.h"
+#include "../app/profiler.h"
+#include "../drv/i2c.h"
 #include "../lib/fn.h"
 
 LOG_MODULE_REGISTER(api_i2c, LOG_LEVEL_WRN);
 
-static const struct device *i2c_dev = DEVICE_DT_GET(DT_NODELABEL(i2c0));
+/**
+ * @brief Maximum number of data bytes in one transfer
+ */
+#define API_I2C_DATA_MAX DRV_I2C_DATA_MAX
+
+/**
+ * @brief Maximum number of messages between two delays of a transfer script
+ */
+#define API_I2C_TRANSFER_MSG_MAX 8U
+
+/**
+ * @brief Transfer script opcodes
+ * @details 'W' n data[n]: write, 'R' n: read, 'S': repeated start before the
+ * next message, 'D' ms: stop, then delay
+ */
+#define API_I2C_OP_WRITE 'W'
+#define API_I2C_OP_READ 'R'
+#define API_I2C_OP_RESTART 'S'
+#define API_I2C_OP_DELAY 'D'
+
+/**
+ * @brief Stack size of the asynchronous I2C work queue in bytes
+ */
+#define API_I2C_WORKQ_STACK_SIZE 1024
+
+/**
+ * @brief Priority of the asynchronous I2C work queue
+ */
+#define API_I2C_WORKQ_PRIORITY 0
+
+/**
+ * @brief Asynchronous I2C request
+ * @details Only one request is in flight at a time. The work queue owns it
+ * from submission until `done` is set; the VM thread owns it afterwards.
+ */
+typedef struct {
+  struct k_work work;              /**< Work item running the transfer */
+  mrbc_tcb *tcb;                   /**< Suspended task */
+  mrb_value rx_str;                /**< String read into (referenced) */
+  mrb_value script_str;            /**< Transfer script (referenced) */
+  const uint8_t *script;           /**< Transfer script, NULL if none */
+  size_t script_len;               /**< Transfer script length */
+  uint8_t *rx;                     /**< Read destination */
+  size_t rx_len;                   /**< Read length (0 for writes) */
+  uint8_t tx[API_I2C_DATA_MAX];    /**< Write data */
+  size_t tx_len;                   /**< Write length */
+  drv_i2c_target_t dev;            /**< Target device */
+  uint16_t reg;                    /**< Register address */
+  int rc;                          /**< Result */
+  atomic_t busy;                   /**< Submitted and not yet released */
+  atomic_t done;                   /**< Transfer finished */
+} i2c_async_req_t;
+
+/** @brief The asynchronous request slot */
+static i2c_async_req_t async_req;
+
+/** @brief Given by the work queue when a request is done */
+static K_SEM_DEFINE(async_done_sem, 0, 1);
+
+/** @brief Work queue running asynchronous transfers */
+static struct k_work_q i2c_workq;
+K_THREAD_STACK_DEFINE(i2c_workq_stack, API_I2C_WORKQ_STACK_SIZE);
+
+/** @brief Result of the last asynchronous transfer, per VM */
+static int last_error[MAX_VM_COUNT];
 
 /**
  * @brief Forward declarations for I2C methods
  */
 static void c_i2c_read(mrb_vm *vm, mrb_value *v, int argc);
 static void c_i2c_write(mrb_vm *vm, mrb_value *v, int argc);
+static void c_i2c_read_bytes(mrb_vm *vm, mrb_value *v, int argc);
+static void c_i2c_read_into(mrb_vm *vm, mrb_value *v, int argc);
+static void c_i2c_write_bytes(mrb_vm *vm, mrb_value *v, int argc);
+static void c_i2c_transfer(mrb_vm *vm, mrb_value *v, int argc);
+static void c_i2c_read_async(mrb_vm *vm, mrb_value *v, int argc);
+static void c_i2c_write_async(mrb_vm *vm, mrb_value *v, int argc);
+static void c_i2c_last_error(mrb_vm *vm, mrb_value *v, int argc);
+static void c_i2c_device(mrb_vm *vm, mrb_value *v, int argc);
+static void i2c_async_work(struct k_work *const work);
+static void i2c_async_release(void);
+static bool i2c_async_submit(mrb_vm *vm);
 
 /**
  * @brief Initializes the I2C subsystem
  *
- * @details Configures the I2C device with fast speed setting
+ * @details Configures the I2C buses and starts the asynchronous transfer
+ * work queue
  *
  * @return fn_t kSuccess if successful, kFailure otherwise
  */
 fn_t api_i2c_init(void) {
-  if (!device_is_ready(i2c_dev)) {
-    LOG_ERR("I2C device is not ready");
-    return kFailure;
-  }
-  const int kRc = i2c_configure(i2c_dev, I2C_SPEED_SET(I2C_SPEED_FAST));
-  if (0 != kRc) {
-    LOG_ERR("Failed to configure I2C device");
+  if (kSuccess != drv_i2c_init()) {
+    LOG_ERR("Failed to initialize I2C");
     return kFailure;
   }
 
+  k_work_queue_start(&i2c_workq, i2c_workq_stack,
+                     K_THREAD_STACK_SIZEOF(i2c_workq_stack),
+                     API_I2C_WORKQ_PRIORITY, NULL);
+  k_thread_name_set(&i2c_workq.thread, "i2c_async");
+  k_work_init(&async_req.work, i2c_async_work);
+
   LOG_INF("I2C device is ready");
   return kSuccess;
 }
 
+/**
+ * @brief Resolves the device argument of an I2C method
+ *
+ * @details Accepts the name of a registered device (Symbol) or a 7-bit
+ * address on the default bus
+ *
+ * @param kArg Argument
+ * @param target Resolved target
+ * @return true if resolved
+ * @return false if the argument is invalid or the name is unknown
+ */
+bool api_i2c_target_get(const mrb_value *const kArg,
+                        drv_i2c_target_t *const target) {
+  if (MRBC_TT_SYMBOL == kArg->tt) {
+    const char *const kName = mrbc_symid_to_str(kArg->i);
+    if (kSuccess != drv_i2c_device_find(kName, strlen(kName), target)) {
+      LOG_WRN("Unknown I2C device %s", kName);
+      return false;
+    }
+    return true;
+  }
+  if (true == MRBC_ISNUMERIC(*kArg)) {
+    *target = drv_i2c_target_default((uint16_t)kArg->i);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Sends the pending messages of a transfer script as one transaction
+ *
+ * @param msgs Messages
+ * @param kNum Number of messages
+ * @param kTarget Target device
+ * @param kDryRun true to only validate the script
+ * @return int 0 on success, negative errno otherwise
+ */
+static int i2c_script_flush(struct i2c_msg *const msgs, const size_t kNum,
+                            const drv_i2c_target_t *const kTarget,
+                            const bool kDryRun) {
+  if ((0U == kNum) || (true == kDryRun)) {
+    return 0;
+  }
+  msgs[kNum - 1U].flags |= I2C_MSG_STOP;
+  return drv_i2c_transfer(kTarget, msgs, (uint8_t)kNum);
+}
+
+/**
+ * @brief Runs (or validates) a transfer script
+ *
+ * @details Consecutive messages are sent with a single i2c_transfer() call;
+ * only a delay opcode splits the script into several transactions. A
+ * repeated start is inserted automatically when the direction changes.
+ *
+ * @param kScript Script bytes
+ * @param kLength Script length
+ * @param kTarget Target device
+ * @param out Destination of the read data (NULL for a dry run)
+ * @param out_len Total number of bytes read
+ * @param has_delay true if the script has a delay opcode
+ * @return int 0 on success, negative errno otherwise
+ */
+static int i2c_script_run(const uint8_t *const kScript, const size_t kLength,
+                          const drv_i2c_target_t *const kTarget,
+                          uint8_t *const out, size_t *const out_len,
+                          bool *const has_delay) {
+  const bool kDryRun = (NULL == out);
+  struct i2c_msg msgs[API_I2C_TRANSFER_MSG_MAX] = {0};
+  size_t num = 0U;
+  size_t pos = 0U;
+  bool restart = false;
+  int rc = 0;
+
+  *out_len = 0U;
+  *has_delay = false;
+  while ((pos < kLength) && (0 == rc)) {
+    const uint8_t kOp = kScript[pos++];
+    switch (kOp) {
+      case API_I2C_OP_WRITE:
+      case API_I2C_OP_READ: {
+        if ((pos >= kLength) || (0U == kScript[pos])) {
+          return -EINVAL;
+        }
+        const uint8_t kSize = kScript[pos++];
+        const bool kRead = (API_I2C_OP_READ == kOp);
+        if ((false == kRead) && ((kLength - pos) < kSize)) {
+          return -EINVAL;
+        }
+        if (API_I2C_TRANSFER_MSG_MAX <= num) {
+          return -ENOMEM;
+        }
+        struct i2c_msg *const msg = &msgs[num];
+        msg->len = kSize;
+        msg->flags = kRead ? I2C_MSG_READ : I2C_MSG_WRITE;
+        const bool kPrevRead =
+            (0U < num) &&
+            (I2C_MSG_READ == (msgs[num - 1U].flags & I2C_MSG_RW_MASK));
+        if ((0U < num) && (kRead != kPrevRead)) {
+          restart = true;
+        }
+        if (true == restart) {
+          msg->flags |= I2C_MSG_RESTART;
+          restart = false;
+        }
+        if (true == kRead) {
+          msg->buf = kDryRun ? NULL : &out[*out_len];
+          *out_len += kSize;
+        } else {
+          msg->buf = (uint8_t *)&kScript[pos];
+          pos += kSize;
+        }
+        num++;
+      } break;
+      case API_I2C_OP_RESTART:
+        restart = true;
+        break;
+      case API_I2C_OP_DELAY:
+        if (pos >= kLength) {
+          return -EINVAL;
+        }
+        rc = i2c_script_flush(msgs, num, kTarget, kDryRun);
+        num = 0U;
+        restart = false;
+        *has_delay = true;
+        if ((0 == rc) && (false == kDryRun)) {
+          k_msleep(kScript[pos]);
+        }
+        pos++;
+        break;
+      default:
+        return -EINVAL;
+    }
+  }
+  if (0 == rc) {
+    rc = i2c_script_flush(msgs, num, kTarget, kDryRun);
+  }
+  return rc;
+}
+
 /**
  * @brief Defines the I2C class and methods for mruby/c
  *
@@ -58,6 +284,14 @@ fn_t api_i2c_define(void) {
   class_i2c = mrbc_define_class(0, "I2C", mrbc_class_object);
   mrbc_define_method(0, class_i2c, "read", c_i2c_read);
   mrbc_define_method(0, class_i2c, "write", c_i2c_write);
+  mrbc_define_method(0, class_i2c, "read_bytes", c_i2c_read_bytes);
+  mrbc_define_method(0, class_i2c, "read_into", c_i2c_read_into);
+  mrbc_define_method(0, class_i2c, "write_bytes", c_i2c_write_bytes);
+  mrbc_define_method(0, class_i2c, "transfer", c_i2c_transfer);
+  mrbc_define_method(0, class_i2c, "read_async", c_i2c_read_async);
+  mrbc_define_method(0, class_i2c, "write_async", c_i2c_write_async);
+  mrbc_define_method(0, class_i2c, "last_error", c_i2c_last_error);
+  mrbc_define_method(0, class_i2c, "device", c_i2c_device);
   return kSuccess;
 }
 
@@ -69,15 +303,15 @@ fn_t api_i2c_define(void) {
  * @param argc The argument count
  */
 static void c_i2c_read(mrb_vm *vm, mrb_value *v, int argc) {
-  uint16_t device_id = 0U;
-  uint8_t address = 0U;
+  PROFILER_SCOPE(I2c);
+  drv_i2c_target_t target = drv_i2c_target_default(0U);
+  uint16_t address = 0U;
   uint8_t size = 0U;
   uint8_t data_buf[255] = {0U};
 
-  // DeviceID
-  if (true == MRBC_ISNUMERIC(v[1])) {
-    device_id = GET_INT_ARG(1);
-  }
+  // DeviceID (address 0 if omitted, -ENODEV if the name is unknown)
+  const bool kKnown = (true == api_i2c_target_get(&v[1], &target)) ||
+                      (MRBC_TT_SYMBOL != v[1].tt);
   // Address
   if (true == MRBC_ISNUMERIC(v[2])) {
     address = GET_INT_ARG(2);
@@ -89,10 +323,10 @@ static void c_i2c_read(mrb_vm *vm, mrb_value *v, int argc) {
   }
 
   mrb_value ret = mrbc_array_new(vm, size + 1);
-  const int kRc =
-      i2c_write_read(i2c_dev, device_id, &address, 1, data_buf, size);
+  const int kRc = kKnown ? drv_i2c_reg_read(&target, address, data_buf, size)
+                         : -ENODEV;
   LOG_DBG("i2c_read: return:%d, ID:0x%02X, Address:0x%02X, Size:0x%02X", kRc,
-          device_id, address, size);
+          target.addr, address, size);
 
   // ReturnCode
   do {
@@ -122,31 +356,466 @@ static void c_i2c_read(mrb_vm *vm, mrb_value *v, int argc) {
  * @param argc The argument count
  */
 static void c_i2c_write(mrb_vm *vm, mrb_value *v, int argc) {
-  uint16_t device_id = 0U;
+  PROFILER_SCOPE(I2c);
+  drv_i2c_target_t target = drv_i2c_target_default(0U);
+  uint16_t address = 0U;
   uint8_t size = 0U;
-  uint8_t data_buf[255] = {0U};
+  uint8_t data_buf[254] = {0U};
 
-  // DeviceID
-  if (true == MRBC_ISNUMERIC(v[1])) {
-    device_id = GET_INT_ARG(1);
+  // DeviceID (address 0 if omitted, error if the name is unknown)
+  if ((false == api_i2c_target_get(&v[1], &target)) &&
+      (MRBC_TT_SYMBOL == v[1].tt)) {
+    SET_INT_RETURN(-ENODEV);
+    return;
   }
   // Address
   if (true == MRBC_ISNUMERIC(v[2])) {
-    data_buf[0] = GET_INT_ARG(2);
+    address = GET_INT_ARG(2);
   }
   // Data
   if (MRBC_TT_ARRAY == v[3].tt) {
     size = v[3].array->n_stored;
-    if (((sizeof(data_buf) / sizeof(data_buf[0])) - 1) < size) return;
+    if ((sizeof(data_buf) / sizeof(data_buf[0])) < size) return;
     for (size_t i = 0; i < size; i++) {
-      data_buf[i + 1] = (uint8_t)v[3].array->data[i].i;
+      data_buf[i] = (uint8_t)v[3].array->data[i].i;
     }
   }
 
-  const int kRc =
-      i2c_write(i2c_dev, data_buf, (uint32_t)(size + 1), (uint16_t)device_id);
+  const int kRc = drv_i2c_reg_write(&target, address, data_buf, size);
   LOG_DBG("i2c_write: return:%d, ID:0x%02X, Address:0x%02X, Size:0x%02X", kRc,
-          device_id, data_buf[0], size);
+          target.addr, address, size);
+
+  SET_INT_RETURN(kRc);
+}
+
+/**
+ * @brief Reads data from an I2C device into a new String
+ *
+ * @details The String is the only allocation; data is read straight into it.
+ * Returns nil on error.
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_i2c_read_bytes(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(I2c);
+  drv_i2c_target_t target;
+  SET_NIL_RETURN();
+  if ((3 > argc) || (false == api_i2c_target_get(&v[1], &target)) ||
+      (false == MRBC_ISNUMERIC(v[2])) || (MRBC_TT_INTEGER != v[3].tt)) {
+    return;
+  }
+  const uint16_t kAddress = (uint16_t)GET_INT_ARG(2);
+  const mrbc_int_t kSize = GET_INT_ARG(3);
+  if ((0 >= kSize) || (API_I2C_DATA_MAX < kSize)) {
+    return;
+  }
+
+  mrb_value ret = mrbc_string_new(vm, NULL, (int)kSize);
+  if (MRBC_TT_STRING != ret.tt) {
+    return;
+  }
+  const int kRc =
+      drv_i2c_reg_read(&target, kAddress, ret.string->data, (size_t)kSize);
+  LOG_DBG("i2c_read_bytes: return:%d, ID:0x%02X, Address:0x%02X, Size:0x%02X",
+          kRc, target.addr, kAddress, (int)kSize);
+  if (0 != kRc) {
+    mrbc_decref(&ret);
+    return;
+  }
+  SET_RETURN(ret);
+}
+
+/**
+ * @brief Reads data from an I2C device into an existing String
+ *
+ * @details Fills the whole String (its current size) without allocating
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_i2c_read_into(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(I2c);
+  drv_i2c_target_t target;
+  SET_INT_RETURN(-EINVAL);
+  if ((3 > argc) || (false == api_i2c_target_get(&v[1], &target)) ||
+      (false == MRBC_ISNUMERIC(v[2])) || (MRBC_TT_STRING != v[3].tt)) {
+    return;
+  }
+  const uint16_t kAddress = (uint16_t)GET_INT_ARG(2);
+  const size_t kSize = (size_t)v[3].string->size;
+  if ((0U == kSize) || (API_I2C_DATA_MAX < kSize)) {
+    return;
+  }
+
+  const int kRc =
+      drv_i2c_reg_read(&target, kAddress, v[3].string->data, kSize);
+  LOG_DBG("i2c_read_into: return:%d, ID:0x%02X, Address:0x%02X, Size:0x%02X",
+          kRc, target.addr, kAddress, kSize);
+  SET_INT_RETURN(kRc);
+}
+
+/**
+ * @brief Writes the bytes of a String to an I2C device
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_i2c_write_bytes(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(I2c);
+  drv_i2c_target_t target;
+  SET_INT_RETURN(-EINVAL);
+  if ((3 > argc) || (false == api_i2c_target_get(&v[1], &target)) ||
+      (false == MRBC_ISNUMERIC(v[2])) || (MRBC_TT_STRING != v[3].tt)) {
+    return;
+  }
+  const uint16_t kAddress = (uint16_t)GET_INT_ARG(2);
+  const size_t kSize = (size_t)v[3].string->size;
+  if (API_I2C_DATA_MAX < kSize) {
+    return;
+  }
 
+  const int kRc =
+      drv_i2c_reg_write(&target, kAddress, v[3].string->data, kSize);
+  LOG_DBG("i2c_write_bytes: return:%d, ID:0x%02X, Address:0x%02X, Size:0x%02X",
+          kRc, target.addr, kAddress, kSize);
   SET_INT_RETURN(kRc);
 }
+
+/**
+ * @brief Executes a transfer script and returns all read data
+ *
+ * @details Returns a String with the data of every read opcode in script
+ * order, or nil on error. A script with delays runs on the I2C work queue
+ * like read_async, so that the delays do not stall the other tasks; its
+ * result is then available from I2C.last_error.
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_i2c_transfer(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(I2c);
+  const uint8_t kVmId = (vm->vm_id - 1);
+  drv_i2c_target_t target;
+  size_t total = 0U;
+  bool has_delay = false;
+  SET_NIL_RETURN();
+  if ((2 > argc) || (false == api_i2c_target_get(&v[1], &target)) ||
+      (MRBC_TT_STRING != v[2].tt)) {
+    return;
+  }
+  const uint8_t *const kScript = v[2].string->data;
+  const size_t kLength = (size_t)v[2].string->size;
+
+  // Validate first so that nothing is sent for a malformed script
+  int rc = i2c_script_run(kScript, kLength, &target, NULL, &total, &has_delay);
+  if (0 != rc) {
+    LOG_WRN("i2c_transfer: invalid script (%d)", rc);
+    return;
+  }
+  if (true == has_delay) {
+    i2c_async_release();
+    if (atomic_get(&async_req.busy)) {
+      // Sleeping here would stall every task
+      if (MAX_VM_COUNT > kVmId) {
+        last_error[kVmId] = -EBUSY;
+      }
+      return;
+    }
+  }
+
+  mrb_value ret = mrbc_string_new(vm, NULL, (int)total);
+  if (MRBC_TT_STRING != ret.tt) {
+    return;
+  }
+  if (true == has_delay) {
+    async_req.dev = target;
+    async_req.tx_len = 0U;
+    async_req.rx = ret.string->data;
+    async_req.rx_len = total;
+    async_req.rx_str = ret;
+    mrbc_incref(&async_req.rx_str);  // kept alive until released
+    async_req.script_str = v[2];
+    mrbc_incref(&async_req.script_str);
+    async_req.script = kScript;
+    async_req.script_len = kLength;
+    (void)i2c_async_submit(vm);  // Not busy, so always queued
+    SET_RETURN(ret);
+    return;
+  }
+  rc = i2c_script_run(kScript, kLength, &target, ret.string->data, &total,
+                      &has_delay);
+  LOG_DBG("i2c_transfer: return:%d, ID:0x%02X, Script:%u, Read:%u", rc,
+          target.addr, kLength, total);
+  if (0 != rc) {
+    mrbc_decref(&ret);
+    return;
+  }
+  SET_RETURN(ret);
+}
+
+/**
+ * @brief Work handler running an asynchronous transfer
+ *
+ * @details Runs on i2c_workq, so only this thread blocks on the bus. The
+ * calling task is resumed from here; mrbc_resume_task() is safe even if the
+ * VM has not switched away from the task yet. The task is resumed before
+ * `done` is published: once `done` is set the VM thread may release the
+ * request and free the task, so the request is not touched afterwards.
+ *
+ * @param work Pointer to the work item
+ */
+static void i2c_async_work(struct k_work *const work) {
+  i2c_async_req_t *const req = CONTAINER_OF(work, i2c_async_req_t, work);
+
+  if (NULL != req->script) {
+    size_t total = 0U;
+    bool has_delay = false;
+    req->rc = i2c_script_run(req->script, req->script_len, &req->dev, req->rx,
+                             &total, &has_delay);
+  } else if (0U < req->rx_len) {
+    req->rc = drv_i2c_reg_read(&req->dev, req->reg, req->rx, req->rx_len);
+  } else {
+    req->rc = drv_i2c_reg_write(&req->dev, req->reg, req->tx, req->tx_len);
+  }
+  LOG_DBG("i2c_async: return:%d, ID:0x%02X, Address:0x%02X, Size:0x%02X",
+          req->rc, req->dev.addr, req->reg,
+          (0U < req->rx_len) ? req->rx_len : req->tx_len);
+
+  mrbc_resume_task(req->tcb);
+  atomic_set(&req->done, 1);
+  k_sem_give(&async_done_sem);
+}
+
+/**
+ * @brief Releases a finished request (VM thread only)
+ *
+ * @details Records the result for the VM that issued it and drops the
+ * reference to the read target
+ */
+static void i2c_async_release(void) {
+  if (!atomic_get(&async_req.busy) || !atomic_get(&async_req.done)) {
+    return;
+  }
+  const uint8_t kVmId = (async_req.tcb->vm.vm_id - 1);
+  if (MAX_VM_COUNT > kVmId) {
+    last_error[kVmId] = async_req.rc;
+  }
+  if (MRBC_TT_STRING == async_req.rx_str.tt) {
+    mrbc_decref(&async_req.rx_str);
+  }
+  if (MRBC_TT_STRING == async_req.script_str.tt) {
+    mrbc_decref(&async_req.script_str);
+  }
+  async_req.rx_str = mrbc_nil_value();
+  async_req.script_str = mrbc_nil_value();
+  async_req.script = NULL;
+  async_req.tcb = NULL;
+  atomic_set(&async_req.done, 0);
+  atomic_set(&async_req.busy, 0);
+}
+
+/**
+ * @brief Waits for an in-flight asynchronous transfer and releases it
+ *
+ * @details Must be called from the VM thread before the VM heap is released
+ */
+void api_i2c_async_wait(void) {
+  while (atomic_get(&async_req.busy) && !atomic_get(&async_req.done)) {
+    (void)k_sem_take(&async_done_sem, K_FOREVER);
+  }
+  i2c_async_release();
+}
+
+/**
+ * @brief Queues a transfer on the I2C work queue and suspends the task
+ *
+ * @details Falls back to a blocking transfer if another request is in
+ * flight
+ *
+ * @param vm The mruby/c VM instance
+ * @return true if queued (task suspended)
+ * @return false if it was executed synchronously
+ */
+static bool i2c_async_submit(mrb_vm *vm) {
+  const uint8_t kVmId = (vm->vm_id - 1);
+  i2c_async_release();
+  if (!atomic_cas(&async_req.busy, 0, 1)) {
+    // Bus busy with another task's request: do it in place
+    async_req.rc = -EBUSY;
+    return false;
+  }
+  async_req.tcb = MRBC_VM2TCB(vm);
+  atomic_set(&async_req.done, 0);
+  if (MAX_VM_COUNT > kVmId) {
+    last_error[kVmId] = -EINPROGRESS;
+  }
+  k_sem_reset(&async_done_sem);
+  mrbc_suspend_task(async_req.tcb);
+  k_work_submit_to_queue(&i2c_workq, &async_req.work);
+  return true;
+}
+
+/**
+ * @brief Reads data from an I2C device without blocking other tasks
+ *
+ * @details Returns a String that is filled before the calling task runs
+ * again; the result is available from I2C.last_error. Returns nil if the
+ * arguments are invalid, or with last_error -EBUSY if another transfer is
+ * in progress.
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_i2c_read_async(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(I2c);
+  const uint8_t kVmId = (vm->vm_id - 1);
+  drv_i2c_target_t target;
+  SET_NIL_RETURN();
+  if ((3 > argc) || (false == api_i2c_target_get(&v[1], &target)) ||
+      (false == MRBC_ISNUMERIC(v[2])) || (MRBC_TT_INTEGER != v[3].tt)) {
+    return;
+  }
+  const uint16_t kAddress = (uint16_t)GET_INT_ARG(2);
+  const mrbc_int_t kSize = GET_INT_ARG(3);
+  if ((0 >= kSize) || (API_I2C_DATA_MAX < kSize)) {
+    return;
+  }
+
+  i2c_async_release();
+  if (atomic_get(&async_req.busy)) {
+    // A synchronous read would wait for the bus and stall every task
+    if (MAX_VM_COUNT > kVmId) {
+      last_error[kVmId] = -EBUSY;
+    }
+    return;
+  }
+  mrb_value ret = mrbc_string_new(vm, NULL, (int)kSize);
+  if (MRBC_TT_STRING != ret.tt) {
+    return;
+  }
+
+  async_req.dev = target;
+  async_req.reg = kAddress;
+  async_req.script = NULL;
+  async_req.tx_len = 0U;
+  async_req.rx = ret.string->data;
+  async_req.rx_len = (size_t)kSize;
+  async_req.rx_str = ret;
+  mrbc_incref(&async_req.rx_str);  // kept alive until released
+  if (false == i2c_async_submit(vm)) {
+    mrbc_decref(&async_req.rx_str);
+    async_req.rx_str = mrbc_nil_value();
+  }
+  SET_RETURN(ret);
+}
+
+/**
+ * @brief Writes the bytes of a String to an I2C device without blocking
+ * other tasks
+ *
+ * @details The data is copied, so the String may be modified afterwards.
+ * The result is available from I2C.last_error. Returns false with
+ * last_error -EBUSY if another transfer is in progress.
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_i2c_write_async(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(I2c);
+  const uint8_t kVmId = (vm->vm_id - 1);
+  drv_i2c_target_t target;
+  SET_FALSE_RETURN();
+  if ((3 > argc) || (false == api_i2c_target_get(&v[1], &target)) ||
+      (false == MRBC_ISNUMERIC(v[2])) || (MRBC_TT_STRING != v[3].tt)) {
+    return;
+  }
+  const uint16_t kAddress = (uint16_t)GET_INT_ARG(2);
+  const size_t kSize = (size_t)v[3].string->size;
+  if (API_I2C_DATA_MAX < kSize) {
+    return;
+  }
+
+  i2c_async_release();
+  if (atomic_get(&async_req.busy)) {
+    // A synchronous write would wait for the bus and stall every task
+    if (MAX_VM_COUNT > kVmId) {
+      last_error[kVmId] = -EBUSY;
+    }
+    return;
+  }
+
+  async_req.dev = target;
+  async_req.reg = kAddress;
+  async_req.script = NULL;
+  memcpy(async_req.tx, v[3].string->data, kSize);
+  async_req.tx_len = kSize;
+  async_req.rx = NULL;
+  async_req.rx_len = 0U;
+  async_req.rx_str = mrbc_nil_value();
+  (void)i2c_async_submit(vm);
+  SET_TRUE_RETURN();
+}
+
+/**
+ * @brief Gets the result of the last asynchronous transfer of this VM
+ *
+ * @details 0 on success, negative errno on error, -EINPROGRESS while the
+ * transfer is still running
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_i2c_last_error(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(I2c);
+  const uint8_t kVmId = (vm->vm_id - 1);
+  i2c_async_release();
+  SET_INT_RETURN((MAX_VM_COUNT > kVmId) ? last_error[kVmId] : -EINVAL);
+}
+
+/**
+ * @brief Registers a named I2C device
+ *
+ * @details I2C.device(name, address, hz = 400_000, reg_width = 1, bus = 0).
+ * The name can then be passed instead of the address to every method.
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_i2c_device(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(I2c);
+  SET_FALSE_RETURN();
+  if ((2 > argc) || (MRBC_TT_SYMBOL != v[1].tt) ||
+      (MRBC_TT_INTEGER != v[2].tt)) {
+    return;
+  }
+  for (int i = 3; argc >= i; i++) {
+    if (MRBC_TT_INTEGER != v[i].tt) {
+      return;
+    }
+  }
+  const int kSpeed =
+      drv_i2c_speed_from_hz((3 <= argc) ? (uint32_t)GET_INT_ARG(3)
+                                        : I2C_BITRATE_FAST);
+  if (0 > kSpeed) {
+    return;
+  }
+  const drv_i2c_target_t kTarget = {
+      .bus = (5 <= argc) ? (uint8_t)GET_INT_ARG(5) : 0U,
+      .speed = (uint8_t)kSpeed,
+      .reg_width = (4 <= argc) ? (uint8_t)GET_INT_ARG(4) : 1U,
+      .addr = (uint16_t)GET_INT_ARG(2),
+  };
+  if (kSuccess ==
+      drv_i2c_device_register(mrbc_symid_to_str(v[1].i), &kTarget)) {
+    SET_TRUE_RETURN();
+  }
+}
@@ -10,6 +10,10 @@
 #ifndef API_I2C_H
 #define API_I2C_H
 
+#include <stdbool.h>
+
+#include "../../mrubyc/src/mrubyc.h"
+#include "../drv/i2c.h"
 #include "../lib/fn.h"
 
 /**
@@ -26,4 +30,26 @@ fn_t api_i2c_init(void);
  */
 fn_t api_i2c_define(void);
 
+/**
+ * @brief Waits for an in-flight asynchronous transfer and releases it
+ *
+ * @details Call from the VM thread after mrbc_run() returns and before the
+ * VM heap is released
+ */
+void api_i2c_async_wait(void);
+
+/**
+ * @brief Resolves the device argument of an I2C method
+ *
+ * @details Accepts the name of a registered device (Symbol) or a 7-bit
+ * address on the default bus
+ *
+ * @param kArg Argument
+ * @param target Resolved target
+ * @return true if resolved
+ * @return false if the argument is invalid or the name is unknown
+ */
+bool api_i2c_target_get(const mrb_value *const kArg,
+                        drv_i2c_target_t *const target);
+
 #endif
@@ -14,6 +14,7 @@
 #include <zephyr/logging/log.h>
 
 #include "../../mrubyc/src/mrubyc.h"
+#include "../app/profiler.h"
 #include "../drv/gpio.h"
 #include "../lib/fn.h"
 #include "api.h"
@@ -21,14 +22,6 @@
 
 LOG_MODULE_REGISTER(api_input, LOG_LEVEL_DBG);
 
-/**
- * @brief Converts a symbol ID to the corresponding GPIO enum
- *
- * @param kSymbol The symbol ID to convert
- * @return drv_gpio_t The corresponding GPIO enum
- */
-static drv_gpio_t sym_to_gpio(const int16_t kSymbol);
-
 /**
  * @brief Forward declarations for button state methods
  */
@@ -60,6 +53,7 @@ fn_t api_input_define(void) {
  * @param argc The argument count
  */
 static void c_get_sw_pressed(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Input);
   int16_t tgt = -1;
   SET_FALSE_RETURN();
 
@@ -79,7 +73,9 @@ static void c_get_sw_pressed(mrb_vm *vm, mrb_value *v, int argc) {
   MRBC_KW_DELETE(part);
   // ==============================
 
-  if (true == drv_gpio_get(sym_to_gpio(tgt))) {
+  drv_gpio_t sw;
+  if ((true == api_symbol_pin_get(vm->vm_id, tgt, kSymbolPinRead, &sw)) &&
+      (true == drv_gpio_get(sw))) {
     SET_TRUE_RETURN();
   }
 }
@@ -92,6 +88,7 @@ static void c_get_sw_pressed(mrb_vm *vm, mrb_value *v, int argc) {
  * @param argc The argument count
  */
 static void c_get_sw_released(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Input);
   int16_t tgt = -1;
   SET_FALSE_RETURN();
 
@@ -111,7 +108,9 @@ static void c_get_sw_released(mrb_vm *vm, mrb_value *v, int argc) {
   MRBC_KW_DELETE(part);
   // ==============================
 
-  if (false == drv_gpio_get(sym_to_gpio(tgt))) {
+  drv_gpio_t sw;
+  if ((true == api_symbol_pin_get(vm->vm_id, tgt, kSymbolPinRead, &sw)) &&
+      (false == drv_gpio_get(sw))) {
     SET_TRUE_RETURN();
   }
 }
@@ -119,25 +118,6 @@ static void c_get_sw_released(mrb_vm *vm, mrb_value *v, int argc) {
 // **************************************************************************
 // c_sw1_read
 static void c_sw1_read(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Input);
   SET_INT_RETURN(1);  // DUMMY
 }
-
-/**
- * @brief Converts a symbol ID to the corresponding GPIO enum
- *
- * @param kSymbol The symbol ID to convert
- * @return drv_gpio_t The corresponding GPIO enum
- */
-static drv_gpio_t sym_to_gpio(const int16_t kSymbol) {
-  if (api_symbol_get_id(kSymbolSW1) == kSymbol) {
-    return kDrvGpioSW1;
-  } else if (api_symbol_get_id(kSymbolSW2) == kSymbol) {
-    return kDrvGpioSW2;
-  } else if (api_symbol_get_id(kSymbolSW3) == kSymbol) {
-    return kDrvGpioSW3;
-  } else if (api_symbol_get_id(kSymbolSW4) == kSymbol) {
-    return kDrvGpioSW4;
-  } else {
-    return kDrvGpioSW1;
-  }
-}
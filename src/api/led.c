@@ -11,10 +11,14 @@
 #include "led.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
 
 #include "../../mrubyc/src/mrubyc.h"
+#include "../app/profiler.h"
 #include "../drv/gpio.h"
 #include "../lib/fn.h"
 #include "api.h"
@@ -31,6 +35,45 @@ LOG_MODULE_REGISTER(api_led, LOG_LEVEL_DBG);
  */
 static void c_set_led(mrb_vm *vm, mrb_value *v, int argc);
 
+/**
+ * @brief Forward declaration for LED pattern method
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_led_pattern(mrb_vm *vm, mrb_value *v, int argc);
+
+/**
+ * @brief Named pattern of LED.pattern
+ */
+typedef struct {
+  const char *name;           /**< Value of mode: */
+  drv_gpio_pattern_t pattern; /**< Pattern before keyword overrides */
+} led_preset_t;
+
+/** @brief Patterns selectable with mode:, the first is the default */
+static const led_preset_t kLedPresets[] = {
+    {"blink",
+     {.on_ms = 500U,
+      .off_ms = 500U,
+      .pause_ms = 0U,
+      .count = 1U,
+      .repeat = 0U}},
+    {"pulse",
+     {.on_ms = 100U,
+      .off_ms = 100U,
+      .pause_ms = 0U,
+      .count = 1U,
+      .repeat = 1U}},
+    {"heartbeat",
+     {.on_ms = 100U,
+      .off_ms = 150U,
+      .pause_ms = 650U,
+      .count = 2U,
+      .repeat = 0U}},
+};
+
 /**
  * @brief Defines the LED class and methods for mruby/c
  *
@@ -40,6 +83,7 @@ fn_t api_led_define(void) {
   mrb_class *class_led;
   class_led = mrbc_define_class(0, "LED", mrbc_class_object);
   mrbc_define_method(0, class_led, "set", c_set_led);
+  mrbc_define_method(0, class_led, "pattern", c_led_pattern);
   return kSuccess;
 }
 
@@ -51,6 +95,7 @@ fn_t api_led_define(void) {
  * @param argc The argument count
  */
 static void c_set_led(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Led);
   int16_t tgt = -1; /**< Target LED symbol ID */
   bool req = false; /**< Requested LED state */
   SET_FALSE_RETURN();
@@ -75,21 +120,91 @@ static void c_set_led(mrb_vm *vm, mrb_value *v, int argc) {
   MRBC_KW_DELETE(part, state);
   // ==============================
 
-  // LED1
-  if (api_symbol_get_id(kSymbolLED1) == tgt) {
-    drv_gpio_set(kDrvGpioLED1, req);
+  // Stops a pattern running on the LED
+  drv_gpio_t led;
+  if (true == api_symbol_pin_get(vm->vm_id, tgt, kSymbolPinWrite, &led)) {
+    drv_gpio_set(led, req);
     SET_TRUE_RETURN();
   }
-  // LED2
-  if (api_symbol_get_id(kSymbolLED2) == tgt) {
-    drv_gpio_set(kDrvGpioLED2, req);
-    SET_TRUE_RETURN();
+}
+
+/**
+ * @brief Reads an optional integer keyword argument of LED.pattern
+ *
+ * @param kArg Keyword value
+ * @param kMax Largest accepted value
+ * @param value Destination, unchanged if the keyword is absent
+ * @return true if absent or valid
+ */
+static bool led_pattern_arg(const mrb_value *const kArg, const mrbc_int_t kMax,
+                            uint16_t *const value) {
+  if (MRBC_TT_EMPTY == kArg->tt) {
+    return true;
+  }
+  if ((MRBC_TT_INTEGER != kArg->tt) || (0 > kArg->i) || (kMax < kArg->i)) {
+    return false;
   }
-  // LED3 (only for system task)
-  if (kSuccess == api_api_check_systemtask(vm->vm_id)) {
-    if (api_symbol_get_id(kSymbolLED3) == tgt) {
-      drv_gpio_set(kDrvGpioLED3, req);
-      SET_TRUE_RETURN();
+  *value = (uint16_t)kArg->i;
+  return true;
+}
+
+/**
+ * @brief Runs a blink pattern on an LED in the background
+ *
+ * @details LED.pattern(part:, mode: :blink, on_ms:, off_ms:, count:,
+ * pause_ms:, repeat:). The keywords override the timing of the selected mode.
+ * LED.set on the same LED stops the pattern.
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_led_pattern(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Led);
+  drv_gpio_t tgt = kDrvGpioLED1;
+  drv_gpio_pattern_t pattern = kLedPresets[0].pattern;
+  uint16_t flashes = pattern.count;
+  bool valid = false;
+  SET_FALSE_RETURN();
+
+  // ==============================
+  MRBC_KW_ARG(part, mode, on_ms, off_ms, count, pause_ms, repeat);
+  do {
+    if (!MRBC_KW_MANDATORY(part)) break;
+    if (!MRBC_KW_END()) break;
+
+    if ((MRBC_TT_SYMBOL != part.tt) ||
+        (false == api_symbol_pin_get(vm->vm_id, (int16_t)part.i,
+                                     kSymbolPinWrite, &tgt))) {
+      break;
     }
+    if (MRBC_KW_ISVALID(mode)) {
+      if (MRBC_TT_SYMBOL != mode.tt) {
+        break;
+      }
+      const char *const kMode = mrbc_symid_to_str(mode.i);
+      size_t i = 0;
+      while ((ARRAY_SIZE(kLedPresets) > i) &&
+             (0 != strcmp(kLedPresets[i].name, kMode))) {
+        i++;
+      }
+      if (ARRAY_SIZE(kLedPresets) <= i) {
+        break;
+      }
+      pattern = kLedPresets[i].pattern;
+      flashes = pattern.count;
+    }
+    valid = led_pattern_arg(&on_ms, UINT16_MAX, &pattern.on_ms) &&
+            led_pattern_arg(&off_ms, UINT16_MAX, &pattern.off_ms) &&
+            led_pattern_arg(&count, UINT8_MAX, &flashes) &&
+            led_pattern_arg(&pause_ms, UINT16_MAX, &pattern.pause_ms) &&
+            led_pattern_arg(&repeat, UINT16_MAX, &pattern.repeat);
+  } while (0);
+  MRBC_KW_DELETE(part, mode, on_ms, off_ms, count, pause_ms, repeat);
+  // ==============================
+
+  pattern.count = (uint8_t)flashes;
+  if ((true == valid) && (kSuccess == drv_gpio_pattern_start(tgt, &pattern))) {
+    SET_TRUE_RETURN();
   }
 }
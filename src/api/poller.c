@@ -0,0 +1,295 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file poller.c
+ * @brief Implementation of Poller API for mruby/c
+ * @details Implements the Poller class and methods for mruby/c scripts
+ */
+#include "poller.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+
+#include "../../mrubyc/src/mrubyc.h"
+#include "../app/poller.h"
+#include "../app/profiler.h"
+#include "../drv/adc.h"
+#include "../lib/fn.h"
+#include "i2c.h"
+
+LOG_MODULE_REGISTER(api_poller, LOG_LEVEL_WRN);
+
+/** @brief Task suspended in Poller.wait, NULL if none */
+static atomic_ptr_t waiter = ATOMIC_PTR_INIT(NULL);
+
+/**
+ * @brief Work handler ending a Poller.wait on timeout
+ *
+ * @param work Pointer to the work item
+ */
+static void poller_wait_timeout(struct k_work *const work);
+K_WORK_DELAYABLE_DEFINE(work_poller_timeout, poller_wait_timeout);
+
+/**
+ * @brief Forward declaration for poller methods
+ */
+static void c_poller_adc(mrb_vm *vm, mrb_value *v, int argc);
+static void c_poller_temperature(mrb_vm *vm, mrb_value *v, int argc);
+static void c_poller_i2c(mrb_vm *vm, mrb_value *v, int argc);
+static void c_poller_threshold(mrb_vm *vm, mrb_value *v, int argc);
+static void c_poller_remove(mrb_vm *vm, mrb_value *v, int argc);
+static void c_poller_get(mrb_vm *vm, mrb_value *v, int argc);
+static void c_poller_wait(mrb_vm *vm, mrb_value *v, int argc);
+
+/**
+ * @brief Resumes the task waiting in Poller.wait
+ *
+ * @details Called from the poller work queue and the timeout work item.
+ * mrbc_resume_task() locks the scheduler, so it is not called from an ISR.
+ */
+static void poller_wake(void) {
+  mrbc_tcb *const tcb = (mrbc_tcb *)atomic_ptr_clear(&waiter);
+  if (NULL != tcb) {
+    (void)k_work_cancel_delayable(&work_poller_timeout);
+    mrbc_resume_task(tcb);
+  }
+}
+
+/**
+ * @brief Work handler ending a Poller.wait on timeout
+ *
+ * @param work Pointer to the work item
+ */
+static void poller_wait_timeout(struct k_work *const work) { poller_wake(); }
+
+/**
+ * @brief Defines the Poller class and methods for mruby/c
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t api_poller_define(void) {
+  mrb_class *class_poller;
+  class_poller = mrbc_define_class(0, "Poller", mrbc_class_object);
+  mrbc_define_method(0, class_poller, "adc", c_poller_adc);
+  mrbc_define_method(0, class_poller, "temperature", c_poller_temperature);
+  mrbc_define_method(0, class_poller, "i2c", c_poller_i2c);
+  mrbc_define_method(0, class_poller, "threshold", c_poller_threshold);
+  mrbc_define_method(0, class_poller, "remove", c_poller_remove);
+  mrbc_define_method(0, class_poller, "get", c_poller_get);
+  mrbc_define_method(0, class_poller, "wait", c_poller_wait);
+  poller_set_notify(poller_wake);
+  return kSuccess;
+}
+
+/**
+ * @brief Removes all pollers and releases a waiting task
+ *
+ * @details Call from the VM thread after mrbc_run() returns
+ */
+void api_poller_stop(void) {
+  struct k_work_sync sync;
+  poller_set_notify(NULL);
+  poller_clear();
+  (void)k_work_cancel_delayable_sync(&work_poller_timeout, &sync);
+  (void)atomic_ptr_clear(&waiter);
+}
+
+/**
+ * @brief Adds a poller and returns its identifier
+ *
+ * @param v The value array
+ * @param config Configuration (source fields already set)
+ * @param kPeriodArg Index of the period argument
+ * @param argc The argument count
+ */
+static void poller_add_common(mrb_value *v, poller_config_t *const config,
+                              const int kPeriodArg, const int argc) {
+  SET_NIL_RETURN();
+  if ((kPeriodArg > argc) || (MRBC_TT_INTEGER != v[kPeriodArg].tt) ||
+      (0 > v[kPeriodArg].i)) {
+    return;
+  }
+  config->period_ms = (uint32_t)v[kPeriodArg].i;
+  config->filter = kPollerFilterDelta;
+  config->level = 0;
+  config->hysteresis = 0;
+  if (kPeriodArg < argc) {
+    if ((MRBC_TT_INTEGER != v[kPeriodArg + 1].tt) ||
+        (0 > v[kPeriodArg + 1].i)) {
+      return;
+    }
+    config->level = (int32_t)v[kPeriodArg + 1].i;
+  }
+  const int kId = poller_add(config);
+  if (0 <= kId) {
+    SET_INT_RETURN(kId);
+  }
+}
+
+/**
+ * @brief Polls an ADC channel (millivolts)
+ *
+ * @details Poller.adc(channel, period_ms, delta = 0)
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_poller_adc(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Poller);
+  poller_config_t config = {.source = kPollerSourceAdc};
+  SET_NIL_RETURN();
+  if ((1 > argc) || (MRBC_TT_INTEGER != v[1].tt) || (0 > v[1].i) ||
+      (drv_adc_channel_count() <= (size_t)v[1].i)) {
+    return;
+  }
+  config.channel = (uint8_t)v[1].i;
+  poller_add_common(v, &config, 2, argc);
+}
+
+/**
+ * @brief Polls the die temperature (millidegrees Celsius)
+ *
+ * @details Poller.temperature(period_ms, delta = 0)
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_poller_temperature(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Poller);
+  poller_config_t config = {.source = kPollerSourceTemp};
+  poller_add_common(v, &config, 1, argc);
+}
+
+/**
+ * @brief Polls an I2C register (unsigned, big-endian)
+ *
+ * @details Poller.i2c(device, register, size, period_ms, delta = 0)
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_poller_i2c(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Poller);
+  poller_config_t config = {.source = kPollerSourceI2c};
+  SET_NIL_RETURN();
+  if ((3 > argc) || (false == api_i2c_target_get(&v[1], &config.i2c)) ||
+      (MRBC_TT_INTEGER != v[2].tt) || (MRBC_TT_INTEGER != v[3].tt)) {
+    return;
+  }
+  config.reg = (uint16_t)v[2].i;
+  config.size = (uint8_t)v[3].i;
+  poller_add_common(v, &config, 4, argc);
+}
+
+/**
+ * @brief Reports only threshold crossings of a poller
+ *
+ * @details Poller.threshold(id, level, hysteresis = 0)
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_poller_threshold(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Poller);
+  SET_FALSE_RETURN();
+  if ((2 > argc) || (MRBC_TT_INTEGER != v[1].tt) ||
+      (MRBC_TT_INTEGER != v[2].tt) ||
+      ((3 <= argc) && (MRBC_TT_INTEGER != v[3].tt))) {
+    return;
+  }
+  const int32_t kHysteresis = (3 <= argc) ? (int32_t)v[3].i : 0;
+  if (kSuccess == poller_set_filter((uint8_t)v[1].i, kPollerFilterThreshold,
+                                    (int32_t)v[2].i, kHysteresis)) {
+    SET_TRUE_RETURN();
+  }
+}
+
+/**
+ * @brief Removes a poller
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_poller_remove(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Poller);
+  SET_FALSE_RETURN();
+  if ((1 > argc) || (MRBC_TT_INTEGER != v[1].tt)) {
+    return;
+  }
+  if (kSuccess == poller_remove((uint8_t)v[1].i)) {
+    SET_TRUE_RETURN();
+  }
+}
+
+/**
+ * @brief Takes the oldest event
+ *
+ * @details Returns [id, value], or nil if no event is queued
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_poller_get(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Poller);
+  poller_event_t event;
+  SET_NIL_RETURN();
+  if (false == poller_get(&event)) {
+    return;
+  }
+  mrb_value ret = mrbc_array_new(vm, 2);
+  mrb_value id = mrbc_integer_value(event.id);
+  mrb_value value = mrbc_integer_value(event.value);
+  mrbc_array_set(&ret, 0, &id);
+  mrbc_array_set(&ret, 1, &value);
+  SET_RETURN(ret);
+}
+
+/**
+ * @brief Suspends the calling task until an event is queued
+ *
+ * @details Poller.wait(timeout_ms = 0); 0 waits forever. Returns at once if
+ * an event is already queued or another task is waiting. The task is
+ * suspended before it is published as the waiter, so a wake-up cannot be
+ * lost.
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_poller_wait(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Poller);
+  mrbc_tcb *const tcb = MRBC_VM2TCB(vm);
+  SET_NIL_RETURN();
+  if ((1 <= argc) && ((MRBC_TT_INTEGER != v[1].tt) || (0 > v[1].i))) {
+    return;
+  }
+  const mrbc_int_t kTimeoutMs = (1 <= argc) ? v[1].i : 0;
+  if (0U < poller_pending()) {
+    return;
+  }
+
+  mrbc_suspend_task(tcb);
+  if (!atomic_ptr_cas(&waiter, NULL, tcb)) {
+    mrbc_resume_task(tcb);  // another task is already waiting
+    return;
+  }
+  if (0U < poller_pending()) {
+    poller_wake();  // an event arrived before the waiter was published
+    return;
+  }
+  if (0 < kTimeoutMs) {
+    k_work_reschedule(&work_poller_timeout, K_MSEC(kTimeoutMs));
+  }
+}
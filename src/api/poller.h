@@ -0,0 +1,29 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file poller.h
+ * @brief Poller API for mruby/c
+ * @details Defines the Poller class and methods for mruby/c scripts
+ */
+#ifndef API_POLLER_H
+#define API_POLLER_H
+
+#include "../lib/fn.h"
+
+/**
+ * @brief Defines the Poller class and methods for mruby/c
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t api_poller_define(void);
+
+/**
+ * @brief Removes all pollers and releases a waiting task
+ *
+ * @details Call from the VM thread after mrbc_run() returns
+ */
+void api_poller_stop(void);
+
+#endif
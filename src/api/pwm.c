@@ -9,9 +9,13 @@
  */
 #include "pwm.h"
 
+#include <stddef.h>
+#include <stdint.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
 
 #include "../../mrubyc/src/mrubyc.h"
+#include "../app/profiler.h"
 #include "../drv/pwm.h"
 #include "../lib/fn.h"
 #include "api.h"
@@ -23,6 +27,14 @@ LOG_MODULE_REGISTER(api_pwm, LOG_LEVEL_DBG);
  * @brief Forward declarations for PWM methods
  */
 static void c_set_pwm(mrb_vm *vm, mrb_value *v, int argc);
+static void c_pwm_set_permille(mrb_vm *vm, mrb_value *v, int argc);
+static void c_pwm_set_ns(mrb_vm *vm, mrb_value *v, int argc);
+static void c_pwm_sequence(mrb_vm *vm, mrb_value *v, int argc);
+static void c_pwm_stop_sequence(mrb_vm *vm, mrb_value *v, int argc);
+static void c_pwm_sequence_running(mrb_vm *vm, mrb_value *v, int argc);
+
+/** @brief Duty table of PWM.sequence (VM thread only) */
+static uint16_t seq_duty[DRV_PWM_SEQ_MAX_STEPS * DRV_PWM_SEQ_CHANNELS];
 
 /**
  * @brief Defines the PWM class and methods for mruby/c
@@ -33,6 +45,12 @@ fn_t api_pwm_define(void) {
   mrb_class *class_pwm;
   class_pwm = mrbc_define_class(0, "PWM", mrbc_class_object);
   mrbc_define_method(0, class_pwm, "set", c_set_pwm);
+  mrbc_define_method(0, class_pwm, "set_permille", c_pwm_set_permille);
+  mrbc_define_method(0, class_pwm, "set_ns", c_pwm_set_ns);
+  mrbc_define_method(0, class_pwm, "sequence", c_pwm_sequence);
+  mrbc_define_method(0, class_pwm, "stop_sequence", c_pwm_stop_sequence);
+  mrbc_define_method(0, class_pwm, "sequence_running?",
+                     c_pwm_sequence_running);
   return kSuccess;
 }
 
@@ -44,11 +62,150 @@ fn_t api_pwm_define(void) {
  * @param argc The argument count
  */
 static void c_set_pwm(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Pwm);
   SET_FALSE_RETURN();
   if ((true == MRBC_ISNUMERIC(v[1])) && (true == MRBC_ISNUMERIC(v[2]))) {
-    if (kSuccess ==
-        drv_pwm_set((uint32_t)GET_INT_ARG(1), (uint8_t)GET_INT_ARG(2))) {
+    const mrbc_int_t kHz = GET_INT_ARG(1);
+    const mrbc_int_t kDuty = GET_INT_ARG(2);
+    if ((0 > kHz) || (0 > kDuty) || (100 < kDuty)) {
+      return;
+    }
+    if (kSuccess == drv_pwm_set((uint32_t)kHz, (uint8_t)kDuty)) {
       SET_TRUE_RETURN();
     }
   }
 }
+
+/**
+ * @brief Sets the PWM frequency and duty cycle in permille
+ *
+ * @details PWM.set_permille(hz, permille)
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_pwm_set_permille(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Pwm);
+  SET_FALSE_RETURN();
+  if ((2 > argc) || (MRBC_TT_INTEGER != v[1].tt) ||
+      (MRBC_TT_INTEGER != v[2].tt) || (0 > v[1].i) || (0 > v[2].i) ||
+      (1000 < v[2].i)) {
+    return;
+  }
+  if (kSuccess == drv_pwm_set_permille((uint32_t)v[1].i, (uint16_t)v[2].i)) {
+    SET_TRUE_RETURN();
+  }
+}
+
+/**
+ * @brief Sets the PWM period and pulse width in nanoseconds
+ *
+ * @details PWM.set_ns(period_ns, pulse_ns)
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_pwm_set_ns(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Pwm);
+  SET_FALSE_RETURN();
+  if ((2 > argc) || (MRBC_TT_INTEGER != v[1].tt) ||
+      (MRBC_TT_INTEGER != v[2].tt) || (0 > v[2].i) || (v[1].i < v[2].i)) {
+    return;
+  }
+  if (kSuccess == drv_pwm_set_ns((uint32_t)v[1].i, (uint32_t)v[2].i)) {
+    SET_TRUE_RETURN();
+  }
+}
+
+/**
+ * @brief Plays a duty cycle table in hardware
+ *
+ * @details PWM.sequence(pins, hz, table, step_periods = 1, loops = 0).
+ * pins is an Array of up to 4 pin numbers (port * 32 + pin); table holds the
+ * duty in permille, one value per pin for each step.
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_pwm_sequence(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Pwm);
+  drv_pwm_seq_t seq = {.duty = seq_duty, .step_periods = 1U, .loops = 0U};
+  SET_FALSE_RETURN();
+  if ((3 > argc) || (MRBC_TT_ARRAY != v[1].tt) ||
+      (MRBC_TT_INTEGER != v[2].tt) || (MRBC_TT_ARRAY != v[3].tt) ||
+      ((4 <= argc) && (MRBC_TT_INTEGER != v[4].tt)) ||
+      ((5 <= argc) && (MRBC_TT_INTEGER != v[5].tt))) {
+    return;
+  }
+  const mrbc_array *const kPins = v[1].array;
+  const mrbc_array *const kTable = v[3].array;
+  if ((0 == kPins->n_stored) || (DRV_PWM_SEQ_CHANNELS < kPins->n_stored) ||
+      (0 == kTable->n_stored) || (ARRAY_SIZE(seq_duty) < kTable->n_stored) ||
+      (0 != (kTable->n_stored % kPins->n_stored)) || (0 > v[2].i) ||
+      ((4 <= argc) && (0 >= v[4].i)) ||
+      ((5 <= argc) && ((0 > v[5].i) || (UINT16_MAX < v[5].i)))) {
+    return;
+  }
+
+  seq.num_pins = kPins->n_stored;
+  for (size_t i = 0; seq.num_pins > i; i++) {
+    if ((MRBC_TT_INTEGER != kPins->data[i].tt) || (0 > kPins->data[i].i) ||
+        (UINT8_MAX < kPins->data[i].i)) {
+      return;
+    }
+    seq.pins[i] = (uint8_t)kPins->data[i].i;
+  }
+  for (size_t i = 0; kTable->n_stored > i; i++) {
+    if ((MRBC_TT_INTEGER != kTable->data[i].tt) || (0 > kTable->data[i].i) ||
+        (1000 < kTable->data[i].i)) {
+      return;
+    }
+    seq_duty[i] = (uint16_t)kTable->data[i].i;
+  }
+  seq.hz = (uint32_t)v[2].i;
+  seq.num_steps = kTable->n_stored / seq.num_pins;
+  if (4 <= argc) {
+    seq.step_periods = (uint32_t)v[4].i;
+  }
+  if (5 <= argc) {
+    seq.loops = (uint16_t)v[5].i;
+  }
+  if (kSuccess == drv_pwm_seq_play(&seq)) {
+    SET_TRUE_RETURN();
+  }
+}
+
+/**
+ * @brief Stops the sequence player
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_pwm_stop_sequence(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Pwm);
+  if (kSuccess == drv_pwm_seq_stop()) {
+    SET_TRUE_RETURN();
+  } else {
+    SET_FALSE_RETURN();
+  }
+}
+
+/**
+ * @brief Checks whether a sequence is playing
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_pwm_sequence_running(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Pwm);
+  if (true == drv_pwm_seq_is_running()) {
+    SET_TRUE_RETURN();
+  } else {
+    SET_FALSE_RETURN();
+  }
+}
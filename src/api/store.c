@@ -0,0 +1,182 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file store.c
+ * @brief Implementation of Store API for mruby/c
+ * @details Implements the Store class and methods for mruby/c scripts to keep
+ * small values across reloads and reboots
+ */
+#include "store.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+
+#include "../../mrubyc/src/mrubyc.h"
+#include "../app/profiler.h"
+#include "../app/store.h"
+#include "../lib/fn.h"
+
+LOG_MODULE_REGISTER(api_store, LOG_LEVEL_DBG);
+
+/**
+ * @brief Forward declarations for Store methods
+ */
+static void c_store_get(mrb_vm *vm, mrb_value *v, int argc);
+static void c_store_set(mrb_vm *vm, mrb_value *v, int argc);
+static void c_store_delete(mrb_vm *vm, mrb_value *v, int argc);
+static void c_store_commit(mrb_vm *vm, mrb_value *v, int argc);
+
+/**
+ * @brief Defines the Store class and methods for mruby/c
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t api_store_define(void) {
+  mrb_class *class_store;
+  class_store = mrbc_define_class(0, "Store", mrbc_class_object);
+  mrbc_define_method(0, class_store, "get", c_store_get);
+  mrbc_define_method(0, class_store, "set", c_store_set);
+  mrbc_define_method(0, class_store, "delete", c_store_delete);
+  mrbc_define_method(0, class_store, "commit", c_store_commit);
+  return kSuccess;
+}
+
+/**
+ * @brief Copies a key argument (String or Symbol) into a C string
+ *
+ * @param kValue The key argument
+ * @param key Destination buffer of STORE_KEY_MAX_LENGTH + 1 bytes
+ * @return fn_t kSuccess if the argument is a key of valid length, kFailure
+ * otherwise
+ */
+static fn_t get_key(const mrb_value *const kValue, char *const key) {
+  const char *str = NULL;
+  size_t len = 0U;
+
+  if (MRBC_TT_STRING == kValue->tt) {
+    str = (const char *)kValue->string->data;
+    len = kValue->string->size;
+  } else if (MRBC_TT_SYMBOL == kValue->tt) {
+    str = mrbc_symid_to_str(kValue->i);
+    len = (NULL != str) ? strlen(str) : 0U;
+  }
+  if ((NULL == str) || (0U == len) || (STORE_KEY_MAX_LENGTH < len)) {
+    return kFailure;
+  }
+  memcpy(key, str, len);
+  key[len] = '\0';
+  return kSuccess;
+}
+
+/**
+ * @brief Gets a stored value
+ *
+ * @details Returns an Integer or a String, or nil if the key does not exist
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_store_get(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Store);
+  char key[STORE_KEY_MAX_LENGTH + 1U] = {0};
+  uint8_t data[STORE_VALUE_MAX_SIZE] = {0U};
+  store_type_t type = kStoreTypeNum;
+  SET_NIL_RETURN();
+
+  if ((1 > argc) || (kSuccess != get_key(&v[1], key))) {
+    return;
+  }
+  const ssize_t kSize = store_get(key, &type, data, sizeof(data));
+  if (0 > kSize) {
+    return;
+  }
+
+  switch (type) {
+    case kStoreTypeInteger: {
+      int32_t value = 0;
+      if (sizeof(value) == kSize) {
+        memcpy(&value, data, sizeof(value));
+        SET_INT_RETURN(value);
+      }
+    } break;
+    case kStoreTypeString: {
+      mrb_value ret = mrbc_string_new(vm, data, (int)kSize);
+      SET_RETURN(ret);
+    } break;
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief Stores a value (Integer or String of up to STORE_VALUE_MAX_SIZE
+ * bytes)
+ *
+ * @details The value is committed to flash in a batch a few seconds later
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_store_set(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Store);
+  char key[STORE_KEY_MAX_LENGTH + 1U] = {0};
+  fn_t ret = kFailure;
+  SET_FALSE_RETURN();
+
+  if ((2 > argc) || (kSuccess != get_key(&v[1], key))) {
+    return;
+  }
+  if (MRBC_TT_INTEGER == v[2].tt) {
+    const int32_t kValue = (int32_t)GET_INT_ARG(2);
+    ret = store_set(key, kStoreTypeInteger, (const uint8_t *)&kValue,
+                    sizeof(kValue));
+  } else if (MRBC_TT_STRING == v[2].tt) {
+    ret = store_set(key, kStoreTypeString, v[2].string->data,
+                    (size_t)v[2].string->size);
+  }
+  if (kSuccess == ret) {
+    SET_TRUE_RETURN();
+  }
+}
+
+/**
+ * @brief Deletes a stored value
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_store_delete(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Store);
+  char key[STORE_KEY_MAX_LENGTH + 1U] = {0};
+  SET_FALSE_RETURN();
+
+  if ((1 > argc) || (kSuccess != get_key(&v[1], key))) {
+    return;
+  }
+  if (kSuccess == store_delete(key)) {
+    SET_TRUE_RETURN();
+  }
+}
+
+/**
+ * @brief Commits pending changes to flash immediately
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_store_commit(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Store);
+  if (kSuccess == store_flush()) {
+    SET_TRUE_RETURN();
+  } else {
+    SET_FALSE_RETURN();
+  }
+}
@@ -0,0 +1,22 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file store.h
+ * @brief Store API for mruby/c
+ * @details Defines the Store class and methods for mruby/c scripts
+ */
+#ifndef API_STORE_H
+#define API_STORE_H
+
+#include "../lib/fn.h"
+
+/**
+ * @brief Defines the Store class and methods for mruby/c
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t api_store_define(void);
+
+#endif
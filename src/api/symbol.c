@@ -9,17 +9,45 @@
  */
 #include "symbol.h"
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 #include "../../mrubyc/src/mrubyc.h"
+#include "../drv/gpio.h"
 #include "../lib/fn.h"
+#include "api.h"
+
+/**
+ * @brief Pin registry entry
+ */
+typedef struct {
+  const char *name; /**< Symbol name */
+  drv_gpio_t pin;   /**< Pin */
+  uint8_t perm;     /**< symbol_pin_perm_t bits */
+} symbol_pin_t;
+
+/** @brief Pin registry, indexed by symbol_t */
+static const symbol_pin_t kPins[kSymbolTSize] = {
+#define API_SYMBOL_PIN(name, pin, perm) \
+  [kSymbol##pin] = {#name, kDrvGpio##pin, (perm)},
+    API_SYMBOL_PINS(API_SYMBOL_PIN)
+#undef API_SYMBOL_PIN
+};
 
 /**
  * @brief Table to store symbol IDs for each symbol in the enum
  */
 static int16_t symbol_id_table[kSymbolTSize];
 
+/**
+ * @brief symbol_t of each mruby/c symbol ID, -1 if not a pin
+ *
+ * @details Turns pin lookups into one array access instead of a comparison
+ * per pin
+ */
+static int8_t symbol_pin_table[MAX_SYMBOLS_COUNT];
+
 /**
  * @brief Registers a symbol with mruby/c and stores its ID
  *
@@ -39,6 +67,9 @@ fn_t api_symbol_init(void) {
   for (size_t i = 0; i < kSymbolTSize; i++) {
     symbol_id_table[i] = -1;
   }
+  for (size_t i = 0; i < MAX_SYMBOLS_COUNT; i++) {
+    symbol_pin_table[i] = -1;
+  }
   return kSuccess;
 }
 
@@ -52,17 +83,17 @@ fn_t api_symbol_init(void) {
  * otherwise
  */
 fn_t api_symbol_define(void) {
-  symbol_regist("led1", kSymbolLED1);
-  symbol_regist("led2", kSymbolLED2);
-  symbol_regist("led3", kSymbolLED3);
-  symbol_regist("sw1", kSymbolSW1);
-  symbol_regist("sw2", kSymbolSW2);
-  symbol_regist("sw3", kSymbolSW3);
-  symbol_regist("sw4", kSymbolSW4);
+  // Symbol IDs may differ from the previous VM run
+  (void)api_symbol_init();
   for (size_t i = 0; i < kSymbolTSize; i++) {
-    if (-1 == symbol_id_table[i]) {
+    symbol_regist(kPins[i].name, (symbol_t)i);
+  }
+  for (size_t i = 0; i < kSymbolTSize; i++) {
+    if ((0 > symbol_id_table[i]) ||
+        (MAX_SYMBOLS_COUNT <= symbol_id_table[i])) {
       return kFailure;
     }
+    symbol_pin_table[symbol_id_table[i]] = (int8_t)i;
   }
   return kSuccess;
 }
@@ -81,6 +112,32 @@ int16_t api_symbol_get_id(const symbol_t kSymbol) {
   }
 }
 
+/**
+ * @brief Resolves a pin symbol by its mruby/c symbol ID
+ *
+ * @param kVmId VM ID of the calling task
+ * @param kSymId mruby/c symbol ID
+ * @param kPerm Required permissions (kSymbolPinRead, kSymbolPinWrite)
+ * @param pin Resolved pin
+ * @return true if the symbol is a pin with the permissions and the task may
+ * use it
+ */
+bool api_symbol_pin_get(const uint8_t kVmId, const int16_t kSymId,
+                        const uint8_t kPerm, drv_gpio_t *const pin) {
+  if ((0 > kSymId) || (MAX_SYMBOLS_COUNT <= kSymId) ||
+      (0 > symbol_pin_table[kSymId])) {
+    return false;
+  }
+  const symbol_pin_t *const kPin = &kPins[symbol_pin_table[kSymId]];
+  if ((kPerm != (kPin->perm & kPerm)) ||
+      ((0U != (kPin->perm & kSymbolPinSystem)) &&
+       (kSuccess != api_api_check_systemtask(kVmId)))) {
+    return false;
+  }
+  *pin = kPin->pin;
+  return true;
+}
+
 /**
  * @brief Registers a symbol with mruby/c and stores its ID
  *
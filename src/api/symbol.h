@@ -6,27 +6,50 @@
  * @file symbol.h
  * @brief Symbol definitions for mruby/c
  * @details Defines symbols used for LED and button identifiers in mruby/c
- * scripts
+ * scripts, and the pin registry that resolves them by symbol ID
  */
 #ifndef API_SYMBOL_H
 #define API_SYMBOL_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include "../drv/gpio.h"
 #include "../lib/fn.h"
 
+/**
+ * @typedef symbol_pin_perm_t
+ * @brief Permission bits of a pin symbol
+ */
+typedef enum {
+  kSymbolPinRead = 0x01U,   /**< Readable (Input) */
+  kSymbolPinWrite = 0x02U,  /**< Writable (LED) */
+  kSymbolPinSystem = 0x04U, /**< System task only */
+} symbol_pin_perm_t;
+
+/**
+ * @brief Pin symbols as X(name, drv_gpio_t name, permissions)
+ *
+ * @details The symbol enumeration and the pin registry are generated from
+ * this list; a new pin needs a line here and in DRV_GPIO_PINS
+ */
+#define API_SYMBOL_PINS(X)                          \
+  X(led1, LED1, kSymbolPinWrite)                    \
+  X(led2, LED2, kSymbolPinWrite)                    \
+  X(led3, LED3, kSymbolPinWrite | kSymbolPinSystem) \
+  X(sw1, SW1, kSymbolPinRead)                       \
+  X(sw2, SW2, kSymbolPinRead)                       \
+  X(sw3, SW3, kSymbolPinRead)                       \
+  X(sw4, SW4, kSymbolPinRead)
+
 /**
  * @typedef symbol_t
  * @brief Enumeration of symbols used in the API
  */
 typedef enum {
-  kSymbolLED1, /**< Symbol for LED1 */
-  kSymbolLED2, /**< Symbol for LED2 */
-  kSymbolLED3, /**< Symbol for LED3 */
-  kSymbolSW1,  /**< Symbol for switch/button 1 */
-  kSymbolSW2,  /**< Symbol for switch/button 2 */
-  kSymbolSW3,  /**< Symbol for switch/button 3 */
-  kSymbolSW4,  /**< Symbol for switch/button 4 */
+#define API_SYMBOL_ENUM(name, pin, perm) kSymbol##pin,
+  API_SYMBOL_PINS(API_SYMBOL_ENUM)
+#undef API_SYMBOL_ENUM
   kSymbolTSize /**< Total number of symbols (enum size) */
 } symbol_t;
 
@@ -53,4 +76,17 @@ fn_t api_symbol_define(void);
  */
 int16_t api_symbol_get_id(const symbol_t kSymbol);
 
+/**
+ * @brief Resolves a pin symbol by its mruby/c symbol ID
+ *
+ * @param kVmId VM ID of the calling task
+ * @param kSymId mruby/c symbol ID
+ * @param kPerm Required permissions (kSymbolPinRead, kSymbolPinWrite)
+ * @param pin Resolved pin
+ * @return true if the symbol is a pin with the permissions and the task may
+ * use it
+ */
+bool api_symbol_pin_get(const uint8_t kVmId, const int16_t kSymId,
+                        const uint8_t kPerm, drv_gpio_t *const pin);
+
 #endif
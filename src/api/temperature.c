@@ -9,9 +9,11 @@
  */
 #include "temperature.h"
 
+#include <stdint.h>
 #include <zephyr/logging/log.h>
 
 #include "../../mrubyc/src/mrubyc.h"
+#include "../app/profiler.h"
 #include "../drv/hal/die_temperature.h"
 #include "../lib/fn.h"
 #include "api.h"
@@ -23,6 +25,9 @@ LOG_MODULE_REGISTER(api_temperature, LOG_LEVEL_DBG);
  * @brief Forward declaration for temperature methods
  */
 static void c_get_temp(mrb_vm *vm, mrb_value *v, int argc);
+static void c_get_temp_average(mrb_vm *vm, mrb_value *v, int argc);
+static void c_get_temp_age(mrb_vm *vm, mrb_value *v, int argc);
+static void c_set_temp_period(mrb_vm *vm, mrb_value *v, int argc);
 
 /**
  * @brief Defines the Temperature class and methods for mruby/c
@@ -33,16 +38,61 @@ fn_t api_temperature_define(void) {
   mrb_class *class_temp;
   class_temp = mrbc_define_class(0, "Temperature", mrbc_class_object);
   mrbc_define_method(0, class_temp, "value", c_get_temp);
+  mrbc_define_method(0, class_temp, "average", c_get_temp_average);
+  mrbc_define_method(0, class_temp, "age", c_get_temp_age);
+  mrbc_define_method(0, class_temp, "set_period", c_set_temp_period);
   return kSuccess;
 }
 
 /**
- * @brief Gets the current die temperature
+ * @brief Gets the latest cached die temperature
  *
  * @param vm The mruby/c VM instance
  * @param v The value array
  * @param argc The argument count
  */
 static void c_get_temp(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Temperature);
   SET_FLOAT_RETURN(hal_die_temperature_get());
 }
+
+/**
+ * @brief Gets the moving average of the die temperature
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_get_temp_average(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Temperature);
+  SET_FLOAT_RETURN(hal_die_temperature_get_average());
+}
+
+/**
+ * @brief Gets the age of the latest die temperature sample in milliseconds
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_get_temp_age(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Temperature);
+  SET_INT_RETURN((mrbc_int_t)hal_die_temperature_get_age());
+}
+
+/**
+ * @brief Sets the die temperature sampling period in milliseconds
+ *
+ * @param vm The mruby/c VM instance
+ * @param v The value array
+ * @param argc The argument count
+ */
+static void c_set_temp_period(mrb_vm *vm, mrb_value *v, int argc) {
+  PROFILER_SCOPE(Temperature);
+  SET_FALSE_RETURN();
+  if ((1 <= argc) && (MRBC_TT_INTEGER == v[1].tt) && (0 < GET_INT_ARG(1))) {
+    if (kSuccess == hal_die_temperature_set_period((uint32_t)GET_INT_ARG(1))) {
+      SET_TRUE_RETURN();
+    }
+  }
+}
@@ -16,6 +16,7 @@
 #include <zephyr/sys/crc.h>
 
 #include "../lib/fn.h"
+#include "counter.h"
 #include "lz4.h"
 #include "storage.h"
 
@@ -143,23 +144,13 @@ static storage_id_t slot_to_storageid(const blink_slot_t kSlot) {
 /**
  * @brief Increments the blink counter values
  *
- * @details Updates both trip and total blink counters in runtime settings
+ * @details Updates both trip and total blink counters in RAM; the total is
+ * persisted later by the counter subsystem
  */
 static void blink_countup(void) {
-  uint32_t tmp_trip = 0U;
-  uint32_t tmp_total = 0U;
-  settings_runtime_get("openblink/blink_count_trip", &tmp_trip,
-                       sizeof(tmp_trip));
-  settings_runtime_get("openblink/blink_count_total", &tmp_total,
-                       sizeof(tmp_total));
-
-  tmp_trip += (UINT32_MAX > tmp_trip) ? 1 : 0;
-  tmp_total += (UINT32_MAX > tmp_total) ? 1 : 0;
-
-  settings_runtime_set("openblink/blink_count_trip", &tmp_trip,
-                       sizeof(tmp_trip));
-  settings_runtime_set("openblink/blink_count_total", &tmp_total,
-                       sizeof(tmp_total));
-
-  LOG_DBG("blink_count_trip: %u, blink_count_total: %u", tmp_trip, tmp_total);
+  counter_increment(kCounterBlinkTrip);
+  counter_increment(kCounterBlinkTotal);
+
+  LOG_DBG("blink_count_trip: %u, blink_count_total: %u",
+          counter_get(kCounterBlinkTrip), counter_get(kCounterBlinkTotal));
 }
@@ -0,0 +1,142 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file boot_trace.c
+ * @brief Implementation of boot-time trace
+ * @details Keeps a fixed ring of (stage, uptime) pairs recorded during boot
+ * and exposes it over the log (RTT) and the Status characteristic
+ */
+#include "boot_trace.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "../lib/fn.h"
+
+LOG_MODULE_REGISTER(app_boot_trace, LOG_LEVEL_DBG);
+
+/**
+ * @brief Boot trace ring entry
+ */
+typedef struct {
+  uint8_t stage;    /**< boot_trace_stage_t */
+  uint32_t time_us; /**< Uptime in microseconds */
+} boot_trace_entry_t;
+
+/** @brief Ring of recorded boot stages */
+static boot_trace_entry_t ring[BOOT_TRACE_RING_SIZE];
+
+/** @brief Total number of marks recorded (ring position is count % size) */
+static atomic_t ring_count = ATOMIC_INIT(0);
+
+/** @brief Printable stage names, indexed by boot_trace_stage_t */
+static const char *const kStageName[kBootTraceStageNum] = {
+    [kBootTraceInitStart] = "init_start",
+    [kBootTraceWatchdog] = "watchdog",
+    [kBootTraceApiBlink] = "api_blink",
+    [kBootTraceStorage] = "storage",
+    [kBootTraceSettings] = "settings",
+    [kBootTraceFreeSpace] = "free_space",
+    [kBootTraceConfig] = "config",
+    [kBootTraceSymbol] = "symbol",
+    [kBootTraceI2c] = "i2c",
+    [kBootTraceGpio] = "gpio",
+    [kBootTraceAdc] = "adc",
+    [kBootTraceBtEnable] = "bt_enable",
+    [kBootTraceSettingsLoad] = "settings_load",
+    [kBootTraceBtReady] = "bt_ready",
+    [kBootTraceAdvertising] = "advertising",
+    [kBootTraceInitEnd] = "init_end",
+    [kBootTraceVmStart] = "vm_start",
+    [kBootTraceComm] = "comm",
+    [kBootTraceStore] = "store",
+    [kBootTraceTemperature] = "temperature",
+    [kBootTracePoller] = "poller",
+};
+
+/**
+ * @brief Records the current uptime for a boot stage
+ *
+ * @param kStage The stage that has just completed
+ * @return fn_t kSuccess if recorded, kFailure if the stage is invalid
+ */
+fn_t boot_trace_mark(const boot_trace_stage_t kStage) {
+  if (kBootTraceStageNum <= kStage) {
+    return kFailure;
+  }
+  const uint32_t kTimeUs = (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks());
+  const atomic_val_t kPos = atomic_inc(&ring_count);
+  boot_trace_entry_t *const entry = &ring[kPos % BOOT_TRACE_RING_SIZE];
+  entry->stage = (uint8_t)kStage;
+  entry->time_us = kTimeUs;
+  return kSuccess;
+}
+
+/**
+ * @brief Gets the index of the oldest entry and the number of valid entries
+ *
+ * @param count Number of valid entries in the ring
+ * @return size_t Ring index of the oldest entry
+ */
+static size_t ring_oldest(size_t *const count) {
+  const size_t kTotal = (size_t)atomic_get(&ring_count);
+  if (BOOT_TRACE_RING_SIZE >= kTotal) {
+    *count = kTotal;
+    return 0U;
+  }
+  *count = BOOT_TRACE_RING_SIZE;
+  return kTotal % BOOT_TRACE_RING_SIZE;
+}
+
+/**
+ * @brief Logs all recorded boot stages with absolute and delta times
+ */
+void boot_trace_dump(void) {
+  size_t count = 0U;
+  const size_t kOldest = ring_oldest(&count);
+  uint32_t prev_us = 0U;
+
+  LOG_INF("=== Boot trace (%u entries) ===", count);
+  for (size_t i = 0U; count > i; i++) {
+    const boot_trace_entry_t *const kEntry =
+        &ring[(kOldest + i) % BOOT_TRACE_RING_SIZE];
+    const uint32_t kDeltaUs = (0U == i) ? 0U : (kEntry->time_us - prev_us);
+    LOG_INF("%-14s %7u.%03u ms (+%u.%03u ms)",
+            (kBootTraceStageNum > kEntry->stage) ? kStageName[kEntry->stage]
+                                                 : "unknown",
+            kEntry->time_us / 1000U, kEntry->time_us % 1000U, kDeltaUs / 1000U,
+            kDeltaUs % 1000U);
+    prev_us = kEntry->time_us;
+  }
+}
+
+/**
+ * @brief Serializes the recorded boot stages in recording order
+ *
+ * @param buf Destination buffer
+ * @param kSize Size of the destination buffer
+ * @return size_t Number of bytes written
+ */
+size_t boot_trace_export(uint8_t *const buf, const size_t kSize) {
+  size_t count = 0U;
+  const size_t kOldest = ring_oldest(&count);
+  size_t len = 0U;
+
+  for (size_t i = 0U; count > i; i++) {
+    if (kSize < (len + BOOT_TRACE_ENTRY_SIZE)) {
+      break;
+    }
+    const boot_trace_entry_t *const kEntry =
+        &ring[(kOldest + i) % BOOT_TRACE_RING_SIZE];
+    buf[len] = kEntry->stage;
+    sys_put_le32(kEntry->time_us, &buf[len + 1U]);
+    len += BOOT_TRACE_ENTRY_SIZE;
+  }
+  return len;
+}
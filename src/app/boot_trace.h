@@ -0,0 +1,85 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file boot_trace.h
+ * @brief Boot-time trace interface
+ * @details Records a timestamp per initialization stage into a fixed ring so
+ * that time-to-first-advertisement can be broken down per subsystem
+ */
+#ifndef APP_BOOT_TRACE_H
+#define APP_BOOT_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../lib/fn.h"
+
+/**
+ * @brief Number of entries held in the boot trace ring
+ */
+#define BOOT_TRACE_RING_SIZE 32U
+
+/**
+ * @brief Size of one exported boot trace entry in bytes (stage + time_us)
+ */
+#define BOOT_TRACE_ENTRY_SIZE (1U + 4U)
+
+/**
+ * @typedef boot_trace_stage_t
+ * @brief Enumeration of traced boot stages
+ * @details The numeric values are part of the Status characteristic payload;
+ * append new stages at the end
+ */
+typedef enum {
+  kBootTraceInitStart,    /**< init_main() entered */
+  kBootTraceWatchdog,     /**< watchdog_init() done */
+  kBootTraceApiBlink,     /**< api_blink_init() done */
+  kBootTraceStorage,      /**< storage_init() done */
+  kBootTraceSettings,     /**< settings_subsys_init() done */
+  kBootTraceFreeSpace,    /**< storage_free_space() done */
+  kBootTraceConfig,       /**< config_init() done */
+  kBootTraceSymbol,       /**< api_symbol_init() done */
+  kBootTraceI2c,          /**< api_i2c_init() done */
+  kBootTraceGpio,         /**< drv_gpio_init() done */
+  kBootTraceAdc,          /**< drv_adc_init() done */
+  kBootTraceBtEnable,     /**< bt_enable() returned */
+  kBootTraceSettingsLoad, /**< Bluetooth settings loaded */
+  kBootTraceBtReady,      /**< Bluetooth ready callback received */
+  kBootTraceAdvertising,  /**< First advertising started */
+  kBootTraceInitEnd,      /**< All boot stages finished */
+  kBootTraceVmStart,      /**< First mrbc_run() entered */
+  kBootTraceComm,         /**< comm_init() done */
+  kBootTraceStore,        /**< store_init() done */
+  kBootTraceTemperature,  /**< hal_die_temperature_init() done */
+  kBootTracePoller,       /**< poller_init() done */
+  kBootTraceStageNum,     /**< Number of stages (not a stage) */
+} boot_trace_stage_t;
+
+/**
+ * @brief Records the current uptime for a boot stage
+ *
+ * @param kStage The stage that has just completed
+ * @return fn_t kSuccess if recorded, kFailure if the stage is invalid
+ */
+fn_t boot_trace_mark(const boot_trace_stage_t kStage);
+
+/**
+ * @brief Logs all recorded boot stages with absolute and delta times
+ */
+void boot_trace_dump(void);
+
+/**
+ * @brief Serializes the recorded boot stages in recording order
+ *
+ * @details Each entry is BOOT_TRACE_ENTRY_SIZE bytes: stage (uint8_t)
+ * followed by uptime in microseconds (uint32_t, little endian)
+ *
+ * @param buf Destination buffer
+ * @param kSize Size of the destination buffer
+ * @return size_t Number of bytes written
+ */
+size_t boot_trace_export(uint8_t *const buf, const size_t kSize);
+
+#endif  // APP_BOOT_TRACE_H
@@ -19,22 +19,118 @@
 #include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
 
 #include "../drv/ble.h"
 #include "../drv/ble_blink.h"
 #include "../lib/fn.h"
 #include "blink.h"
+#include "boot_trace.h"
 #include "init.h"
 #include "mrubyc_vm.h"
 
 LOG_MODULE_REGISTER(app_comm, LOG_LEVEL_DBG);
 
+/** @brief Status record tag: boot trace (see boot_trace_export) */
+#define COMM_STATUS_TAG_BOOT_TRACE 0x01U
+
+/** @brief Status record tag: VM heap statistics */
+#define COMM_STATUS_TAG_HEAP 0x02U
+
+/** @brief Size of a status record header (tag + length) in bytes */
+#define COMM_STATUS_RECORD_HEADER_SIZE 2U
+
+/** @brief Maximum payload length of a single status record */
+#define COMM_STATUS_RECORD_MAX_LENGTH UINT8_MAX
+
 /** @brief Flag indicating if BLE advertising is active */
 static volatile bool advertising = false;
 
 /** @brief Flag indicating if BLE is connected to a device */
 static volatile bool connected = false;
 
+/**
+ * @brief Encodes the VM heap statistics
+ *
+ * @details uint32_t little endian: total, used, free, largest free block,
+ * free blocks, peak, the allocations and the live blocks by size class, then
+ * the slab arena size and use
+ *
+ * @param buf Destination buffer
+ * @param kSize Size of the destination buffer
+ * @return size_t Number of bytes written, 0 if the buffer is too small
+ */
+static size_t comm_status_heap(uint8_t *const buf, const size_t kSize) {
+  mrubyc_vm_heap_stats_t stats;
+  app_mrubyc_vm_heap_stats(&stats);
+  const uint32_t kValues[] = {
+      stats.total,       stats.used, stats.free, stats.largest_free,
+      stats.free_blocks, stats.peak,
+  };
+  const uint32_t kSlab[] = {stats.slab_total, stats.slab_used};
+  const size_t kLength = sizeof(kValues) + sizeof(stats.allocs) +
+                         sizeof(stats.live) + sizeof(kSlab);
+  if (kSize < kLength) {
+    return 0U;
+  }
+  size_t len = 0U;
+  for (size_t i = 0; ARRAY_SIZE(kValues) > i; i++) {
+    sys_put_le32(kValues[i], &buf[len]);
+    len += sizeof(uint32_t);
+  }
+  for (size_t i = 0; MRUBYC_VM_HEAP_CLASSES > i; i++) {
+    sys_put_le32(stats.allocs[i], &buf[len]);
+    len += sizeof(uint32_t);
+  }
+  for (size_t i = 0; MRUBYC_VM_HEAP_CLASSES > i; i++) {
+    sys_put_le32(stats.live[i], &buf[len]);
+    len += sizeof(uint32_t);
+  }
+  for (size_t i = 0; ARRAY_SIZE(kSlab) > i; i++) {
+    sys_put_le32(kSlab[i], &buf[len]);
+    len += sizeof(uint32_t);
+  }
+  return len;
+}
+
+/**
+ * @brief Fills the extended status records for the Status characteristic
+ *
+ * @details Each record is encoded as tag (uint8_t), length (uint8_t) and
+ * length bytes of payload
+ *
+ * @param buf Destination buffer
+ * @param kSize Size of the destination buffer
+ * @return size_t Number of bytes written
+ */
+static size_t comm_status_fill(uint8_t *const buf, const size_t kSize) {
+  static const struct {
+    uint8_t tag;
+    size_t (*fill)(uint8_t *const buf, const size_t kSize);
+  } kRecords[] = {
+      {COMM_STATUS_TAG_BOOT_TRACE, boot_trace_export},
+      {COMM_STATUS_TAG_HEAP, comm_status_heap},
+  };
+  size_t len = 0U;
+
+  for (size_t i = 0; ARRAY_SIZE(kRecords) > i; i++) {
+    if (COMM_STATUS_RECORD_HEADER_SIZE >= (kSize - len)) {
+      break;
+    }
+    uint8_t *const record = &buf[len];
+    const size_t kPayload = kRecords[i].fill(
+        &record[COMM_STATUS_RECORD_HEADER_SIZE],
+        MIN(kSize - len - COMM_STATUS_RECORD_HEADER_SIZE,
+            COMM_STATUS_RECORD_MAX_LENGTH));
+    record[0] = kRecords[i].tag;
+    record[1] = (uint8_t)kPayload;
+    len += COMM_STATUS_RECORD_HEADER_SIZE + kPayload;
+  }
+
+  return len;
+}
+
 /**
  * @brief BLE event callback function
  *
@@ -86,6 +182,8 @@ static int ble_event_cb(BLE_PARAM *param) {
 
     case BLE_EVENT_STATUS:
       param->status.mtu = ble_get_mtu();
+      param->status.size =
+          comm_status_fill(param->status.data, param->status.size);
       break;
 
     case BLE_EVENT_RELOAD:
@@ -125,7 +223,9 @@ fn_t comm_init(void) {
   // Start Advertising
   const char *name = bt_get_name();
   LOG_DBG("COMM: Start advertising (%s)", name);
-  ble_start_advertising(name);
+  if (0 == ble_start_advertising(name)) {
+    boot_trace_mark(kBootTraceAdvertising);
+  }
   advertising = true;
 
   return ret;
@@ -5,20 +5,77 @@
 /**
  * @file config.c
  * @brief Implementation of configuration management
- * @details Implements functions for managing device configuration settings
+ * @details Implements functions for managing device configuration settings.
+ * Keys are described by the kConfigDesc table and looked up by binary search
+ * in an index sorted by name, so get/set cost grows only with the logarithm
+ * of the number of keys.
  */
 #include "config.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/settings/settings.h>
+#include <zephyr/sys/util.h>
 
 #include "../lib/fn.h"
+#include "counter.h"
 
 LOG_MODULE_REGISTER(app_config, LOG_LEVEL_WRN);
 
+/** @brief Settings subtree handled by this module */
+#define APP_CONFIG_SUBTREE "openblink"
+
+/**
+ * @typedef config_type_t
+ * @brief Enumeration of configuration value types
+ */
+typedef enum {
+  kConfigTypeU32,     /**< uint32_t variable */
+  kConfigTypeCounter, /**< Counter owned by the counter module */
+} config_type_t;
+
+/**
+ * @brief Configuration key descriptor
+ */
+typedef struct {
+  const char *name;   /**< Key name below APP_CONFIG_SUBTREE */
+  config_type_t type; /**< Value type */
+  bool persistent;    /**< Exported to settings_storage */
+  union {
+    uint32_t *u32;        /**< kConfigTypeU32: backing variable */
+    counter_id_t counter; /**< kConfigTypeCounter: counter identifier */
+  } ref;
+} config_desc_t;
+
+/** @brief Configuration keys */
+static const config_desc_t kConfigDesc[] = {
+    {.name = "blink_count_trip",
+     .type = kConfigTypeCounter,
+     .persistent = false,
+     .ref.counter = kCounterBlinkTrip},
+    {.name = "blink_count_total",
+     .type = kConfigTypeCounter,
+     .persistent = true,
+     .ref.counter = kCounterBlinkTotal},
+};
+
+/** @brief Key index: kConfigDesc entries sorted by name */
+static const config_desc_t *config_index[ARRAY_SIZE(kConfigDesc)];
+
+/**
+ * @brief Key searched in the key index
+ */
+typedef struct {
+  const char *name; /**< Key name, not terminated */
+  size_t length;    /**< Length of the key name */
+} config_key_t;
+
 /**
  * @brief Handles get requests for configuration settings
  *
@@ -50,14 +107,125 @@ int config_handle_set(const char *name, size_t len, settings_read_cb read_cb,
 int config_handle_export(int (*cb)(const char *name, const void *value,
                                    size_t val_len));
 
-struct settings_handler config_handler = {.name = "openblink",
+struct settings_handler config_handler = {.name = APP_CONFIG_SUBTREE,
                                           .h_get = config_handle_get,
                                           .h_set = config_handle_set,
                                           .h_commit = NULL,
                                           .h_export = config_handle_export};
 
-static uint32_t blink_count_trip;        // volatile
-static uint32_t blink_count_total = 0U;  // non-volatile
+/**
+ * @brief Orders two entries of the key index by name
+ *
+ * @param kLeft Entry of the key index
+ * @param kRight Entry of the key index
+ * @return int Negative, 0 or positive like strcmp()
+ */
+static int config_index_compare(const void *const kLeft,
+                                const void *const kRight) {
+  const config_desc_t *const kDescLeft = *(const config_desc_t *const *)kLeft;
+  const config_desc_t *const kDescRight =
+      *(const config_desc_t *const *)kRight;
+  return strcmp(kDescLeft->name, kDescRight->name);
+}
+
+/**
+ * @brief Compares a key with an entry of the key index
+ *
+ * @param kKey Key (config_key_t)
+ * @param kEntry Entry of the key index
+ * @return int Negative, 0 or positive like strcmp()
+ */
+static int config_key_compare(const void *const kKey,
+                              const void *const kEntry) {
+  const config_key_t *const kSearch = (const config_key_t *)kKey;
+  const config_desc_t *const kDesc = *(const config_desc_t *const *)kEntry;
+  const int kOrder = strncmp(kSearch->name, kDesc->name, kSearch->length);
+  if (0 != kOrder) {
+    return kOrder;
+  }
+  // The key is a prefix of the entry name, so it sorts first
+  return ('\0' == kDesc->name[kSearch->length]) ? 0 : -1;
+}
+
+/**
+ * @brief Builds the key index
+ *
+ * @details Sorts the descriptors by name; duplicate names are rejected
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+static fn_t config_build_index(void) {
+  for (size_t i = 0; ARRAY_SIZE(kConfigDesc) > i; i++) {
+    config_index[i] = &kConfigDesc[i];
+  }
+  qsort(config_index, ARRAY_SIZE(config_index), sizeof(config_index[0]),
+        config_index_compare);
+  for (size_t i = 1; ARRAY_SIZE(config_index) > i; i++) {
+    if (0 == config_index_compare(&config_index[i - 1], &config_index[i])) {
+      LOG_ERR("Duplicate configuration key %s", config_index[i]->name);
+      return kFailure;
+    }
+  }
+  return kSuccess;
+}
+
+/**
+ * @brief Looks up the descriptor of a key
+ *
+ * @param kName Key name (may be followed by further path components)
+ * @return const config_desc_t* Descriptor, or NULL if the key is unknown
+ */
+static const config_desc_t *config_lookup(const char *const kName) {
+  const char *next;
+  const config_key_t kKey = {
+      .name = kName,
+      .length = (size_t)settings_name_next(kName, &next),
+  };
+  if ((NULL != next) || (0U == kKey.length)) {
+    return NULL;
+  }
+  const config_desc_t *const *const kEntry =
+      bsearch(&kKey, config_index, ARRAY_SIZE(config_index),
+              sizeof(config_index[0]), config_key_compare);
+  return (NULL != kEntry) ? *kEntry : NULL;
+}
+
+/**
+ * @brief Gets the current value of a key
+ *
+ * @param kDesc Key descriptor
+ * @return uint32_t Current value
+ */
+static uint32_t config_value_get(const config_desc_t *const kDesc) {
+  switch (kDesc->type) {
+    case kConfigTypeU32:
+      return *kDesc->ref.u32;
+    case kConfigTypeCounter:
+      return counter_get(kDesc->ref.counter);
+    default:
+      return 0U;
+  }
+}
+
+/**
+ * @brief Sets a key to a value loaded from settings_storage
+ *
+ * @param kDesc Key descriptor
+ * @param kValue Loaded value
+ */
+static void config_value_restore(const config_desc_t *const kDesc,
+                                 const uint32_t kValue) {
+  switch (kDesc->type) {
+    case kConfigTypeU32:
+      *kDesc->ref.u32 = kValue;
+      break;
+    case kConfigTypeCounter:
+      (void)counter_restore(kDesc->ref.counter, kValue);
+      break;
+    default:
+      break;
+  }
+}
 
 /**
  * @brief Initializes the configuration subsystem
@@ -68,12 +236,13 @@ fn_t config_init(void) {
   static bool is_initialized = false;
   int ret;
 
-  // Set initial value
-  blink_count_trip = 0U;
-
   if (false == is_initialized) {
     is_initialized = true;
 
+    if (kSuccess != config_build_index()) {
+      return kFailure;
+    }
+
     // register settings handler
     ret = settings_register(&config_handler);
     if (0 != ret) {
@@ -81,11 +250,14 @@ fn_t config_init(void) {
       return kFailure;
     }
 
-    // load from non-volatile storage
-    ret = settings_load_subtree("openblink");
+    // load from non-volatile storage; the user keys go to the store
+    // handler registered by store_init()
+    int64_t timestamp = k_uptime_get();
+    ret = settings_load_subtree(APP_CONFIG_SUBTREE);
     if (0 != ret) {
       LOG_ERR("Failed to load settings subtree openblink ret:%d", ret);
     }
+    LOG_DBG("settings_load_subtree: %lli ms", k_uptime_delta(&timestamp));
   }
 
   return kSuccess;
@@ -100,25 +272,17 @@ fn_t config_init(void) {
  * @return int Number of bytes written to val, or negative on error
  */
 int config_handle_get(const char *name, char *val, int val_len_max) {
-  const char *next;
-  char tmp_32[4];
+  const config_desc_t *const kDesc = config_lookup(name);
 
   LOG_DBG("Config Get: %s", name);
 
-  if (settings_name_steq(name, "blink_count_trip", &next) && !next) {
-    memcpy(tmp_32, &blink_count_trip, sizeof(tmp_32));
-    val_len_max = MIN(val_len_max, sizeof(tmp_32));
-    memcpy(val, tmp_32, val_len_max);
-    return val_len_max;
+  if (NULL == kDesc) {
+    return -ENOENT;
   }
-  if (settings_name_steq(name, "blink_count_total", &next) && !next) {
-    memcpy(tmp_32, &blink_count_total, sizeof(tmp_32));
-    val_len_max = MIN(val_len_max, sizeof(tmp_32));
-    memcpy(val, tmp_32, val_len_max);
-    return val_len_max;
-  }
-
-  return -ENOENT;
+  const uint32_t kValue = config_value_get(kDesc);
+  val_len_max = MIN(val_len_max, sizeof(kValue));
+  memcpy(val, &kValue, val_len_max);
+  return val_len_max;
 }
 
 /**
@@ -132,41 +296,44 @@ int config_handle_get(const char *name, char *val, int val_len_max) {
  */
 int config_handle_set(const char *name, size_t len, settings_read_cb read_cb,
                       void *cb_arg) {
-  const char *next;
-  const size_t kNameLen = settings_name_next(name, &next);
-
-  if (!next) {
-    LOG_DBG("Config Set: %s", name);
+  const config_desc_t *const kDesc = config_lookup(name);
+  uint32_t tmp_32 = 0U;
 
-    if (!strncmp(name, "blink_count_trip", kNameLen)) {
-      read_cb(cb_arg, &blink_count_trip, sizeof(blink_count_trip));
-      return 0;
-    }
-    if (!strncmp(name, "blink_count_total", kNameLen)) {
-      read_cb(cb_arg, &blink_count_total, sizeof(blink_count_total));
-      return 0;
-    }
+  if (NULL == kDesc) {
+    return -ENOENT;
   }
+  LOG_DBG("Config Set: %s", name);
 
-  return -ENOENT;
+  if ((sizeof(tmp_32) == len) &&
+      (sizeof(tmp_32) == read_cb(cb_arg, &tmp_32, sizeof(tmp_32)))) {
+    config_value_restore(kDesc, tmp_32);
+  }
+  return 0;
 }
 
 /**
  * @brief Handles export requests for configuration settings
  *
+ * @details Walks the descriptor table once and exports every persistent key
+ *
  * @param cb Callback function to export settings
  * @return int 0 on success, negative on error
  */
 int config_handle_export(int (*cb)(const char *name, const void *value,
                                    size_t val_len)) {
+  char name[sizeof(APP_CONFIG_SUBTREE) + SETTINGS_MAX_NAME_LEN] = {0};
+
   LOG_DBG("Config Export");
 
-#if 0
-  // blink_count_trip is volatile
-  (void)cb("openblink/blink_count_trip", &blink_count_trip, sizeof(blink_count_trip));
-#endif
-  (void)cb("openblink/blink_count_total", &blink_count_total,
-           sizeof(blink_count_total));
+  for (size_t i = 0; ARRAY_SIZE(kConfigDesc) > i; i++) {
+    if (false == kConfigDesc[i].persistent) {
+      continue;
+    }
+    const uint32_t kValue = config_value_get(&kConfigDesc[i]);
+    snprintf(name, sizeof(name), APP_CONFIG_SUBTREE "/%s",
+             kConfigDesc[i].name);
+    (void)cb(name, &kValue, sizeof(kValue));
+  }
 
   return 0;
 }
@@ -0,0 +1,186 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file counter.c
+ * @brief Implementation of event counters
+ * @details Counters are updated in RAM only. Changes to persistent counters
+ * are coalesced and written with settings_save_one() either when
+ * COUNTER_FLUSH_THRESHOLD increments are pending or COUNTER_FLUSH_INTERVAL_MS
+ * after the first unwritten change, but never more often than once per
+ * COUNTER_FLUSH_SPACING_MS.
+ */
+#include "counter.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+
+#include "../lib/fn.h"
+
+LOG_MODULE_REGISTER(app_counter, LOG_LEVEL_DBG);
+
+/**
+ * @brief Counter descriptor
+ */
+typedef struct {
+  const char *key; /**< Settings key, NULL for volatile counters */
+} counter_desc_t;
+
+/** @brief Counter descriptors, indexed by counter_id_t */
+static const counter_desc_t kCounterDesc[kCounterNum] = {
+    [kCounterBlinkTrip] = {.key = NULL},
+    [kCounterBlinkTotal] = {.key = "openblink/blink_count_total"},
+};
+
+/** @brief Current counter values */
+static uint32_t counter_value[kCounterNum];
+
+/** @brief Last value written to (or loaded from) settings_storage */
+static uint32_t counter_persisted[kCounterNum];
+
+/** @brief Increments of persistent counters not yet written */
+static uint32_t counter_pending = 0U;
+
+/** @brief Uptime of the last flush in milliseconds */
+static int64_t last_flush_ms = -(int64_t)COUNTER_FLUSH_SPACING_MS;
+
+/** @brief Lock protecting the counter state */
+static struct k_spinlock counter_lock;
+
+/**
+ * @brief Work handler flushing the persistent counters
+ *
+ * @param work Pointer to the work item
+ */
+static void counter_work_flush(struct k_work *const work);
+K_WORK_DELAYABLE_DEFINE(work_counter_flush, counter_work_flush);
+
+/**
+ * @brief Computes the delay until the next flush
+ *
+ * @param kPending Number of pending increments
+ * @param kNowMs Current uptime in milliseconds
+ * @return uint32_t Delay in milliseconds
+ */
+static uint32_t flush_delay_ms(const uint32_t kPending, const int64_t kNowMs) {
+  const int64_t kEarliestMs = last_flush_ms + COUNTER_FLUSH_SPACING_MS;
+  if (COUNTER_FLUSH_THRESHOLD <= kPending) {
+    return (kNowMs >= kEarliestMs) ? 0U : (uint32_t)(kEarliestMs - kNowMs);
+  }
+  return COUNTER_FLUSH_INTERVAL_MS;
+}
+
+/**
+ * @brief Gets the current value of a counter
+ *
+ * @param kId Counter identifier
+ * @return uint32_t Current value, 0 if the identifier is invalid
+ */
+uint32_t counter_get(const counter_id_t kId) {
+  if (kCounterNum <= kId) {
+    return 0U;
+  }
+  return counter_value[kId];
+}
+
+/**
+ * @brief Increments a counter (saturating) and schedules a deferred flush
+ *
+ * @param kId Counter identifier
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t counter_increment(const counter_id_t kId) {
+  uint32_t pending = 0U;
+  if (kCounterNum <= kId) {
+    return kFailure;
+  }
+
+  K_SPINLOCK(&counter_lock) {
+    counter_value[kId] += (UINT32_MAX > counter_value[kId]) ? 1U : 0U;
+    if (NULL != kCounterDesc[kId].key) {
+      counter_pending += 1U;
+    }
+    pending = counter_pending;
+  }
+
+  if (0U < pending) {
+    const uint32_t kDelayMs = flush_delay_ms(pending, k_uptime_get());
+    if (false == k_work_delayable_is_pending(&work_counter_flush)) {
+      k_work_schedule(&work_counter_flush, K_MSEC(kDelayMs));
+    } else if (k_ticks_to_ms_ceil32(k_work_delayable_remaining_get(
+                   &work_counter_flush)) > kDelayMs) {
+      k_work_reschedule(&work_counter_flush, K_MSEC(kDelayMs));
+    }
+  }
+  return kSuccess;
+}
+
+/**
+ * @brief Sets a counter to a value loaded from non-volatile storage
+ *
+ * @param kId Counter identifier
+ * @param kValue Loaded value
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t counter_restore(const counter_id_t kId, const uint32_t kValue) {
+  if (kCounterNum <= kId) {
+    return kFailure;
+  }
+  K_SPINLOCK(&counter_lock) {
+    counter_value[kId] = kValue;
+    counter_persisted[kId] = kValue;
+  }
+  return kSuccess;
+}
+
+/**
+ * @brief Writes all changed persistent counters to settings_storage now
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t counter_flush(void) {
+  fn_t ret = kSuccess;
+  uint32_t snapshot[kCounterNum] = {0U};
+
+  K_SPINLOCK(&counter_lock) {
+    for (size_t i = 0; kCounterNum > i; i++) {
+      snapshot[i] = counter_value[i];
+    }
+    counter_pending = 0U;
+  }
+  last_flush_ms = k_uptime_get();
+
+  for (size_t i = 0; kCounterNum > i; i++) {
+    if ((NULL == kCounterDesc[i].key) ||
+        (counter_persisted[i] == snapshot[i])) {
+      continue;
+    }
+    const int kRc = settings_save_one(kCounterDesc[i].key, &snapshot[i],
+                                      sizeof(snapshot[i]));
+    if (0 == kRc) {
+      counter_persisted[i] = snapshot[i];
+      LOG_DBG("%s: %u", kCounterDesc[i].key, snapshot[i]);
+    } else {
+      LOG_ERR("settings_save_one(%s) failed ret:%d", kCounterDesc[i].key, kRc);
+      ret = kFailure;
+    }
+  }
+  return ret;
+}
+
+/**
+ * @brief Work handler flushing the persistent counters
+ *
+ * @param work Pointer to the work item
+ */
+static void counter_work_flush(struct k_work *const work) {
+  if (kSuccess != counter_flush()) {
+    // Retry later rather than hammering a failing flash
+    k_work_schedule(&work_counter_flush, K_MSEC(COUNTER_FLUSH_SPACING_MS));
+  }
+}
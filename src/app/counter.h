@@ -0,0 +1,80 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file counter.h
+ * @brief Event counter interface
+ * @details Keeps counters in RAM and persists them to settings_storage with
+ * deferred, coalesced writes
+ */
+#ifndef APP_COUNTER_H
+#define APP_COUNTER_H
+
+#include <stdint.h>
+
+#include "../lib/fn.h"
+
+/**
+ * @brief Pending increments that trigger a flush of persistent counters
+ * @details Together with COUNTER_FLUSH_SPACING_MS this bounds the number of
+ * increments lost on a power failure
+ */
+#define COUNTER_FLUSH_THRESHOLD 8U
+
+/**
+ * @brief Maximum time a changed persistent counter stays unwritten
+ */
+#define COUNTER_FLUSH_INTERVAL_MS (10U * 60U * 1000U)
+
+/**
+ * @brief Minimum time between two flushes (flash wear limit)
+ */
+#define COUNTER_FLUSH_SPACING_MS (60U * 1000U)
+
+/**
+ * @typedef counter_id_t
+ * @brief Enumeration of counters
+ */
+typedef enum {
+  kCounterBlinkTrip,  /**< Bytecode uploads since boot (volatile) */
+  kCounterBlinkTotal, /**< Bytecode uploads since manufacture (persistent) */
+  kCounterNum,        /**< Number of counters (not a counter) */
+} counter_id_t;
+
+/**
+ * @brief Gets the current value of a counter
+ *
+ * @param kId Counter identifier
+ * @return uint32_t Current value, 0 if the identifier is invalid
+ */
+uint32_t counter_get(const counter_id_t kId);
+
+/**
+ * @brief Increments a counter (saturating) and schedules a deferred flush
+ *
+ * @param kId Counter identifier
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t counter_increment(const counter_id_t kId);
+
+/**
+ * @brief Sets a counter to a value loaded from non-volatile storage
+ *
+ * @details The value is treated as already persisted and does not schedule a
+ * flush
+ *
+ * @param kId Counter identifier
+ * @param kValue Loaded value
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t counter_restore(const counter_id_t kId, const uint32_t kValue);
+
+/**
+ * @brief Writes all changed persistent counters to settings_storage now
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t counter_flush(void);
+
+#endif  // APP_COUNTER_H
@@ -8,6 +8,8 @@
  * @details Implements boot sequence, factory reset, and system reboot
  * functionality
  */
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <zephyr/drivers/hwinfo.h>
@@ -15,21 +17,28 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/settings/settings.h>
+#include <zephyr/sys/atomic.h>
 #include <zephyr/sys/reboot.h>
+#include <zephyr/sys/util.h>
 
 #include "../api/blink.h"
 #include "../api/i2c.h"
 #include "../api/symbol.h"
 #include "../drv/adc.h"
 #include "../drv/gpio.h"
+#include "../drv/hal/die_temperature.h"
 #include "../lib/fn.h"
 #include "app_version.h"
 #include "blink.h"
+#include "boot_trace.h"
 #include "comm.h"
 #include "config.h"
+#include "init.h"
 #include "mrubyc_vm.h"
 #include "ncs_version.h"
+#include "poller.h"
 #include "storage.h"
+#include "store.h"
 #include "version.h"
 #include "watchdog.h"
 
@@ -38,6 +47,32 @@ LOG_MODULE_REGISTER(app_init, LOG_LEVEL_DBG);
 /** @brief External mutex for storage operations */
 extern struct k_mutex mutex_storage;
 
+/**
+ * @brief Stack size of the Bluetooth boot work queue in bytes
+ * @details comm_init() runs bt_enable(), settings_load_subtree("bt") with
+ * the key and CCC handlers, and the first bt_le_adv_start() on this stack
+ */
+#define INIT_WORKQ_COMM_STACK_SIZE 3072
+
+/** @brief Stack size of the storage and peripheral boot work queue in bytes */
+#define INIT_WORKQ_IO_STACK_SIZE 2048
+
+/** @brief Priority of the boot work queues */
+#define INIT_WORKQ_PRIORITY 0
+
+/** @brief Mask of all boot stages */
+#define INIT_STAGE_MASK_ALL (BIT(kInitStageNum) - 1U)
+
+/**
+ * @brief Boot stage descriptor
+ */
+typedef struct {
+  fn_t (*func)(void);       /**< Initialization function */
+  uint32_t depends;         /**< Mask of stages that must finish first */
+  boot_trace_stage_t trace; /**< Boot trace stage recorded on completion */
+  struct k_work_q *queue;   /**< Work queue the stage runs on */
+} init_stage_desc_t;
+
 /**
  * @brief Main initialization function called during system boot
  *
@@ -50,16 +85,190 @@ static int init_main(void);
  */
 SYS_INIT(init_main, APPLICATION, 0);
 
+static fn_t init_settings(void);
+static fn_t init_free_space(void);
+
+/**
+ * @brief Work queue dedicated to Bluetooth bring-up
+ * @details comm_init() blocks on bt_enable() completion, so it gets its own
+ * queue and does not hold back the other subsystems
+ */
+static struct k_work_q init_workq_comm;
+K_THREAD_STACK_DEFINE(init_workq_comm_stack, INIT_WORKQ_COMM_STACK_SIZE);
+
+/** @brief Work queue for storage, settings and peripheral bring-up */
+static struct k_work_q init_workq_io;
+K_THREAD_STACK_DEFINE(init_workq_io_stack, INIT_WORKQ_IO_STACK_SIZE);
+
+/**
+ * @brief Boot stage table
+ * @details Stages are dispatched in enum order as soon as their dependencies
+ * have finished, so the Bluetooth controller and advertising start right
+ * after the settings backend is available
+ */
+static const init_stage_desc_t kInitStage[kInitStageNum] = {
+    [kInitStageSettings] = {.func = init_settings,
+                            .depends = 0U,
+                            .trace = kBootTraceSettings,
+                            .queue = &init_workq_io},
+    [kInitStageComm] = {.func = comm_init,
+                        .depends = INIT_STAGE_BIT(kInitStageSettings),
+                        .trace = kBootTraceComm,
+                        .queue = &init_workq_comm},
+    [kInitStageStorage] = {.func = storage_init,
+                           .depends = 0U,
+                           .trace = kBootTraceStorage,
+                           .queue = &init_workq_io},
+    [kInitStageSymbol] = {.func = api_symbol_init,
+                          .depends = 0U,
+                          .trace = kBootTraceSymbol,
+                          .queue = &init_workq_io},
+    [kInitStageGpio] = {.func = drv_gpio_init,
+                        .depends = 0U,
+                        .trace = kBootTraceGpio,
+                        .queue = &init_workq_io},
+    [kInitStageAdc] = {.func = drv_adc_init,
+                       .depends = 0U,
+                       .trace = kBootTraceAdc,
+                       .queue = &init_workq_io},
+    [kInitStageI2c] = {.func = api_i2c_init,
+                       .depends = 0U,
+                       .trace = kBootTraceI2c,
+                       .queue = &init_workq_io},
+    // The store handler takes the user keys of the openblink subtree
+    [kInitStageConfig] = {.func = config_init,
+                          .depends = INIT_STAGE_BIT(kInitStageSettings) |
+                                     INIT_STAGE_BIT(kInitStageStore),
+                          .trace = kBootTraceConfig,
+                          .queue = &init_workq_io},
+    [kInitStageFreeSpace] = {.func = init_free_space,
+                             .depends = INIT_STAGE_BIT(kInitStageStorage) |
+                                        INIT_STAGE_BIT(kInitStageSettings),
+                             .trace = kBootTraceFreeSpace,
+                             .queue = &init_workq_io},
+    [kInitStageStore] = {.func = store_init,
+                         .depends = INIT_STAGE_BIT(kInitStageSettings),
+                         .trace = kBootTraceStore,
+                         .queue = &init_workq_io},
+    [kInitStageTemp] = {.func = hal_die_temperature_init,
+                        .depends = 0U,
+                        .trace = kBootTraceTemperature,
+                        .queue = &init_workq_io},
+    [kInitStagePoller] = {.func = poller_init,
+                          .depends = 0U,
+                          .trace = kBootTracePoller,
+                          .queue = &init_workq_io},
+};
+
+/** @brief Work items, one per boot stage */
+static struct k_work init_work[kInitStageNum];
+
+/** @brief Mask of stages already submitted */
+static atomic_t stage_submitted = ATOMIC_INIT(0);
+
+/** @brief Mask of stages finished (successfully or not) */
+static atomic_t stage_done = ATOMIC_INIT(0);
+
+/** @brief Mask of stages that failed */
+static atomic_t stage_failed = ATOMIC_INIT(0);
+
+/** @brief Event object posted with the bit of each finished stage */
+static K_EVENT_DEFINE(init_event);
+
+/** @brief Uptime at init_main() entry */
+static int64_t init_timestamp;
+
+/**
+ * @brief Submits every stage whose dependencies have finished
+ */
+static void init_dispatch(void) {
+  const uint32_t kDone = (uint32_t)atomic_get(&stage_done);
+  for (size_t i = 0; kInitStageNum > i; i++) {
+    if (kInitStage[i].depends != (kDone & kInitStage[i].depends)) {
+      continue;
+    }
+    if (false == atomic_test_and_set_bit(&stage_submitted, i)) {
+      k_work_submit_to_queue(kInitStage[i].queue, &init_work[i]);
+    }
+  }
+}
+
+/**
+ * @brief Logs the unused stack of a boot work queue
+ *
+ * @details Needs CONFIG_INIT_STACKS (selected by CONFIG_THREAD_ANALYZER); the
+ * stack sizes above are checked against these values
+ *
+ * @param queue Boot work queue
+ * @param kName Name of the queue
+ */
+static void init_log_stack(struct k_work_q *const queue,
+                           const char *const kName) {
+#if defined(CONFIG_INIT_STACKS)
+  size_t unused = 0U;
+  if (0 == k_thread_stack_space_get(&queue->thread, &unused)) {
+    LOG_INF("%s: %u bytes of stack unused", kName, (unsigned int)unused);
+  }
+#else
+  ARG_UNUSED(queue);
+  ARG_UNUSED(kName);
+#endif
+}
+
+/**
+ * @brief Logs the boot result once every stage has finished
+ */
+static void init_finish(void) {
+  boot_trace_mark(kBootTraceInitEnd);
+  boot_trace_dump();
+  init_log_stack(&init_workq_comm, "init_comm");
+  init_log_stack(&init_workq_io, "init_io");
+
+  const uint32_t kFailed = (uint32_t)atomic_get(&stage_failed);
+  if (0U == kFailed) {
+    LOG_INF("=== Init. Succeeded! (%lli ms) ===",
+            k_uptime_delta(&init_timestamp));
+  } else {
+    LOG_ERR("=== Init. FAILED 0x%08X (%lli ms) ===", kFailed,
+            k_uptime_delta(&init_timestamp));
+  }
+}
+
+/**
+ * @brief Work handler running one boot stage
+ *
+ * @param work Work item of the stage
+ */
+static void init_work_handler(struct k_work *const work) {
+  const size_t kStage = (size_t)(work - &init_work[0]);
+  const uint32_t kBit = INIT_STAGE_BIT(kStage);
+
+  if (kSuccess != kInitStage[kStage].func()) {
+    atomic_or(&stage_failed, (atomic_val_t)kBit);
+  }
+  boot_trace_mark(kInitStage[kStage].trace);
+
+  const uint32_t kDone = (uint32_t)atomic_or(&stage_done, (atomic_val_t)kBit);
+  k_event_post(&init_event, kBit);
+  if (INIT_STAGE_MASK_ALL == (kDone | kBit)) {
+    init_finish();
+  } else {
+    init_dispatch();
+  }
+}
+
 /**
  * @brief Main initialization function called during system boot
  *
- * @details Initializes all subsystems, displays device information, and
- * configures the system for operation
+ * @details Displays device information, arms the watchdog and schedules the
+ * remaining subsystems on the boot work queues. The function returns before
+ * those subsystems are up; use init_wait() to wait for them.
  *
  * @return int EXIT_SUCCESS on success, EXIT_FAILURE on failure
  */
 static int init_main(void) {
-  int64_t timestamp = k_uptime_get();
+  init_timestamp = k_uptime_get();
+  boot_trace_mark(kBootTraceInitStart);
   fn_t ret = kSuccess;
   uint32_t reset_cause = 0x00U;
   uint8_t buf[8] = {0x00U};
@@ -80,32 +289,72 @@ static int init_main(void) {
   LOG_INF("Reset cause: 0x%08X", reset_cause);
 
   // ==============================
-  // Initialize
+  // Initialize (synchronous)
   ret = (kSuccess != watchdog_init()) ? kFailure : ret;
+  boot_trace_mark(kBootTraceWatchdog);
   ret = (kSuccess != api_blink_init()) ? kFailure : ret;
-  LOG_INF("nvs_storage init");
-  ret = (kSuccess != storage_init()) ? kFailure : ret;
-  LOG_INF("settings_storage init");
-  ret = (0 != settings_subsys_init()) ? kFailure : ret;
-  storage_free_space();
-  ret = (kSuccess != config_init()) ? kFailure : ret;
-  ret = (kSuccess != api_symbol_init()) ? kFailure : ret;
-  ret = (kSuccess != api_i2c_init()) ? kFailure : ret;
-  ret = (kSuccess != drv_gpio_init()) ? kFailure : ret;
-  ret = (kSuccess != drv_adc_init()) ? kFailure : ret;
-  ret = (kSuccess != comm_init()) ? kFailure : ret;
+  boot_trace_mark(kBootTraceApiBlink);
+
+  // ==============================
+  // Initialize (dependency ordered, concurrent)
+  k_work_queue_start(&init_workq_comm, init_workq_comm_stack,
+                     K_THREAD_STACK_SIZEOF(init_workq_comm_stack),
+                     INIT_WORKQ_PRIORITY, NULL);
+  k_thread_name_set(&init_workq_comm.thread, "init_comm");
+  k_work_queue_start(&init_workq_io, init_workq_io_stack,
+                     K_THREAD_STACK_SIZEOF(init_workq_io_stack),
+                     INIT_WORKQ_PRIORITY, NULL);
+  k_thread_name_set(&init_workq_io.thread, "init_io");
+  for (size_t i = 0; kInitStageNum > i; i++) {
+    k_work_init(&init_work[i], init_work_handler);
+  }
+  init_dispatch();
 
   // ==============================
   // Result
   if (kSuccess == ret) {
-    LOG_INF("=== Init. Succeeded! (%lli ms) ===", k_uptime_delta(&timestamp));
+    LOG_INF("=== Init. Scheduled (%lli ms) ===",
+            k_uptime_get() - init_timestamp);
     return EXIT_SUCCESS;
   } else {
-    LOG_ERR("=== Init. FAILED (%lli ms) ===", k_uptime_delta(&timestamp));
+    LOG_ERR("=== Init. FAILED (%lli ms) ===", k_uptime_get() - init_timestamp);
     return EXIT_FAILURE;
   }
 }
 
+/**
+ * @brief Waits until the given boot stages have finished
+ *
+ * @param kStageMask Mask of stages built with INIT_STAGE_BIT()
+ * @return fn_t kSuccess if all stages succeeded, kFailure if any failed
+ */
+fn_t init_wait(const uint32_t kStageMask) {
+  (void)k_event_wait_all(&init_event, kStageMask, false, K_FOREVER);
+  if (0U != ((uint32_t)atomic_get(&stage_failed) & kStageMask)) {
+    return kFailure;
+  }
+  return kSuccess;
+}
+
+/**
+ * @brief Initializes the settings subsystem
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+static fn_t init_settings(void) {
+  LOG_INF("settings_storage init");
+  return (0 == settings_subsys_init()) ? kSuccess : kFailure;
+}
+
+/**
+ * @brief Logs free space of the storage partitions
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+static fn_t init_free_space(void) {
+  return (0 <= storage_free_space()) ? kSuccess : kFailure;
+}
+
 /**
  * @brief Reboots the device
  *
@@ -116,6 +365,7 @@ static int init_main(void) {
  */
 fn_t init_reboot(void) {
   LOG_WRN("Rebooting...");
+  (void)store_flush();
   // Reboot
   for (uint8_t i = 0; 10 > i; i++) {
     if ((0 == settings_save()) &&
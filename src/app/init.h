@@ -10,8 +10,43 @@
 #ifndef APP_INIT_H
 #define APP_INIT_H
 
+#include <stdint.h>
+
 #include "../lib/fn.h"
 
+/**
+ * @brief Converts a boot stage to its bit in a stage mask
+ */
+#define INIT_STAGE_BIT(stage) (1UL << (stage))
+
+/**
+ * @typedef init_stage_t
+ * @brief Enumeration of boot stages run after init_main()
+ */
+typedef enum {
+  kInitStageSettings,  /**< settings_subsys_init() */
+  kInitStageComm,      /**< comm_init(): bt_enable() and advertising */
+  kInitStageStorage,   /**< storage_init() */
+  kInitStageSymbol,    /**< api_symbol_init() */
+  kInitStageGpio,      /**< drv_gpio_init() */
+  kInitStageAdc,       /**< drv_adc_init() */
+  kInitStageI2c,       /**< api_i2c_init() */
+  kInitStageConfig,    /**< config_init() */
+  kInitStageFreeSpace, /**< storage_free_space() */
+  kInitStageStore,     /**< store_init() */
+  kInitStageTemp,      /**< hal_die_temperature_init() */
+  kInitStagePoller,    /**< poller_init() */
+  kInitStageNum,       /**< Number of stages (not a stage) */
+} init_stage_t;
+
+/**
+ * @brief Waits until the given boot stages have finished
+ *
+ * @param kStageMask Mask of stages built with INIT_STAGE_BIT()
+ * @return fn_t kSuccess if all stages succeeded, kFailure if any failed
+ */
+fn_t init_wait(const uint32_t kStageMask);
+
 /**
  * @brief Reboots the device
  *
@@ -13,26 +13,43 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/util.h>
 
 #include "../../mrubyc/src/mrubyc.h"
 #include "../api/adc.h"
 #include "../api/api.h"
 #include "../api/ble.h"
 #include "../api/blink.h"
+#include "../api/capture.h"
+#include "../api/gpio.h"
 #include "../api/i2c.h"
 #include "../api/input.h"
 #include "../api/led.h"
+#include "../api/poller.h"
 #include "../api/pwm.h"
+#include "../api/store.h"
 #include "../api/symbol.h"
 #include "../api/temperature.h"
+#include "../drv/adc.h"
 #include "../drv/ble.h"
+#include "../drv/capture.h"
+#include "../drv/gpio.h"
+#include "../drv/pwm.h"
 #include "../lib/fn.h"
+#include "../lib/mrubyc/hal.h"
 #include "../rb/slot1.h"
 #include "../rb/slot2.h"
 #include "blink.h"
+#include "boot_trace.h"
 #include "init.h"
+#include "profiler.h"
+#include "sampler.h"
+#include "slab.h"
+#include "task_monitor.h"
 
 LOG_MODULE_REGISTER(app_mrubyc_vm, LOG_LEVEL_DBG);
 
@@ -46,11 +63,59 @@ LOG_MODULE_REGISTER(app_mrubyc_vm, LOG_LEVEL_DBG);
  */
 #define MRUBYC_VM_MAIN_STACK_SIZE (96 * 1024)
 
+/**
+ * @brief Minimum interval between heap updates when the scripts idle
+ */
+#define MRUBYC_VM_HEAP_UPDATE_MS 1000
+
+/**
+ * @brief Boot stages the mruby/c VM depends on
+ *
+ * @details Comm and Config are included so that neither a script nor a
+ * reload requested over BLE runs before the link and the settings handler
+ * are up
+ */
+#define MRUBYC_VM_INIT_DEPENDS                                            \
+  (INIT_STAGE_BIT(kInitStageComm) | INIT_STAGE_BIT(kInitStageStorage) |   \
+   INIT_STAGE_BIT(kInitStageSymbol) | INIT_STAGE_BIT(kInitStageGpio) |    \
+   INIT_STAGE_BIT(kInitStageAdc) | INIT_STAGE_BIT(kInitStageI2c) |        \
+   INIT_STAGE_BIT(kInitStageConfig) | INIT_STAGE_BIT(kInitStageStore) |   \
+   INIT_STAGE_BIT(kInitStageTemp) | INIT_STAGE_BIT(kInitStagePoller))
+
 /**
  * @brief Flag indicating if VM reload is pending
  */
 static bool request_mruby_reload = false;
 
+/** @brief Bytes allocated now (VM thread only) */
+static uint32_t heap_live_bytes = 0U;
+
+/** @brief Most bytes allocated at once since boot (VM thread only) */
+static uint32_t heap_peak = 0U;
+
+/** @brief Allocations since the VM started by size class (VM thread only) */
+static uint32_t heap_allocs[MRUBYC_VM_HEAP_CLASSES];
+
+/** @brief Live blocks by size class (VM thread only) */
+static uint32_t heap_live[MRUBYC_VM_HEAP_CLASSES];
+
+#if defined(MRBC_ALLOC_VMID)
+/** @brief Live blocks by owner (VM ID, 0 for none) and size class */
+static uint32_t heap_vm_live[MAX_VM_COUNT + 1][MRUBYC_VM_HEAP_CLASSES];
+
+/** @brief Live bytes by owner (VM ID, 0 for none) */
+static uint32_t heap_vm_bytes[MAX_VM_COUNT + 1];
+#endif
+
+/** @brief Heap statistics of the last update */
+static mrubyc_vm_heap_stats_t heap_stats;
+
+/** @brief Lock for heap_stats */
+static struct k_spinlock heap_lock;
+
+/** @brief Uptime of the last heap update */
+static int64_t heap_update_ms = 0;
+
 /**
  * @brief Loads bytecode from storage or default slots
  *
@@ -73,9 +138,14 @@ static void mrubyc_vm_main(void *, void *, void *);
 /**
  * @brief Timer handler for the mruby/c VM
  *
+ * @details Drives the scheduler and accounts the run time of the tasks
+ *
  * @param timer Timer instance
  */
-static void mrubyc_timerhandler(struct k_timer *const timer) { mrbc_tick(); }
+static void mrubyc_timerhandler(struct k_timer *const timer) {
+  mrbc_tick();
+  task_monitor_tick();
+}
 
 /**
  * @brief Thread definition for the mruby/c VM main function
@@ -108,6 +178,455 @@ fn_t app_mrubyc_vm_set_reload(void) {
  */
 bool app_mrubyc_vm_get_reload(void) { return request_mruby_reload; }
 
+/**
+ * @brief Gets the size class of a block
+ *
+ * @param kSize Usable size of the block in bytes
+ * @return size_t Class index
+ */
+static size_t heap_class(const unsigned int kSize) {
+  size_t i = 0;
+  while (((MRUBYC_VM_HEAP_CLASSES - 1U) > i) && ((8U << i) < kSize)) {
+    i++;
+  }
+  return i;
+}
+
+#if defined(MRBC_ALLOC_VMID)
+/**
+ * @brief Gets the index of an owner in the per-VM counters
+ *
+ * @param kVmId VM ID, 0 for none
+ * @return size_t Index, 0 for none or out of range
+ */
+static size_t heap_vm_index(const int kVmId) {
+  return ((0 < kVmId) && (MAX_VM_COUNT >= kVmId)) ? (size_t)kVmId : 0U;
+}
+
+/**
+ * @brief Moves a block between the per-VM counters
+ *
+ * @param kSize Usable size of the block in bytes
+ * @param kFrom Old owner
+ * @param kTo New owner
+ */
+static void heap_vm_move(const unsigned int kSize, const int kFrom,
+                         const int kTo) {
+  const size_t kClass = heap_class(kSize);
+  uint32_t *const from = heap_vm_live[heap_vm_index(kFrom)];
+  from[kClass] -= (0U < from[kClass]) ? 1U : 0U;
+  heap_vm_bytes[heap_vm_index(kFrom)] -=
+      MIN(heap_vm_bytes[heap_vm_index(kFrom)], kSize);
+  heap_vm_live[heap_vm_index(kTo)][kClass]++;
+  heap_vm_bytes[heap_vm_index(kTo)] += kSize;
+}
+
+/**
+ * @brief Uncounts the blocks still counted for a VM
+ *
+ * @details mrbc_free_all() frees the blocks of the general allocator inside
+ * alloc.c, where the calls are not wrapped
+ *
+ * @param kVmId VM ID
+ */
+static void heap_vm_forget(const int kVmId) {
+  const size_t kIndex = heap_vm_index(kVmId);
+  for (size_t i = 0; MRUBYC_VM_HEAP_CLASSES > i; i++) {
+    heap_live[i] -= MIN(heap_live[i], heap_vm_live[kIndex][i]);
+    heap_vm_live[kIndex][i] = 0U;
+  }
+  heap_live_bytes -= MIN(heap_live_bytes, heap_vm_bytes[kIndex]);
+  profiler_heap(-(int32_t)heap_vm_bytes[kIndex]);
+  heap_vm_bytes[kIndex] = 0U;
+}
+#endif
+
+/**
+ * @brief Counts a block allocated or freed
+ *
+ * @param kSize Usable size of the block in bytes
+ * @param kVmId Owner of the block, 0 for none
+ * @param kAlloc true if allocated, false if freed
+ */
+static void heap_count(const unsigned int kSize, const int kVmId,
+                       const bool kAlloc) {
+  const size_t kClass = heap_class(kSize);
+  if (true == kAlloc) {
+    heap_allocs[kClass]++;
+    heap_live[kClass]++;
+    heap_live_bytes += kSize;
+    heap_peak = MAX(heap_peak, heap_live_bytes);
+    profiler_heap((int32_t)kSize);
+  } else {
+    // Blocks allocated before the counters were reset are not counted
+    heap_live[kClass] -= (0U < heap_live[kClass]) ? 1U : 0U;
+    heap_live_bytes -= MIN(heap_live_bytes, kSize);
+    profiler_heap(-(int32_t)kSize);
+  }
+#if defined(MRBC_ALLOC_VMID)
+  uint32_t *const live = heap_vm_live[heap_vm_index(kVmId)];
+  uint32_t *const bytes = &heap_vm_bytes[heap_vm_index(kVmId)];
+  if (true == kAlloc) {
+    live[kClass]++;
+    *bytes += kSize;
+  } else {
+    live[kClass] -= (0U < live[kClass]) ? 1U : 0U;
+    *bytes -= MIN(*bytes, kSize);
+  }
+#else
+  ARG_UNUSED(kVmId);
+#endif
+}
+
+/**
+ * @brief Gets the owner of a block of the VM heap
+ *
+ * @param ptr Block
+ * @return int VM ID, 0 for none
+ */
+static int heap_owner(void *const ptr) {
+#if defined(MRBC_ALLOC_VMID)
+  return mrbc_get_vm_id(ptr);
+#else
+  ARG_UNUSED(ptr);
+  return 0;
+#endif
+}
+
+/**
+ * @brief Allocator entry points wrapped with -Wl,--wrap
+ *
+ * @details Calls inside alloc.c are not wrapped. With MRBC_ALLOC_VMID the
+ * entry points that take a VM are functions as well and are wrapped too, so
+ * that no block header access reaches a slab slot.
+ */
+void *__real_mrbc_raw_alloc(unsigned int size);
+void __real_mrbc_raw_free(void *ptr);
+void *__real_mrbc_raw_realloc(void *ptr, unsigned int size);
+unsigned int __real_mrbc_alloc_usable_size(void *ptr);
+#if defined(MRBC_ALLOC_VMID) && !defined(mrbc_set_vm_id)
+void __real_mrbc_set_vm_id(void *ptr, int vm_id);
+#endif
+
+/**
+ * @brief Gets the usable size of a block of the VM heap
+ *
+ * @param ptr Block
+ * @return unsigned int Size in bytes
+ */
+unsigned int __wrap_mrbc_alloc_usable_size(void *ptr) {
+  return (true == slab_owns(ptr)) ? slab_usable_size(ptr)
+                                  : __real_mrbc_alloc_usable_size(ptr);
+}
+
+/**
+ * @brief Sets the owner of a block from the general allocator
+ *
+ * @param ptr Block
+ * @param kVmId VM ID, 0 for none
+ */
+static void heap_set_vm_id(void *const ptr, const int kVmId) {
+#if defined(MRBC_ALLOC_VMID) && !defined(mrbc_set_vm_id)
+  __real_mrbc_set_vm_id(ptr, kVmId);
+#else
+  ARG_UNUSED(ptr);
+  ARG_UNUSED(kVmId);
+#endif
+}
+
+/**
+ * @brief Frees a block if it is a slab slot
+ *
+ * @param ptr Block, or NULL
+ * @return true if the block was freed
+ */
+static bool heap_slab_free(void *const ptr) {
+  if (NULL == ptr) {
+    return false;
+  }
+  heap_count(mrbc_alloc_usable_size(ptr), heap_owner(ptr), false);
+  if (true == slab_owns(ptr)) {
+    slab_free(ptr);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Resizes a slab slot
+ *
+ * @details A slot that is too small moves to a larger slot, or to the
+ * general allocator; the owner moves with it
+ *
+ * @param ptr Slot
+ * @param kSize New size in bytes
+ * @return void* Block, or NULL (ptr is kept)
+ */
+static void *heap_slab_realloc(void *const ptr, const unsigned int kSize) {
+  const unsigned int kOld = slab_usable_size(ptr);
+  if (kOld >= kSize) {
+    return ptr;
+  }
+  const int kVmId = slab_get_vm_id(ptr);
+  void *new_ptr = slab_alloc(kSize, kVmId);
+  if (NULL == new_ptr) {
+    new_ptr = __real_mrbc_raw_alloc(kSize);
+    if (NULL == new_ptr) {
+      return NULL;
+    }
+    heap_set_vm_id(new_ptr, kVmId);
+  }
+  memcpy(new_ptr, ptr, kOld);
+  (void)heap_slab_free(ptr);
+  heap_count(mrbc_alloc_usable_size(new_ptr), kVmId, true);
+  return new_ptr;
+}
+
+/**
+ * @brief Allocates from the VM heap
+ *
+ * @param size Size in bytes
+ * @return void* Block, or NULL
+ */
+void *__wrap_mrbc_raw_alloc(unsigned int size) {
+  void *ptr = slab_alloc(size, 0);
+  if (NULL == ptr) {
+    ptr = __real_mrbc_raw_alloc(size);
+  }
+  if (NULL != ptr) {
+    heap_count(mrbc_alloc_usable_size(ptr), heap_owner(ptr), true);
+  }
+  return ptr;
+}
+
+/**
+ * @brief Frees a block of the VM heap
+ *
+ * @param ptr Block
+ */
+void __wrap_mrbc_raw_free(void *ptr) {
+  if (false == heap_slab_free(ptr)) {
+    __real_mrbc_raw_free(ptr);
+  }
+}
+
+/**
+ * @brief Resizes a block of the VM heap
+ *
+ * @param ptr Block
+ * @param size New size in bytes
+ * @return void* Block, or NULL (ptr is kept)
+ */
+void *__wrap_mrbc_raw_realloc(void *ptr, unsigned int size) {
+  if (true == slab_owns(ptr)) {
+    return heap_slab_realloc(ptr, size);
+  }
+  const unsigned int kOld = (NULL != ptr) ? mrbc_alloc_usable_size(ptr) : 0U;
+  const int kOwner = (NULL != ptr) ? heap_owner(ptr) : 0;
+  void *const new_ptr = __real_mrbc_raw_realloc(ptr, size);
+  if (NULL != new_ptr) {
+    if (NULL != ptr) {
+      heap_count(kOld, kOwner, false);
+    }
+    heap_count(mrbc_alloc_usable_size(new_ptr), heap_owner(new_ptr), true);
+  }
+  return new_ptr;
+}
+
+#if defined(MRBC_ALLOC_VMID)
+#if !defined(mrbc_alloc)
+void *__real_mrbc_alloc(const struct VM *vm, unsigned int size);
+
+/**
+ * @brief Allocates from the VM heap for a VM
+ *
+ * @param vm Owner, or NULL
+ * @param size Size in bytes
+ * @return void* Block, or NULL
+ */
+void *__wrap_mrbc_alloc(const struct VM *vm, unsigned int size) {
+  void *ptr = slab_alloc(size, (NULL != vm) ? vm->vm_id : 0);
+  if (NULL == ptr) {
+    ptr = __real_mrbc_alloc(vm, size);
+  }
+  if (NULL != ptr) {
+    heap_count(mrbc_alloc_usable_size(ptr), heap_owner(ptr), true);
+  }
+  return ptr;
+}
+#endif  // !mrbc_alloc
+
+#if !defined(mrbc_free)
+void __real_mrbc_free(const struct VM *vm, void *ptr);
+
+/**
+ * @brief Frees a block of the VM heap for a VM
+ *
+ * @param vm Owner
+ * @param ptr Block
+ */
+void __wrap_mrbc_free(const struct VM *vm, void *ptr) {
+  if (false == heap_slab_free(ptr)) {
+    __real_mrbc_free(vm, ptr);
+  }
+}
+#endif  // !mrbc_free
+
+#if !defined(mrbc_realloc)
+void *__real_mrbc_realloc(const struct VM *vm, void *ptr, unsigned int size);
+
+/**
+ * @brief Resizes a block of the VM heap for a VM
+ *
+ * @param vm Owner
+ * @param ptr Block
+ * @param size New size in bytes
+ * @return void* Block, or NULL (ptr is kept)
+ */
+void *__wrap_mrbc_realloc(const struct VM *vm, void *ptr, unsigned int size) {
+  if (true == slab_owns(ptr)) {
+    return heap_slab_realloc(ptr, size);
+  }
+  const unsigned int kOld = (NULL != ptr) ? mrbc_alloc_usable_size(ptr) : 0U;
+  const int kOwner = (NULL != ptr) ? heap_owner(ptr) : 0;
+  void *const new_ptr = __real_mrbc_realloc(vm, ptr, size);
+  if (NULL != new_ptr) {
+    if (NULL != ptr) {
+      heap_count(kOld, kOwner, false);
+    }
+    heap_count(mrbc_alloc_usable_size(new_ptr), heap_owner(new_ptr), true);
+  }
+  return new_ptr;
+}
+#endif  // !mrbc_realloc
+
+#if !defined(mrbc_free_all)
+void __real_mrbc_free_all(const struct VM *vm);
+
+/**
+ * @brief Counts a slot freed by slab_free_vm()
+ *
+ * @param kPtr Slot
+ */
+static void heap_slab_freed(const void *kPtr) {
+  heap_count(slab_usable_size(kPtr), slab_get_vm_id(kPtr), false);
+}
+
+/**
+ * @brief Frees all blocks of a VM
+ *
+ * @details The blocks freed inside alloc.c are uncounted from the per-VM
+ * counters afterwards
+ *
+ * @param vm Owner
+ */
+void __wrap_mrbc_free_all(const struct VM *vm) {
+  __real_mrbc_free_all(vm);
+  slab_free_vm(vm->vm_id, heap_slab_freed);
+  heap_vm_forget(vm->vm_id);
+}
+#endif  // !mrbc_free_all
+
+#if !defined(mrbc_set_vm_id)
+/**
+ * @brief Sets the owner of a block of the VM heap
+ *
+ * @param ptr Block
+ * @param vm_id VM ID, 0 for none
+ */
+void __wrap_mrbc_set_vm_id(void *ptr, int vm_id) {
+  heap_vm_move(mrbc_alloc_usable_size(ptr), heap_owner(ptr), vm_id);
+  if (true == slab_owns(ptr)) {
+    slab_set_vm_id(ptr, vm_id);
+  } else {
+    heap_set_vm_id(ptr, vm_id);
+  }
+}
+#endif  // !mrbc_set_vm_id
+
+#if !defined(mrbc_get_vm_id)
+int __real_mrbc_get_vm_id(void *ptr);
+
+/**
+ * @brief Gets the owner of a block of the VM heap
+ *
+ * @param ptr Block
+ * @return int VM ID, 0 for none
+ */
+int __wrap_mrbc_get_vm_id(void *ptr) {
+  return (true == slab_owns(ptr)) ? slab_get_vm_id(ptr)
+                                  : __real_mrbc_get_vm_id(ptr);
+}
+#endif  // !mrbc_get_vm_id
+#endif  // MRBC_ALLOC_VMID
+
+/**
+ * @brief Updates the heap statistics
+ *
+ * @details Walks the pool, so call only from the VM thread. The largest
+ * block is found by bisection with allocations that are not counted; the
+ * out of memory message of the failed ones is muted. The general allocator
+ * does not see the slab arena, which is reported on its own.
+ */
+void app_mrubyc_vm_heap_update(void) {
+  struct MRBC_ALLOC_STATISTICS alloc_stats;
+  mrbc_alloc_statistics(&alloc_stats);
+  uint32_t low = 0U;
+  uint32_t high = alloc_stats.free;
+  hal_mute_write(true);
+  while (low < high) {
+    const uint32_t kSize = low + ((high - low + 1U) / 2U);
+    void *const ptr = __real_mrbc_raw_alloc(kSize);
+    if (NULL != ptr) {
+      __real_mrbc_raw_free(ptr);
+      low = kSize;
+    } else {
+      high = kSize - 1U;
+    }
+  }
+  hal_mute_write(false);
+
+  const k_spinlock_key_t kKey = k_spin_lock(&heap_lock);
+  heap_stats.total = alloc_stats.total;
+  heap_stats.used = alloc_stats.used;
+  heap_stats.free = alloc_stats.free;
+  heap_stats.largest_free = low;
+  heap_stats.free_blocks = alloc_stats.fragmentation;
+  heap_stats.peak = heap_peak;
+  slab_stats(&heap_stats.slab_total, &heap_stats.slab_used);
+  memcpy(heap_stats.allocs, heap_allocs, sizeof(heap_stats.allocs));
+  memcpy(heap_stats.live, heap_live, sizeof(heap_stats.live));
+  k_spin_unlock(&heap_lock, kKey);
+  heap_update_ms = k_uptime_get();
+}
+
+/**
+ * @brief Gets the heap statistics of the last update
+ *
+ * @details Safe from any thread. Allocations are counted since the VM
+ * started; the peak is kept across reloads.
+ *
+ * @param stats Destination
+ */
+void app_mrubyc_vm_heap_stats(mrubyc_vm_heap_stats_t *const stats) {
+  const k_spinlock_key_t kKey = k_spin_lock(&heap_lock);
+  memcpy(stats, &heap_stats, sizeof(*stats));
+  k_spin_unlock(&heap_lock, kKey);
+}
+
+/**
+ * @brief Idle hook of the VM thread
+ *
+ * @details Restarts the slot tasks terminated by the task monitor and keeps
+ * the heap statistics up to date while no task is ready
+ */
+static void mrubyc_vm_idle(void) {
+  task_monitor_idle();
+  if (MRUBYC_VM_HEAP_UPDATE_MS <= (k_uptime_get() - heap_update_ms)) {
+    app_mrubyc_vm_heap_update();
+  }
+}
+
 /**
  * @brief Main function for the mruby/c VM thread
  *
@@ -121,6 +640,13 @@ bool app_mrubyc_vm_get_reload(void) { return request_mruby_reload; }
 static void mrubyc_vm_main(void *, void *, void *) {
   int64_t timestamp = k_uptime_get();
   char buf_blink_time[100] = {0};
+  bool first_run = true;
+
+  // Wait only for the subsystems used by the VM and its APIs
+  if (kSuccess != init_wait(MRUBYC_VM_INIT_DEPENDS)) {
+    LOG_ERR("VM dependencies failed to initialize");
+  }
+  hal_set_idle_hook(mrubyc_vm_idle);
 
   while (1) {
     mrbc_tcb *tcb[MAX_VM_COUNT] = {NULL};
@@ -128,8 +654,16 @@ static void mrubyc_vm_main(void *, void *, void *) {
     uint8_t bytecode_slot1[BLINK_MAX_BYTECODE_SIZE] = {0};
     uint8_t bytecode_slot2[BLINK_MAX_BYTECODE_SIZE] = {0};
 
-    // mruby/c initialize
-    mrbc_init(memory_pool, MRBC_HEAP_MEMORY_SIZE);
+    // mruby/c initialize; the heap peak is kept across reloads
+    heap_live_bytes = 0U;
+    memset(heap_allocs, 0, sizeof(heap_allocs));
+    memset(heap_live, 0, sizeof(heap_live));
+#if defined(MRBC_ALLOC_VMID)
+    memset(heap_vm_live, 0, sizeof(heap_vm_live));
+    memset(heap_vm_bytes, 0, sizeof(heap_vm_bytes));
+#endif
+    const size_t kSlabSize = slab_init(memory_pool, MRBC_HEAP_MEMORY_SIZE);
+    mrbc_init(&memory_pool[kSlabSize], MRBC_HEAP_MEMORY_SIZE - kSlabSize);
 
     ////////////////////
     // Symbol
@@ -144,7 +678,11 @@ static void mrubyc_vm_main(void *, void *, void *) {
     api_temperature_define();  // Temperature.*
     api_adc_define();          // ADC.*
     api_pwm_define();          // PWM.*
+    api_gpio_define();         // GPIO.*
+    api_capture_define();      // Capture.*
     api_i2c_define();          // I2C.*
+    api_store_define();        // Store.*
+    api_poller_define();       // Poller.*
 
     ////////////////////
     // Clear reload request flag
@@ -166,22 +704,45 @@ static void mrubyc_vm_main(void *, void *, void *) {
     // set priority
     mrbc_change_priority(tcb[0], 1);
     mrbc_change_priority(tcb[1], 2);
+    // Run time budget per slot
+    (void)task_monitor_watch(0, tcb[0]);
+    (void)task_monitor_watch(1, tcb[1]);
+    app_mrubyc_vm_heap_update();
 
     ////////////////////
     snprintf(buf_blink_time, sizeof(buf_blink_time), "Blinked (%lli ms)\n",
              k_uptime_delta(&timestamp));
     ble_print(buf_blink_time);
 
+    if (true == first_run) {
+      first_run = false;
+      boot_trace_mark(kBootTraceVmStart);
+    }
+    profiler_start();
+    profiler_watch(tcb[0]);
+    profiler_watch(tcb[1]);
+    (void)sampler_watch(0, tcb[0], bytecode_slot1, sizeof(bytecode_slot1));
+    (void)sampler_watch(1, tcb[1], bytecode_slot2, sizeof(bytecode_slot2));
+    sampler_start();
     k_timer_start(&timer_mrubyc, K_NO_WAIT, K_MSEC(1));
     mrbc_run();
     k_timer_stop(&timer_mrubyc);
+    sampler_stop();
+    profiler_stop();
+    (void)drv_adc_stop();         // ADC acquisition is owned by the scripts
+    api_i2c_async_wait();         // Async I2C targets live in the VM heap
+    api_poller_stop();            // Pollers are owned by the scripts
+    (void)drv_pwm_seq_stop();     // So are PWM sequences
+    drv_gpio_pattern_stop_all();  // And LED patterns
+    drv_gpio_port_release();      // And port pins set up by the scripts
+    drv_capture_stop_all();       // And capture channels
 
     snprintf(buf_blink_time, sizeof(buf_blink_time),
              "mrbc_run Stopped (uptime: %lli ms)\n",
              k_uptime_delta(&timestamp));
     ble_print(buf_blink_time);
 
-    api_blink_init();
+    task_monitor_clear();
 
     ////////////////////
     // mruby/c cleanup
@@ -11,9 +11,34 @@
 #define APP_MRUBYC_VM_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "../lib/fn.h"
 
+/**
+ * @brief Number of allocation size classes
+ *
+ * @details Class i counts blocks of up to 8 << i bytes, the last class the
+ * larger ones
+ */
+#define MRUBYC_VM_HEAP_CLASSES 8U
+
+/**
+ * @brief Statistics of the VM heap
+ */
+typedef struct {
+  uint32_t total;                          /**< Size of the pool in bytes */
+  uint32_t used;                           /**< Bytes used, headers included */
+  uint32_t free;                           /**< Bytes in free blocks */
+  uint32_t largest_free;                   /**< Largest allocatable block */
+  uint32_t free_blocks;                    /**< Number of free blocks */
+  uint32_t peak;                           /**< Most bytes in use since boot */
+  uint32_t allocs[MRUBYC_VM_HEAP_CLASSES]; /**< Allocations by size class */
+  uint32_t live[MRUBYC_VM_HEAP_CLASSES];   /**< Live blocks by size class */
+  uint32_t slab_total;                     /**< Size of the slab arena */
+  uint32_t slab_used;                      /**< Bytes in slab slots */
+} mrubyc_vm_heap_stats_t;
+
 /**
  * @brief Sets the reload flag for the mruby/c virtual machine
  *
@@ -31,4 +56,21 @@ fn_t app_mrubyc_vm_set_reload(void);
  */
 bool app_mrubyc_vm_get_reload(void);
 
+/**
+ * @brief Updates the heap statistics
+ *
+ * @details Walks the pool, so call only from the VM thread
+ */
+void app_mrubyc_vm_heap_update(void);
+
+/**
+ * @brief Gets the heap statistics of the last update
+ *
+ * @details Safe from any thread. Allocations are counted since the VM
+ * started; the peak is kept across reloads.
+ *
+ * @param stats Destination
+ */
+void app_mrubyc_vm_heap_stats(mrubyc_vm_heap_stats_t *const stats);
+
 #endif
@@ -0,0 +1,345 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file poller.c
+ * @brief Implementation of the sensor poller
+ * @details Every poller is a delayable work item on a dedicated work queue,
+ * so slow I2C sources do not hold up the system work queue. A sample is
+ * queued only when it passes the poller's filter; a full queue drops the
+ * sample and the next period retries against the same reference.
+ */
+#include "poller.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+#include "../drv/adc.h"
+#include "../drv/hal/die_temperature.h"
+#include "../drv/i2c.h"
+#include "../lib/fn.h"
+
+LOG_MODULE_REGISTER(app_poller, LOG_LEVEL_WRN);
+
+/**
+ * @brief Stack size of the poller work queue in bytes
+ */
+#define POLLER_WORKQ_STACK_SIZE 1024
+
+/**
+ * @brief Priority of the poller work queue
+ */
+#define POLLER_WORKQ_PRIORITY 1
+
+/**
+ * @brief Poller state
+ */
+typedef struct {
+  struct k_work_delayable work; /**< Sampling work item */
+  poller_config_t config;       /**< Configuration */
+  int32_t reference;            /**< Last queued value */
+  bool has_reference;           /**< reference is valid */
+  bool above;                   /**< kPollerFilterThreshold: last side */
+  bool active;                  /**< Slot in use */
+  uint8_t generation;           /**< Changed by poller_add and filter changes */
+} poller_t;
+
+/** @brief Poller slots */
+static poller_t pollers[POLLER_MAX];
+
+/** @brief Lock protecting configuration changes (not held while sampling) */
+K_MUTEX_DEFINE(mutex_poller);
+
+/** @brief Queued events */
+K_MSGQ_DEFINE(poller_msgq, sizeof(poller_event_t), POLLER_QUEUE_DEPTH, 4);
+
+/** @brief Function called after an event is queued */
+static void (*poller_notify)(void) = NULL;
+
+/** @brief Work queue sampling the sources */
+static struct k_work_q poller_workq;
+K_THREAD_STACK_DEFINE(poller_workq_stack, POLLER_WORKQ_STACK_SIZE);
+
+/** @brief Number of events dropped because the queue was full */
+static uint32_t dropped = 0U;
+
+/**
+ * @brief Work handler taking one sample
+ *
+ * @param work Pointer to the work item
+ */
+static void poller_work(struct k_work *const work);
+
+/**
+ * @brief Initializes the poller and starts its work queue
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t poller_init(void) {
+  k_work_queue_start(&poller_workq, poller_workq_stack,
+                     K_THREAD_STACK_SIZEOF(poller_workq_stack),
+                     POLLER_WORKQ_PRIORITY, NULL);
+  k_thread_name_set(&poller_workq.thread, "poller");
+  for (size_t i = 0; POLLER_MAX > i; i++) {
+    k_work_init_delayable(&pollers[i].work, poller_work);
+  }
+  return kSuccess;
+}
+
+/**
+ * @brief Reads the source of a poller
+ *
+ * @param kConfig Configuration
+ * @param value Sample value
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+static fn_t poller_sample(const poller_config_t *const kConfig,
+                          int32_t *const value) {
+  switch (kConfig->source) {
+    case kPollerSourceAdc:
+      if (kSuccess != drv_adc_update()) {
+        return kFailure;
+      }
+      *value = drv_adc_get(kConfig->channel);
+      return (0 > *value) ? kFailure : kSuccess;
+    case kPollerSourceTemp: {
+      const float kCelsius = hal_die_temperature_get();
+      if ((float)INT32_MIN >= kCelsius) {
+        return kFailure;
+      }
+      *value = (int32_t)(kCelsius * 1000.0f);
+      return kSuccess;
+    }
+    case kPollerSourceI2c: {
+      uint8_t buf[4] = {0U};
+      if (0 != drv_i2c_reg_read(&kConfig->i2c, kConfig->reg, buf,
+                                kConfig->size)) {
+        return kFailure;
+      }
+      uint32_t raw = 0U;
+      for (size_t i = 0; kConfig->size > i; i++) {
+        raw = (raw << 8) | buf[i];
+      }
+      *value = (int32_t)raw;
+      return kSuccess;
+    }
+    default:
+      return kFailure;
+  }
+}
+
+/**
+ * @brief Decides whether a sample is queued
+ *
+ * @param poller Poller
+ * @param kValue Sample value
+ * @return true if the sample passes the filter
+ */
+static bool poller_filter(poller_t *const poller, const int32_t kValue) {
+  const poller_config_t *const kConfig = &poller->config;
+  if (kPollerFilterThreshold == kConfig->filter) {
+    bool above = poller->above;
+    if (kValue >= (kConfig->level + kConfig->hysteresis)) {
+      above = true;
+    } else if (kValue < (kConfig->level - kConfig->hysteresis)) {
+      above = false;
+    }
+    if (poller->has_reference && (above == poller->above)) {
+      return false;
+    }
+    poller->above = above;
+    return true;
+  }
+  if (false == poller->has_reference) {
+    return true;
+  }
+  return (int64_t)kConfig->level <=
+         llabs((int64_t)kValue - (int64_t)poller->reference);
+}
+
+/**
+ * @brief Work handler taking one sample
+ *
+ * @param work Pointer to the work item
+ */
+static void poller_work(struct k_work *const work) {
+  struct k_work_delayable *const dwork = k_work_delayable_from_work(work);
+  poller_t *const poller = CONTAINER_OF(dwork, poller_t, work);
+  bool queued = false;
+
+  k_mutex_lock(&mutex_poller, K_FOREVER);
+  if (false == poller->active) {
+    k_mutex_unlock(&mutex_poller);
+    return;
+  }
+  const poller_config_t kConfig = poller->config;
+  const uint8_t kGeneration = poller->generation;
+  k_mutex_unlock(&mutex_poller);
+
+  // I2C transfers and ADC scans block, so the VM is not held up meanwhile
+  int32_t value = 0;
+  const fn_t kSampled = poller_sample(&kConfig, &value);
+
+  k_mutex_lock(&mutex_poller, K_FOREVER);
+  if (false == poller->active) {
+    k_mutex_unlock(&mutex_poller);
+    return;
+  }
+  // A sample taken with an old configuration is dropped
+  if ((kSuccess == kSampled) && (kGeneration == poller->generation)) {
+    const bool kAbove = poller->above;
+    if (true == poller_filter(poller, value)) {
+      const poller_event_t kEvent = {.id = (uint8_t)(poller - pollers),
+                                     .value = value};
+      if (0 == k_msgq_put(&poller_msgq, &kEvent, K_NO_WAIT)) {
+        poller->reference = value;
+        poller->has_reference = true;
+        queued = true;
+      } else {
+        poller->above = kAbove;  // Report the crossing again next period
+        dropped++;
+        LOG_WRN("Poller queue full (%u dropped)", dropped);
+      }
+    }
+  }
+  k_work_schedule_for_queue(&poller_workq, &poller->work,
+                            K_MSEC(poller->config.period_ms));
+  k_mutex_unlock(&mutex_poller);
+
+  if ((true == queued) && (NULL != poller_notify)) {
+    poller_notify();
+  }
+}
+
+/**
+ * @brief Adds a poller and takes the first sample immediately
+ *
+ * @param kConfig Configuration
+ * @return int Poller identifier, or negative on error
+ */
+int poller_add(const poller_config_t *const kConfig) {
+  int id = -ENOMEM;
+
+  if ((POLLER_PERIOD_MIN_MS > kConfig->period_ms) ||
+      ((kPollerSourceAdc == kConfig->source) &&
+       (drv_adc_channel_count() <= kConfig->channel)) ||
+      ((kPollerSourceI2c == kConfig->source) &&
+       ((0U == kConfig->size) || (4U < kConfig->size)))) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&mutex_poller, K_FOREVER);
+  for (size_t i = 0; POLLER_MAX > i; i++) {
+    if (false == pollers[i].active) {
+      pollers[i].config = *kConfig;
+      pollers[i].has_reference = false;
+      pollers[i].above = false;
+      pollers[i].active = true;
+      pollers[i].generation++;
+      k_work_reschedule_for_queue(&poller_workq, &pollers[i].work,
+                                  K_NO_WAIT);
+      id = (int)i;
+      break;
+    }
+  }
+  k_mutex_unlock(&mutex_poller);
+  return id;
+}
+
+/**
+ * @brief Changes the filter of a poller
+ *
+ * @details The next sample is queued unconditionally and becomes the new
+ * reference
+ *
+ * @param kId Poller identifier
+ * @param kFilter Filter
+ * @param kLevel Delta, or threshold level
+ * @param kHysteresis Hysteresis of a threshold
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t poller_set_filter(const uint8_t kId, const poller_filter_t kFilter,
+                       const int32_t kLevel, const int32_t kHysteresis) {
+  fn_t ret = kFailure;
+  if ((POLLER_MAX <= kId) || (0 > kHysteresis)) {
+    return kFailure;
+  }
+  k_mutex_lock(&mutex_poller, K_FOREVER);
+  if (true == pollers[kId].active) {
+    pollers[kId].config.filter = kFilter;
+    pollers[kId].config.level = kLevel;
+    pollers[kId].config.hysteresis = kHysteresis;
+    pollers[kId].has_reference = false;
+    pollers[kId].generation++;
+    ret = kSuccess;
+  }
+  k_mutex_unlock(&mutex_poller);
+  return ret;
+}
+
+/**
+ * @brief Removes a poller
+ *
+ * @param kId Poller identifier
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t poller_remove(const uint8_t kId) {
+  fn_t ret = kFailure;
+  if (POLLER_MAX <= kId) {
+    return kFailure;
+  }
+  k_mutex_lock(&mutex_poller, K_FOREVER);
+  if (true == pollers[kId].active) {
+    pollers[kId].active = false;
+    (void)k_work_cancel_delayable(&pollers[kId].work);
+    ret = kSuccess;
+  }
+  k_mutex_unlock(&mutex_poller);
+  return ret;
+}
+
+/**
+ * @brief Removes all pollers and drops the queued events
+ */
+void poller_clear(void) {
+  struct k_work_sync sync;
+  for (size_t i = 0; POLLER_MAX > i; i++) {
+    (void)poller_remove((uint8_t)i);
+    (void)k_work_cancel_delayable_sync(&pollers[i].work, &sync);
+  }
+  k_msgq_purge(&poller_msgq);
+}
+
+/**
+ * @brief Takes the oldest queued event
+ *
+ * @param event Destination
+ * @return true if an event was taken
+ * @return false if the queue is empty
+ */
+bool poller_get(poller_event_t *const event) {
+  return (0 == k_msgq_get(&poller_msgq, event, K_NO_WAIT));
+}
+
+/**
+ * @brief Gets the number of queued events
+ *
+ * @return uint32_t Number of events
+ */
+uint32_t poller_pending(void) { return k_msgq_num_used_get(&poller_msgq); }
+
+/**
+ * @brief Sets the function called after an event is queued
+ *
+ * @details Called from the poller work queue thread
+ *
+ * @param notify Function, or NULL
+ */
+void poller_set_notify(void (*notify)(void)) { poller_notify = notify; }
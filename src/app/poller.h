@@ -0,0 +1,142 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file poller.h
+ * @brief Sensor poller interface
+ * @details Samples ADC channels, the die temperature and I2C registers on a
+ * schedule in C and queues only the samples that pass a filter
+ */
+#ifndef APP_POLLER_H
+#define APP_POLLER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../drv/i2c.h"
+#include "../lib/fn.h"
+
+/**
+ * @brief Maximum number of pollers
+ */
+#define POLLER_MAX 8U
+
+/**
+ * @brief Number of events the queue holds
+ */
+#define POLLER_QUEUE_DEPTH 16U
+
+/**
+ * @brief Shortest polling period in milliseconds
+ */
+#define POLLER_PERIOD_MIN_MS 10U
+
+/**
+ * @typedef poller_source_t
+ * @brief Enumeration of sample sources
+ */
+typedef enum {
+  kPollerSourceAdc,  /**< ADC channel in millivolts */
+  kPollerSourceTemp, /**< Die temperature in millidegrees Celsius */
+  kPollerSourceI2c,  /**< I2C register, unsigned big-endian */
+} poller_source_t;
+
+/**
+ * @typedef poller_filter_t
+ * @brief Enumeration of filters deciding which samples are queued
+ */
+typedef enum {
+  kPollerFilterDelta,     /**< Changed by at least level since last queued */
+  kPollerFilterThreshold, /**< Crossed level (with hysteresis) */
+} poller_filter_t;
+
+/**
+ * @brief Poller configuration
+ */
+typedef struct {
+  poller_source_t source; /**< Sample source */
+  uint8_t channel;        /**< kPollerSourceAdc: channel index */
+  drv_i2c_target_t i2c;   /**< kPollerSourceI2c: device */
+  uint16_t reg;           /**< kPollerSourceI2c: register address */
+  uint8_t size;           /**< kPollerSourceI2c: bytes (1 to 4) */
+  uint32_t period_ms;     /**< Sampling period */
+  poller_filter_t filter; /**< Filter */
+  int32_t level;          /**< Delta, or threshold level */
+  int32_t hysteresis;     /**< kPollerFilterThreshold: hysteresis */
+} poller_config_t;
+
+/**
+ * @brief Queued sample
+ */
+typedef struct {
+  uint8_t id;    /**< Poller identifier */
+  int32_t value; /**< Sample value */
+} poller_event_t;
+
+/**
+ * @brief Initializes the poller and starts its work queue
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t poller_init(void);
+
+/**
+ * @brief Adds a poller and takes the first sample immediately
+ *
+ * @param kConfig Configuration
+ * @return int Poller identifier, or negative on error
+ */
+int poller_add(const poller_config_t *const kConfig);
+
+/**
+ * @brief Changes the filter of a poller
+ *
+ * @param kId Poller identifier
+ * @param kFilter Filter
+ * @param kLevel Delta, or threshold level
+ * @param kHysteresis Hysteresis of a threshold
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t poller_set_filter(const uint8_t kId, const poller_filter_t kFilter,
+                       const int32_t kLevel, const int32_t kHysteresis);
+
+/**
+ * @brief Removes a poller
+ *
+ * @param kId Poller identifier
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t poller_remove(const uint8_t kId);
+
+/**
+ * @brief Removes all pollers and drops the queued events
+ */
+void poller_clear(void);
+
+/**
+ * @brief Takes the oldest queued event
+ *
+ * @param event Destination
+ * @return true if an event was taken
+ * @return false if the queue is empty
+ */
+bool poller_get(poller_event_t *const event);
+
+/**
+ * @brief Gets the number of queued events
+ *
+ * @return uint32_t Number of events
+ */
+uint32_t poller_pending(void);
+
+/**
+ * @brief Sets the function called after an event is queued
+ *
+ * @details Called from the poller work queue thread
+ *
+ * @param notify Function, or NULL
+ */
+void poller_set_notify(void (*notify)(void));
+
+#endif  // APP_POLLER_H
@@ -0,0 +1,357 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file profiler.c
+ * @brief Implementation of the mruby/c task profiler
+ * @details The scheduler takes the HAL lock at the end of every dispatch, so
+ * the VM thread's lock hooks see each dispatch: the first lock finds the
+ * running task, and the unlock after which it is no longer running ends its
+ * dispatch. Times are taken with k_cycle_get_32(), which keeps counting while
+ * the CPU sleeps; each measurement is rounded to a cycle but the sums are
+ * unbiased. The profiler's own time is measured with the timing functions
+ * and reported as overhead. Heap use is reported by the allocator wrappers
+ * of the VM and charged to the running task.
+ */
+#include "profiler.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/timing/timing.h>
+
+#include "../../mrubyc/src/mrubyc.h"
+#include "../drv/ble.h"
+#include "../lib/fn.h"
+
+LOG_MODULE_REGISTER(app_profiler, LOG_LEVEL_WRN);
+
+/**
+ * @brief Profile of a task
+ */
+typedef struct {
+  mrbc_tcb *tcb;                             /**< Task, NULL if not seen */
+  uint64_t run_cycles;                       /**< Time running */
+  uint64_t sleep_cycles;                     /**< Time waiting or suspended */
+  uint64_t method_cycles[kProfilerClassNum]; /**< Time in C methods */
+  uint32_t dispatches;                       /**< Times the task was run */
+  uint32_t wait_start;                       /**< Cycle count when it waited */
+  bool waiting;                              /**< wait_start is valid */
+  int32_t heap_live;                         /**< Heap allocated, bytes */
+  int32_t heap_peak;                         /**< Peak of heap_live */
+} profiler_task_t;
+
+/** @brief Task profiles, by vm_id - 1 */
+static profiler_task_t tasks[MAX_VM_COUNT];
+
+/** @brief Task being dispatched, NULL between dispatches */
+static profiler_task_t *current = NULL;
+
+/** @brief Cycle count when the scheduler last finished a switch */
+static uint32_t mark = 0U;
+
+/** @brief Time no task was ready */
+static uint64_t idle_cycles = 0U;
+
+/** @brief Timing-function cycles spent in the profiler */
+static uint64_t overhead_cycles = 0U;
+
+/** @brief Uptime when profiling started */
+static int64_t start_ms = 0;
+
+/** @brief VM thread, NULL when not profiling */
+static k_tid_t vm_thread = NULL;
+
+/**
+ * @brief Work handler printing the statistics to the BLE console
+ *
+ * @param work Pointer to the work item
+ */
+static void profiler_report(struct k_work *const work);
+K_WORK_DELAYABLE_DEFINE(work_profiler_report, profiler_report);
+
+/**
+ * @brief Adds the time since start to the overhead
+ *
+ * @param start Timing counter at the start of the hook
+ */
+static void profiler_overhead(timing_t start) {
+  timing_t end = timing_counter_get();
+  overhead_cycles += timing_cycles_get(&start, &end);
+}
+
+/**
+ * @brief Gets the task being dispatched
+ *
+ * @details Called in the VM thread. If no dispatch is open, the monitored
+ * task in the RUNNING state opens one.
+ *
+ * @return profiler_task_t* Task, or NULL if no monitored task is running
+ */
+static profiler_task_t *profiler_current(void) {
+  if (NULL != current) {
+    return current;
+  }
+  for (size_t i = 0; MAX_VM_COUNT > i; i++) {
+    profiler_task_t *const task = &tasks[i];
+    if ((NULL != task->tcb) && (TASKSTATE_RUNNING == task->tcb->state)) {
+      task->dispatches++;
+      if (true == task->waiting) {
+        task->sleep_cycles += (uint32_t)(mark - task->wait_start);
+        task->waiting = false;
+      }
+      current = task;
+      break;
+    }
+  }
+  return current;
+}
+
+/**
+ * @brief Resets the statistics and starts profiling
+ *
+ * @details Call from the VM thread just before mrbc_run()
+ */
+void profiler_start(void) {
+  memset(tasks, 0, sizeof(tasks));
+  current = NULL;
+  idle_cycles = 0U;
+  overhead_cycles = 0U;
+  timing_init();
+  timing_start();
+  start_ms = k_uptime_get();
+  mark = k_cycle_get_32();
+  vm_thread = k_current_get();
+  if (0 < CONFIG_OPENBLINK_PROFILER_REPORT_SEC) {
+    k_work_reschedule(&work_profiler_report,
+                      K_SECONDS(CONFIG_OPENBLINK_PROFILER_REPORT_SEC));
+  }
+}
+
+/**
+ * @brief Stops profiling
+ *
+ * @details Call from the VM thread after mrbc_run() returns
+ */
+void profiler_stop(void) {
+  struct k_work_sync sync;
+  vm_thread = NULL;
+  (void)k_work_cancel_delayable_sync(&work_profiler_report, &sync);
+  timing_stop();
+}
+
+/**
+ * @brief Adds a task to the profile
+ *
+ * @details Tasks created by scripts are added when they call a timed method
+ *
+ * @param tcb Task
+ */
+void profiler_watch(mrbc_tcb *const tcb) {
+  if ((NULL != tcb) && (0 < tcb->vm.vm_id) &&
+      (MAX_VM_COUNT >= tcb->vm.vm_id)) {
+    tasks[tcb->vm.vm_id - 1].tcb = tcb;
+  }
+}
+
+/**
+ * @brief Hook for hal_disable_irq()
+ */
+void profiler_sched_lock(void) {
+  if (k_current_get() != vm_thread) {
+    return;
+  }
+  const timing_t kStart = timing_counter_get();
+  (void)profiler_current();
+  profiler_overhead(kStart);
+}
+
+/**
+ * @brief Hook for hal_enable_irq()
+ *
+ * @details Ends the dispatch once the task has left the RUNNING state
+ */
+void profiler_sched_unlock(void) {
+  if (k_current_get() != vm_thread) {
+    return;
+  }
+  const timing_t kStart = timing_counter_get();
+  const uint32_t kNow = k_cycle_get_32();
+  if (NULL != current) {
+    const uint8_t kState = current->tcb->state;
+    if (TASKSTATE_RUNNING == kState) {
+      profiler_overhead(kStart);
+      return;
+    }
+    current->run_cycles += (uint32_t)(kNow - mark);
+    if ((TASKSTATE_WAITING == kState) || (TASKSTATE_SUSPENDED == kState)) {
+      current->wait_start = kNow;
+      current->waiting = true;
+    } else if (TASKSTATE_DORMANT == kState) {
+      current->heap_live = 0;  // The VM frees the task's heap
+    }
+    current = NULL;
+  }
+  mark = kNow;
+  profiler_overhead(kStart);
+}
+
+/**
+ * @brief Hook for hal_idle_cpu() after the CPU idled
+ */
+void profiler_idle(void) {
+  if (k_current_get() != vm_thread) {
+    return;
+  }
+  const uint32_t kNow = k_cycle_get_32();
+  idle_cycles += (uint32_t)(kNow - mark);
+  mark = kNow;
+}
+
+/**
+ * @brief Starts timing a C method
+ *
+ * @param vm The mruby/c VM instance
+ * @param kClass Class of the method
+ * @return profiler_scope_t Timing to pass to profiler_method_end()
+ */
+profiler_scope_t profiler_method_begin(mrb_vm *const vm,
+                                       const profiler_class_t kClass) {
+  const timing_t kStart = timing_counter_get();
+  profiler_scope_t scope = {.index = UINT8_MAX, .cls = (uint8_t)kClass};
+  if ((NULL != vm_thread) && (0 < vm->vm_id) &&
+      (MAX_VM_COUNT >= vm->vm_id)) {
+    scope.index = (uint8_t)(vm->vm_id - 1);
+    if (NULL == tasks[scope.index].tcb) {
+      tasks[scope.index].tcb = MRBC_VM2TCB(vm);  // Created by a script
+    }
+    (void)profiler_current();
+  }
+  scope.start = k_cycle_get_32();
+  profiler_overhead(kStart);
+  return scope;
+}
+
+/**
+ * @brief Ends timing a C method
+ *
+ * @param kScope Timing from profiler_method_begin()
+ */
+void profiler_method_end(const profiler_scope_t *const kScope) {
+  const uint32_t kNow = k_cycle_get_32();
+  const timing_t kStart = timing_counter_get();
+  if ((MAX_VM_COUNT > kScope->index) && (kProfilerClassNum > kScope->cls)) {
+    tasks[kScope->index].method_cycles[kScope->cls] +=
+        (uint32_t)(kNow - kScope->start);
+  }
+  profiler_overhead(kStart);
+}
+
+/**
+ * @brief Charges a heap change to the running task
+ *
+ * @details Called by the allocator wrappers of the VM
+ *
+ * @param kBytes Bytes allocated (negative if freed)
+ */
+void profiler_heap(const int32_t kBytes) {
+  if (k_current_get() != vm_thread) {
+    return;
+  }
+  const timing_t kStart = timing_counter_get();
+  profiler_task_t *const task = profiler_current();
+  if (NULL != task) {
+    task->heap_live += kBytes;
+    task->heap_peak = MAX(task->heap_peak, task->heap_live);
+  }
+  profiler_overhead(kStart);
+}
+
+/**
+ * @brief Copies the statistics
+ *
+ * @details Counters updated by the VM thread while it was preempted may be
+ * one event behind each other
+ *
+ * @param stats Destination
+ * @return fn_t kSuccess if successful, kFailure if not profiling
+ */
+fn_t profiler_get(profiler_stats_t *const stats) {
+  if (NULL == vm_thread) {
+    return kFailure;
+  }
+  memset(stats, 0, sizeof(*stats));
+  const unsigned int kKey = irq_lock();
+  stats->elapsed_ms = (uint32_t)(k_uptime_get() - start_ms);
+  stats->idle_ms = (uint32_t)k_cyc_to_ms_floor64(idle_cycles);
+  stats->overhead_us =
+      (uint32_t)(timing_cycles_to_ns(overhead_cycles) / NSEC_PER_USEC);
+  for (size_t i = 0; MAX_VM_COUNT > i; i++) {
+    const profiler_task_t *const kTask = &tasks[i];
+    profiler_task_stats_t *const task = &stats->tasks[i];
+    if (NULL == kTask->tcb) {
+      continue;
+    }
+    task->vm_id = (uint8_t)(i + 1U);
+    task->run_ms = (uint32_t)k_cyc_to_ms_floor64(kTask->run_cycles);
+    task->sleep_ms = (uint32_t)k_cyc_to_ms_floor64(kTask->sleep_cycles);
+    task->dispatches = kTask->dispatches;
+    task->heap_peak = (uint32_t)MAX(kTask->heap_peak, 0);
+    for (size_t j = 0; kProfilerClassNum > j; j++) {
+      task->method_us[j] =
+          (uint32_t)k_cyc_to_us_floor64(kTask->method_cycles[j]);
+    }
+  }
+  irq_unlock(kKey);
+  return kSuccess;
+}
+
+/**
+ * @brief Work handler printing the statistics to the BLE console
+ *
+ * @param work Pointer to the work item
+ */
+static void profiler_report(struct k_work *const work) {
+  static const char *const kLabels[] = {
+#define PROFILER_CLASS_LABEL(kName, kLabel) kLabel,
+      PROFILER_CLASSES(PROFILER_CLASS_LABEL)
+#undef PROFILER_CLASS_LABEL
+  };
+  static profiler_stats_t stats;
+  char buf[128] = {0};
+  if (kSuccess != profiler_get(&stats)) {
+    return;
+  }
+  snprintf(buf, sizeof(buf), "prof %ums idle %ums overhead %uus\n",
+           stats.elapsed_ms, stats.idle_ms, stats.overhead_us);
+  ble_print(buf);
+  for (size_t i = 0; MAX_VM_COUNT > i; i++) {
+    const profiler_task_stats_t *const kTask = &stats.tasks[i];
+    if (0U == kTask->vm_id) {
+      continue;
+    }
+    int len = snprintf(buf, sizeof(buf),
+                       "vm%u run %ums disp %u sleep %ums heap %uB",
+                       kTask->vm_id, kTask->run_ms, kTask->dispatches,
+                       kTask->sleep_ms, kTask->heap_peak);
+    for (size_t j = 0; kProfilerClassNum > j; j++) {
+      if ((0U < kTask->method_us[j]) && (sizeof(buf) > (size_t)len)) {
+        len += snprintf(&buf[len], sizeof(buf) - (size_t)len, " %s %uus",
+                        kLabels[j], kTask->method_us[j]);
+      }
+    }
+    if (sizeof(buf) > ((size_t)len + 1U)) {
+      buf[len] = '\n';
+      buf[len + 1] = '\0';
+    }
+    ble_print(buf);
+  }
+  k_work_reschedule(&work_profiler_report,
+                    K_SECONDS(CONFIG_OPENBLINK_PROFILER_REPORT_SEC));
+}
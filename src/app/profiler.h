@@ -0,0 +1,182 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file profiler.h
+ * @brief mruby/c task profiler interface
+ * @details Accounts per task the run time, dispatches, sleep time, time in C
+ * methods by class and peak heap use. Built only with
+ * CONFIG_OPENBLINK_PROFILER; otherwise the hooks compile to nothing.
+ */
+#ifndef APP_PROFILER_H
+#define APP_PROFILER_H
+
+#include <stdint.h>
+#include <zephyr/toolchain.h>
+
+#include "../../mrubyc/src/mrubyc.h"
+#include "../lib/fn.h"
+
+/**
+ * @brief Classes whose C methods are timed: X(name, label)
+ */
+#define PROFILER_CLASSES(X)        \
+  X(Led, "LED")                    \
+  X(Input, "Input")                \
+  X(Ble, "BLE")                    \
+  X(Blink, "Blink")                \
+  X(Temperature, "Temperature")    \
+  X(Adc, "ADC")                    \
+  X(Pwm, "PWM")                    \
+  X(Gpio, "GPIO")                  \
+  X(Capture, "Capture")            \
+  X(I2c, "I2C")                    \
+  X(Store, "Store")                \
+  X(Poller, "Poller")
+
+/**
+ * @typedef profiler_class_t
+ * @brief Enumeration of timed classes
+ */
+typedef enum {
+#define PROFILER_CLASS_ENUM(kName, kLabel) kProfilerClass##kName,
+  PROFILER_CLASSES(PROFILER_CLASS_ENUM)
+#undef PROFILER_CLASS_ENUM
+  kProfilerClassNum, /**< Number of classes (not a class) */
+} profiler_class_t;
+
+/**
+ * @brief Statistics of one task
+ */
+typedef struct {
+  uint8_t vm_id;                         /**< VM ID, 0 if unused */
+  uint32_t run_ms;                       /**< Time running */
+  uint32_t sleep_ms;                     /**< Time waiting or suspended */
+  uint32_t dispatches;                   /**< Times the task was run */
+  uint32_t heap_peak;                    /**< Peak heap use in bytes */
+  uint32_t method_us[kProfilerClassNum]; /**< Time in C methods */
+} profiler_task_stats_t;
+
+/**
+ * @brief Statistics since the VM started
+ */
+typedef struct {
+  uint32_t elapsed_ms;                       /**< Time since the VM started */
+  uint32_t idle_ms;                          /**< Time no task was ready */
+  uint32_t overhead_us;                      /**< Time spent profiling */
+  profiler_task_stats_t tasks[MAX_VM_COUNT]; /**< Per task, by VM ID */
+} profiler_stats_t;
+
+/**
+ * @brief Timing of one C method call
+ */
+typedef struct {
+  uint32_t start; /**< Cycle count at entry */
+  uint8_t index;  /**< Task index (vm_id - 1) */
+  uint8_t cls;    /**< profiler_class_t */
+} profiler_scope_t;
+
+#if defined(CONFIG_OPENBLINK_PROFILER)
+
+/**
+ * @brief Times the calling C method until it returns
+ *
+ * @details Place at the top of a C method; needs the vm parameter
+ *
+ * @param kClass Class name in PROFILER_CLASSES (e.g. Led)
+ */
+#define PROFILER_SCOPE(kClass)                                        \
+  const profiler_scope_t profiler_scope                               \
+      __attribute__((cleanup(profiler_method_end))) =                 \
+          profiler_method_begin(vm, kProfilerClass##kClass)
+
+/**
+ * @brief Resets the statistics and starts profiling
+ *
+ * @details Call from the VM thread just before mrbc_run()
+ */
+void profiler_start(void);
+
+/**
+ * @brief Stops profiling
+ *
+ * @details Call from the VM thread after mrbc_run() returns
+ */
+void profiler_stop(void);
+
+/**
+ * @brief Adds a task to the profile
+ *
+ * @details Tasks created by scripts are added when they call a timed method
+ *
+ * @param tcb Task
+ */
+void profiler_watch(mrbc_tcb *const tcb);
+
+/**
+ * @brief Hook for hal_disable_irq()
+ */
+void profiler_sched_lock(void);
+
+/**
+ * @brief Hook for hal_enable_irq()
+ */
+void profiler_sched_unlock(void);
+
+/**
+ * @brief Hook for hal_idle_cpu() after the CPU idled
+ */
+void profiler_idle(void);
+
+/**
+ * @brief Hook for the allocator wrappers
+ *
+ * @param kBytes Bytes allocated (negative if freed)
+ */
+void profiler_heap(const int32_t kBytes);
+
+/**
+ * @brief Starts timing a C method
+ *
+ * @param vm The mruby/c VM instance
+ * @param kClass Class of the method
+ * @return profiler_scope_t Timing to pass to profiler_method_end()
+ */
+profiler_scope_t profiler_method_begin(mrb_vm *const vm,
+                                       const profiler_class_t kClass);
+
+/**
+ * @brief Ends timing a C method
+ *
+ * @param kScope Timing from profiler_method_begin()
+ */
+void profiler_method_end(const profiler_scope_t *const kScope);
+
+/**
+ * @brief Copies the statistics
+ *
+ * @param stats Destination
+ * @return fn_t kSuccess if successful, kFailure if not profiling
+ */
+fn_t profiler_get(profiler_stats_t *const stats);
+
+#else
+
+#define PROFILER_SCOPE(kClass) ((void)0)
+
+static inline void profiler_start(void) {}
+static inline void profiler_stop(void) {}
+static inline void profiler_watch(mrbc_tcb *const tcb) { ARG_UNUSED(tcb); }
+static inline void profiler_sched_lock(void) {}
+static inline void profiler_sched_unlock(void) {}
+static inline void profiler_idle(void) {}
+static inline void profiler_heap(const int32_t kBytes) { ARG_UNUSED(kBytes); }
+static inline fn_t profiler_get(profiler_stats_t *const stats) {
+  ARG_UNUSED(stats);
+  return kFailure;
+}
+
+#endif  // CONFIG_OPENBLINK_PROFILER
+
+#endif  // APP_PROFILER_H
@@ -0,0 +1,249 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file sampler.c
+ * @brief Implementation of the mruby/c bytecode sampling profiler
+ * @details The sample timer runs apart from the VM tick, with a period that
+ * does not divide it, so the samples do not lock to the scheduler. Each
+ * sample reads the state and program counter of the slot tasks; the
+ * interpreter itself is not touched. mruby/c runs the instructions in place
+ * in the loaded bytecode, so the offset of the program counter in the slot
+ * buffer is also its offset in the .mrb file. The histogram is an open
+ * addressing table keyed by slot and offset; samples that find no free
+ * bucket are counted as dropped.
+ */
+#include "sampler.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/printk.h>
+
+#include "../../mrubyc/src/mrubyc.h"
+#include "../drv/ble.h"
+#include "../lib/fn.h"
+#include "blink.h"
+
+LOG_MODULE_REGISTER(app_sampler, LOG_LEVEL_WRN);
+
+/**
+ * @brief Buckets probed before a sample is dropped
+ */
+#define SAMPLER_PROBES 8U
+
+/**
+ * @brief Histogram bucket
+ */
+typedef struct {
+  uint32_t count;  /**< Samples, 0 if the bucket is free */
+  uint16_t offset; /**< Program counter offset in the bytecode */
+  uint8_t slot;    /**< Slot index */
+} sampler_bucket_t;
+
+/**
+ * @brief Sampled slot task
+ */
+typedef struct {
+  mrbc_tcb *tcb;        /**< Task, NULL if not sampled */
+  const uint8_t *start; /**< Start of the bytecode */
+  size_t size;          /**< Size of the bytecode buffer */
+} sampler_slot_t;
+
+/**
+ * @brief Histogram and counters
+ */
+typedef struct {
+  sampler_bucket_t buckets[SAMPLER_BUCKETS]; /**< Samples by offset */
+  uint32_t samples;                          /**< All samples */
+  uint32_t other;                            /**< No slot task running */
+  uint32_t dropped;                          /**< Histogram full */
+} sampler_histogram_t;
+
+_Static_assert(0U == (SAMPLER_BUCKETS & (SAMPLER_BUCKETS - 1U)),
+               "SAMPLER_BUCKETS must be a power of 2");
+_Static_assert(UINT16_MAX >= BLINK_MAX_BYTECODE_SIZE,
+               "Bytecode offsets must fit in 16 bits");
+
+/** @brief Slot tasks */
+static sampler_slot_t slots[SAMPLER_SLOTS];
+
+/** @brief Histogram, written by the sample timer */
+static sampler_histogram_t histogram;
+
+/** @brief Copy of the histogram for printing (VM thread only) */
+static sampler_histogram_t snapshot;
+
+/** @brief true while sampling */
+static bool running = false;
+
+/** @brief Lock between the sample timer and the threads */
+static struct k_spinlock sampler_lock;
+
+/**
+ * @brief Timer handler taking one sample
+ *
+ * @param timer Timer instance
+ */
+static void sampler_expiry(struct k_timer *const timer);
+K_TIMER_DEFINE(timer_sampler, sampler_expiry, NULL);
+
+/**
+ * @brief Adds a sample to the histogram
+ *
+ * @details Called with sampler_lock held
+ *
+ * @param kSlot Slot index
+ * @param kOffset Program counter offset in the bytecode
+ */
+static void sampler_add(const uint8_t kSlot, const uint16_t kOffset) {
+  const uint32_t kKey = ((uint32_t)kSlot << 16) | kOffset;
+  // Fibonacci hashing spreads nearby offsets over the table
+  uint32_t index = (kKey * 2654435761U) >> 16;
+  for (size_t i = 0; SAMPLER_PROBES > i; i++) {
+    sampler_bucket_t *const bucket =
+        &histogram.buckets[index & (SAMPLER_BUCKETS - 1U)];
+    if (0U == bucket->count) {
+      bucket->slot = kSlot;
+      bucket->offset = kOffset;
+    }
+    if ((kSlot == bucket->slot) && (kOffset == bucket->offset)) {
+      bucket->count++;
+      return;
+    }
+    index++;
+  }
+  histogram.dropped++;
+}
+
+/**
+ * @brief Timer handler taking one sample
+ *
+ * @details Interrupt context. At most one task is in the RUNNING state.
+ *
+ * @param timer Timer instance
+ */
+static void sampler_expiry(struct k_timer *const timer) {
+  const k_spinlock_key_t kKey = k_spin_lock(&sampler_lock);
+  histogram.samples++;
+  bool sampled = false;
+  for (size_t i = 0; (SAMPLER_SLOTS > i) && (false == sampled); i++) {
+    const sampler_slot_t *const kSlot = &slots[i];
+    if ((NULL == kSlot->tcb) || (TASKSTATE_RUNNING != kSlot->tcb->state)) {
+      continue;
+    }
+    const uint8_t *const kInst = kSlot->tcb->vm.inst;
+    if ((kSlot->start <= kInst) && ((kSlot->start + kSlot->size) > kInst)) {
+      sampler_add((uint8_t)i, (uint16_t)(kInst - kSlot->start));
+      sampled = true;
+    }
+  }
+  if (false == sampled) {
+    histogram.other++;  // Idle, or a task created by a script
+  }
+  k_spin_unlock(&sampler_lock, kKey);
+}
+
+/**
+ * @brief Clears the histogram and starts sampling
+ *
+ * @details Call from the VM thread just before mrbc_run()
+ */
+void sampler_start(void) {
+  const k_spinlock_key_t kKey = k_spin_lock(&sampler_lock);
+  memset(&histogram, 0, sizeof(histogram));
+  k_spin_unlock(&sampler_lock, kKey);
+  running = true;
+  k_timer_start(&timer_sampler, K_USEC(CONFIG_OPENBLINK_SAMPLER_PERIOD_US),
+                K_USEC(CONFIG_OPENBLINK_SAMPLER_PERIOD_US));
+}
+
+/**
+ * @brief Stops sampling and prints the histogram
+ *
+ * @details Call from the VM thread after mrbc_run() returns
+ */
+void sampler_stop(void) {
+  k_timer_stop(&timer_sampler);
+  (void)sampler_dump();
+  running = false;
+  // The tasks live in the VM heap
+  const k_spinlock_key_t kKey = k_spin_lock(&sampler_lock);
+  memset(slots, 0, sizeof(slots));
+  k_spin_unlock(&sampler_lock, kKey);
+}
+
+/**
+ * @brief Samples the task of a slot
+ *
+ * @param kIndex Slot index (0 for slot 1)
+ * @param tcb Task of the slot
+ * @param kBytecode Bytecode the task was created from
+ * @param kSize Size of the bytecode buffer
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t sampler_watch(const uint8_t kIndex, mrbc_tcb *const tcb,
+                   const uint8_t *const kBytecode, const size_t kSize) {
+  if ((SAMPLER_SLOTS <= kIndex) || (NULL == kBytecode)) {
+    return kFailure;
+  }
+  const k_spinlock_key_t kKey = k_spin_lock(&sampler_lock);
+  slots[kIndex].tcb = tcb;
+  slots[kIndex].start = kBytecode;
+  slots[kIndex].size = kSize;
+  k_spin_unlock(&sampler_lock, kKey);
+  return kSuccess;
+}
+
+/**
+ * @brief Prints a line to the BLE console and the kernel console
+ *
+ * @param kLine Line including the newline
+ */
+static void sampler_print(const char *const kLine) {
+  ble_print(kLine);
+  printk("%s", kLine);
+}
+
+/**
+ * @brief Prints the histogram to the BLE console and the kernel console
+ *
+ * @details One "smp <slot> <offset> <count>" line per bucket between a
+ * "smp begin <period_us> <samples> <other> <dropped>" and a "smp end" line.
+ * Slots are numbered from 1.
+ *
+ * @return fn_t kSuccess if successful, kFailure if not sampling
+ */
+fn_t sampler_dump(void) {
+  char buf[64] = {0};
+  if (false == running) {
+    return kFailure;
+  }
+  const k_spinlock_key_t kKey = k_spin_lock(&sampler_lock);
+  memcpy(&snapshot, &histogram, sizeof(snapshot));
+  k_spin_unlock(&sampler_lock, kKey);
+  snprintf(buf, sizeof(buf), "smp begin %u %u %u %u\n",
+           (unsigned int)CONFIG_OPENBLINK_SAMPLER_PERIOD_US, snapshot.samples,
+           snapshot.other, snapshot.dropped);
+  sampler_print(buf);
+  for (size_t i = 0; SAMPLER_BUCKETS > i; i++) {
+    const sampler_bucket_t *const kBucket = &snapshot.buckets[i];
+    if (0U == kBucket->count) {
+      continue;
+    }
+    snprintf(buf, sizeof(buf), "smp %u %u %u\n",
+             (unsigned int)(kBucket->slot + 1U),
+             (unsigned int)kBucket->offset, kBucket->count);
+    sampler_print(buf);
+  }
+  sampler_print("smp end\n");
+  if (0U < snapshot.dropped) {
+    LOG_WRN("%u samples dropped, histogram full", snapshot.dropped);
+  }
+  return kSuccess;
+}
@@ -0,0 +1,86 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file sampler.h
+ * @brief mruby/c bytecode sampling profiler interface
+ * @details A timer samples the program counter of the running slot task into
+ * a histogram of offsets in the slot's bytecode. The offset names the IREP
+ * and the instruction; tools/mrb_samples.py maps it to methods and lines.
+ * Built only with CONFIG_OPENBLINK_SAMPLER; otherwise the calls compile to
+ * nothing.
+ */
+#ifndef APP_SAMPLER_H
+#define APP_SAMPLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/toolchain.h>
+
+#include "../../mrubyc/src/mrubyc.h"
+#include "../lib/fn.h"
+
+/**
+ * @brief Number of sampled slot tasks
+ */
+#define SAMPLER_SLOTS 2U
+
+/**
+ * @brief Number of histogram buckets (power of 2)
+ */
+#define SAMPLER_BUCKETS 256U
+
+#if defined(CONFIG_OPENBLINK_SAMPLER)
+
+/**
+ * @brief Clears the histogram and starts sampling
+ *
+ * @details Call from the VM thread just before mrbc_run()
+ */
+void sampler_start(void);
+
+/**
+ * @brief Stops sampling and prints the histogram
+ *
+ * @details Call from the VM thread after mrbc_run() returns
+ */
+void sampler_stop(void);
+
+/**
+ * @brief Samples the task of a slot
+ *
+ * @param kIndex Slot index (0 for slot 1)
+ * @param tcb Task of the slot
+ * @param kBytecode Bytecode the task was created from
+ * @param kSize Size of the bytecode buffer
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t sampler_watch(const uint8_t kIndex, mrbc_tcb *const tcb,
+                   const uint8_t *const kBytecode, const size_t kSize);
+
+/**
+ * @brief Prints the histogram to the BLE console and the kernel console
+ *
+ * @return fn_t kSuccess if successful, kFailure if not sampling
+ */
+fn_t sampler_dump(void);
+
+#else
+
+static inline void sampler_start(void) {}
+static inline void sampler_stop(void) {}
+static inline fn_t sampler_watch(const uint8_t kIndex, mrbc_tcb *const tcb,
+                                 const uint8_t *const kBytecode,
+                                 const size_t kSize) {
+  ARG_UNUSED(kIndex);
+  ARG_UNUSED(tcb);
+  ARG_UNUSED(kBytecode);
+  ARG_UNUSED(kSize);
+  return kFailure;
+}
+static inline fn_t sampler_dump(void) { return kFailure; }
+
+#endif  // CONFIG_OPENBLINK_SAMPLER
+
+#endif  // APP_SAMPLER_H
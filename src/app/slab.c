@@ -0,0 +1,259 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file slab.c
+ * @brief Implementation of the slab front-end for the mruby/c heap
+ * @details The arena is split into pages, and a page is given to one slot
+ * size the first time that size needs room. Each size keeps a list of freed
+ * slots and hands out the unused part of its newest page, so allocating and
+ * freeing take constant time. Pages stay with their size until the VM is
+ * reloaded. When the arena is full, blocks go to the general allocator. The
+ * owner of each slot is kept in a side table, since slots have no header.
+ * Called from the VM thread only, like the general allocator.
+ */
+#include "slab.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(app_slab, LOG_LEVEL_WRN);
+
+/**
+ * @brief Size of a page in bytes
+ */
+#define SLAB_PAGE_SIZE 256U
+
+/**
+ * @brief Number of pages in the arena
+ */
+#define SLAB_PAGES (CONFIG_OPENBLINK_HEAP_SLAB_SIZE / SLAB_PAGE_SIZE)
+
+/**
+ * @brief Size of the arena in bytes
+ */
+#define SLAB_ARENA_SIZE (SLAB_PAGES * SLAB_PAGE_SIZE)
+
+/**
+ * @brief Freed slot, linked through its first bytes
+ */
+typedef struct slab_free_slot {
+  struct slab_free_slot *next; /**< Next freed slot, NULL at the end */
+} slab_free_slot_t;
+
+/**
+ * @brief Slots of one size
+ */
+typedef struct {
+  slab_free_slot_t *free; /**< Freed slots */
+  uint8_t *next;          /**< Next unused slot of the newest page */
+  uint8_t *end;           /**< End of the newest page */
+} slab_class_t;
+
+/** @brief Start of the arena, NULL before slab_init() */
+static uint8_t *arena = NULL;
+
+/** @brief Pages given to a slot size */
+static size_t pages_used = 0U;
+
+/** @brief Slot size index of each page */
+static uint8_t page_class[SLAB_PAGES];
+
+/** @brief Owner VM ID + 1 of each granule, 0 if not an allocated slot */
+static uint8_t owners[SLAB_ARENA_SIZE / SLAB_GRANULE];
+
+/** @brief Slots by size */
+static slab_class_t classes[SLAB_CLASSES];
+
+/** @brief Bytes in allocated slots */
+static uint32_t used_bytes = 0U;
+
+/**
+ * @brief Gets the size of a slot size index
+ *
+ * @param kClass Slot size index
+ * @return size_t Size in bytes
+ */
+static inline size_t slab_class_size(const size_t kClass) {
+  return (kClass + 1U) * SLAB_GRANULE;
+}
+
+/**
+ * @brief Gets the side table index of a slot
+ *
+ * @param kPtr Slot
+ * @return size_t Index in owners
+ */
+static inline size_t slab_granule(const void *const kPtr) {
+  return (size_t)((const uint8_t *)kPtr - arena) / SLAB_GRANULE;
+}
+
+/**
+ * @brief Takes the slab arena from the start of the VM heap pool
+ *
+ * @details Call before mrbc_init() with the rest of the pool. Frees all
+ * slots. The arena is aligned to SLAB_GRANULE, so the rest of the pool is
+ * too.
+ *
+ * @param pool Start of the VM heap pool
+ * @param kSize Size of the pool in bytes
+ * @return size_t Bytes taken from the start of the pool
+ */
+size_t slab_init(uint8_t *const pool, const size_t kSize) {
+  const size_t kSkip =
+      (size_t)(ROUND_UP((uintptr_t)pool, SLAB_GRANULE) - (uintptr_t)pool);
+  arena = NULL;
+  if ((kSkip + (2U * SLAB_ARENA_SIZE)) > kSize) {
+    LOG_ERR("Heap too small for a %u byte slab arena", SLAB_ARENA_SIZE);
+    return 0U;
+  }
+  arena = &pool[kSkip];
+  pages_used = 0U;
+  used_bytes = 0U;
+  memset(page_class, 0, sizeof(page_class));
+  memset(owners, 0, sizeof(owners));
+  memset(classes, 0, sizeof(classes));
+  return kSkip + SLAB_ARENA_SIZE;
+}
+
+/**
+ * @brief Allocates a slot
+ *
+ * @param kSize Size in bytes
+ * @param kVmId VM ID of the owner, 0 for none
+ * @return void* Slot, or NULL if too large or the arena is full
+ */
+void *slab_alloc(const unsigned int kSize, const int kVmId) {
+  if ((NULL == arena) || (slab_class_size(SLAB_CLASSES - 1U) < kSize)) {
+    return NULL;
+  }
+  const size_t kClass = (0U < kSize) ? ((kSize - 1U) / SLAB_GRANULE) : 0U;
+  const size_t kSlotSize = slab_class_size(kClass);
+  slab_class_t *const cls = &classes[kClass];
+  uint8_t *slot = NULL;
+  if (NULL != cls->free) {
+    slot = (uint8_t *)cls->free;
+    cls->free = cls->free->next;
+  } else {
+    if ((NULL == cls->next) || ((cls->next + kSlotSize) > cls->end)) {
+      if (SLAB_PAGES <= pages_used) {
+        return NULL;  // The general allocator takes over
+      }
+      page_class[pages_used] = (uint8_t)kClass;
+      cls->next = &arena[pages_used * SLAB_PAGE_SIZE];
+      cls->end = cls->next + SLAB_PAGE_SIZE;
+      pages_used++;
+    }
+    slot = cls->next;
+    cls->next += kSlotSize;
+  }
+  owners[slab_granule(slot)] = (uint8_t)(kVmId + 1);
+  used_bytes += kSlotSize;
+  return slot;
+}
+
+/**
+ * @brief Checks whether a block is a slot
+ *
+ * @param kPtr Block
+ * @return true if the block is in the slab arena
+ */
+bool slab_owns(const void *const kPtr) {
+  const uint8_t *const kByte = (const uint8_t *)kPtr;
+  return (NULL != arena) && (arena <= kByte) &&
+         ((arena + SLAB_ARENA_SIZE) > kByte);
+}
+
+/**
+ * @brief Frees a slot
+ *
+ * @param ptr Slot
+ */
+void slab_free(void *const ptr) {
+  const size_t kGranule = slab_granule(ptr);
+  if (0U == owners[kGranule]) {
+    LOG_ERR("Slot %p freed twice", ptr);
+    return;
+  }
+  const size_t kClass = page_class[kGranule / (SLAB_PAGE_SIZE / SLAB_GRANULE)];
+  slab_free_slot_t *const slot = (slab_free_slot_t *)ptr;
+  owners[kGranule] = 0U;
+  used_bytes -= slab_class_size(kClass);
+  slot->next = classes[kClass].free;
+  classes[kClass].free = slot;
+}
+
+/**
+ * @brief Gets the usable size of a slot
+ *
+ * @param kPtr Slot
+ * @return unsigned int Size in bytes
+ */
+unsigned int slab_usable_size(const void *const kPtr) {
+  const size_t kPage =
+      (size_t)((const uint8_t *)kPtr - arena) / SLAB_PAGE_SIZE;
+  return (unsigned int)slab_class_size(page_class[kPage]);
+}
+
+/**
+ * @brief Sets the VM ID of the owner of a slot
+ *
+ * @param kPtr Slot
+ * @param kVmId VM ID, 0 for none
+ */
+void slab_set_vm_id(const void *const kPtr, const int kVmId) {
+  owners[slab_granule(kPtr)] = (uint8_t)(kVmId + 1);
+}
+
+/**
+ * @brief Gets the VM ID of the owner of a slot
+ *
+ * @param kPtr Slot
+ * @return int VM ID, 0 for none
+ */
+int slab_get_vm_id(const void *const kPtr) {
+  const uint8_t kOwner = owners[slab_granule(kPtr)];
+  return (0U < kOwner) ? (kOwner - 1) : 0;
+}
+
+/**
+ * @brief Frees all slots owned by a VM
+ *
+ * @details Counterpart of mrbc_free_all() for the slots; visits every slot
+ * of the pages in use
+ *
+ * @param kVmId VM ID
+ * @param freed Called with each slot before it is freed, or NULL
+ */
+void slab_free_vm(const int kVmId, void (*const freed)(const void *kPtr)) {
+  const uint8_t kOwner = (uint8_t)(kVmId + 1);
+  for (size_t page = 0; pages_used > page; page++) {
+    const size_t kSlotSize = slab_class_size(page_class[page]);
+    uint8_t *const start = &arena[page * SLAB_PAGE_SIZE];
+    for (size_t offset = 0; SLAB_PAGE_SIZE >= (offset + kSlotSize);
+         offset += kSlotSize) {
+      if (kOwner == owners[slab_granule(&start[offset])]) {
+        if (NULL != freed) {
+          freed(&start[offset]);
+        }
+        slab_free(&start[offset]);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Gets the size and use of the slab arena
+ *
+ * @param total Size of the arena in bytes
+ * @param used Bytes in allocated slots
+ */
+void slab_stats(uint32_t *const total, uint32_t *const used) {
+  *total = (NULL != arena) ? SLAB_ARENA_SIZE : 0U;
+  *used = used_bytes;
+}
@@ -0,0 +1,150 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file slab.h
+ * @brief Slab front-end for the mruby/c heap
+ * @details Serves the small blocks that make up most mruby/c objects from
+ * fixed-size slots, so they do not fragment the general allocator. Built only
+ * with CONFIG_OPENBLINK_HEAP_SLAB; otherwise every call falls through to the
+ * general allocator.
+ */
+#ifndef APP_SLAB_H
+#define APP_SLAB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/toolchain.h>
+
+/**
+ * @brief Step between the slot sizes in bytes
+ */
+#define SLAB_GRANULE 16U
+
+/**
+ * @brief Number of slot sizes (16, 32 and 48 bytes)
+ */
+#define SLAB_CLASSES 3U
+
+#if defined(CONFIG_OPENBLINK_HEAP_SLAB)
+
+/**
+ * @brief Takes the slab arena from the start of the VM heap pool
+ *
+ * @details Call before mrbc_init() with the rest of the pool. Frees all
+ * slots.
+ *
+ * @param pool Start of the VM heap pool
+ * @param kSize Size of the pool in bytes
+ * @return size_t Bytes taken from the start of the pool
+ */
+size_t slab_init(uint8_t *const pool, const size_t kSize);
+
+/**
+ * @brief Allocates a slot
+ *
+ * @param kSize Size in bytes
+ * @param kVmId VM ID of the owner, 0 for none
+ * @return void* Slot, or NULL if too large or the arena is full
+ */
+void *slab_alloc(const unsigned int kSize, const int kVmId);
+
+/**
+ * @brief Checks whether a block is a slot
+ *
+ * @param kPtr Block
+ * @return true if the block is in the slab arena
+ */
+bool slab_owns(const void *const kPtr);
+
+/**
+ * @brief Frees a slot
+ *
+ * @param ptr Slot
+ */
+void slab_free(void *const ptr);
+
+/**
+ * @brief Gets the usable size of a slot
+ *
+ * @param kPtr Slot
+ * @return unsigned int Size in bytes
+ */
+unsigned int slab_usable_size(const void *const kPtr);
+
+/**
+ * @brief Sets the VM ID of the owner of a slot
+ *
+ * @param kPtr Slot
+ * @param kVmId VM ID, 0 for none
+ */
+void slab_set_vm_id(const void *const kPtr, const int kVmId);
+
+/**
+ * @brief Gets the VM ID of the owner of a slot
+ *
+ * @param kPtr Slot
+ * @return int VM ID, 0 for none
+ */
+int slab_get_vm_id(const void *const kPtr);
+
+/**
+ * @brief Frees all slots owned by a VM
+ *
+ * @param kVmId VM ID
+ * @param freed Called with each slot before it is freed, or NULL
+ */
+void slab_free_vm(const int kVmId, void (*const freed)(const void *kPtr));
+
+/**
+ * @brief Gets the size and use of the slab arena
+ *
+ * @param total Size of the arena in bytes
+ * @param used Bytes in allocated slots
+ */
+void slab_stats(uint32_t *const total, uint32_t *const used);
+
+#else
+
+static inline size_t slab_init(uint8_t *const pool, const size_t kSize) {
+  ARG_UNUSED(pool);
+  ARG_UNUSED(kSize);
+  return 0U;
+}
+static inline void *slab_alloc(const unsigned int kSize, const int kVmId) {
+  ARG_UNUSED(kSize);
+  ARG_UNUSED(kVmId);
+  return NULL;
+}
+static inline bool slab_owns(const void *const kPtr) {
+  ARG_UNUSED(kPtr);
+  return false;
+}
+static inline void slab_free(void *const ptr) { ARG_UNUSED(ptr); }
+static inline unsigned int slab_usable_size(const void *const kPtr) {
+  ARG_UNUSED(kPtr);
+  return 0U;
+}
+static inline void slab_set_vm_id(const void *const kPtr, const int kVmId) {
+  ARG_UNUSED(kPtr);
+  ARG_UNUSED(kVmId);
+}
+static inline int slab_get_vm_id(const void *const kPtr) {
+  ARG_UNUSED(kPtr);
+  return 0;
+}
+static inline void slab_free_vm(const int kVmId,
+                                void (*const freed)(const void *kPtr)) {
+  ARG_UNUSED(kVmId);
+  ARG_UNUSED(freed);
+}
+static inline void slab_stats(uint32_t *const total, uint32_t *const used) {
+  *total = 0U;
+  *used = 0U;
+}
+
+#endif  // CONFIG_OPENBLINK_HEAP_SLAB
+
+#endif  // APP_SLAB_H
@@ -0,0 +1,396 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file store.c
+ * @brief Implementation of the user key/value store
+ * @details All keys are held in a fixed RAM cache. Reads never touch flash;
+ * writes and deletes only mark the cache entry and schedule one commit
+ * STORE_COMMIT_DELAY_MS later, so bursts of updates from scripts end up as a
+ * single flash write per key. Each key is stored as openblink/user/<key>
+ * with a one byte type tag followed by the value.
+ */
+#include "store.h"
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+
+#include "../lib/fn.h"
+
+LOG_MODULE_REGISTER(app_store, LOG_LEVEL_WRN);
+
+/** @brief Settings subtree holding the user keys */
+#define STORE_SUBTREE "openblink/user"
+
+/** @brief Maximum length of a full settings name */
+#define STORE_NAME_MAX_LENGTH \
+  (sizeof(STORE_SUBTREE) + STORE_KEY_MAX_LENGTH + 1U)
+
+/** @brief Size of a record in flash (type tag + value) */
+#define STORE_RECORD_MAX_SIZE (1U + STORE_VALUE_MAX_SIZE)
+
+/**
+ * @typedef store_state_t
+ * @brief Enumeration of cache entry states
+ */
+typedef enum {
+  kStoreStateFree,    /**< Slot unused */
+  kStoreStateClean,   /**< Same as flash */
+  kStoreStateDirty,   /**< Changed, not yet written */
+  kStoreStateDeleted, /**< Deleted, not yet removed from flash */
+} store_state_t;
+
+/**
+ * @brief Cache entry
+ */
+typedef struct {
+  char key[STORE_KEY_MAX_LENGTH + 1U]; /**< Key name */
+  uint8_t state;                       /**< store_state_t */
+  uint8_t type;                        /**< store_type_t */
+  uint8_t size;                        /**< Value size in bytes */
+  uint8_t data[STORE_VALUE_MAX_SIZE];  /**< Value */
+} store_entry_t;
+
+/** @brief Write-back cache */
+static store_entry_t store_cache[STORE_MAX_KEYS];
+
+/** @brief Mutex protecting the cache */
+static K_MUTEX_DEFINE(mutex_store);
+
+static int store_handle_set(const char *name, size_t len,
+                            settings_read_cb read_cb, void *cb_arg);
+static int store_handle_export(int (*cb)(const char *name, const void *value,
+                                         size_t val_len));
+
+/** @brief Settings handler for the user subtree */
+static struct settings_handler store_handler = {
+    .name = STORE_SUBTREE,
+    .h_get = NULL,
+    .h_set = store_handle_set,
+    .h_commit = NULL,
+    .h_export = store_handle_export};
+
+/**
+ * @brief Work handler committing the cache
+ *
+ * @param work Pointer to the work item
+ */
+static void store_work_commit(struct k_work *const work);
+K_WORK_DELAYABLE_DEFINE(work_store_commit, store_work_commit);
+
+/**
+ * @brief Checks whether a key can be used as a settings name component
+ *
+ * @param kKey Key name
+ * @return true if the key is valid
+ * @return false otherwise
+ */
+static bool store_key_is_valid(const char *const kKey) {
+  if (NULL == kKey) {
+    return false;
+  }
+  const size_t kLength = strnlen(kKey, STORE_KEY_MAX_LENGTH + 1U);
+  if ((0U == kLength) || (STORE_KEY_MAX_LENGTH < kLength)) {
+    return false;
+  }
+  for (size_t i = 0; kLength > i; i++) {
+    if ((0 == isalnum((unsigned char)kKey[i])) && ('_' != kKey[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Finds the cache entry of a key (caller holds mutex_store)
+ *
+ * @param kKey Key name
+ * @return store_entry_t* Entry, or NULL if not cached
+ */
+static store_entry_t *store_find(const char *const kKey) {
+  for (size_t i = 0; STORE_MAX_KEYS > i; i++) {
+    const store_entry_t *const kEntry = &store_cache[i];
+    if ((kStoreStateFree != kEntry->state) &&
+        (0 == strncmp(kEntry->key, kKey, sizeof(kEntry->key)))) {
+      return &store_cache[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Finds the entry of a key or allocates a free one (caller holds
+ * mutex_store)
+ *
+ * @param kKey Key name
+ * @return store_entry_t* Entry, or NULL if the cache is full
+ */
+static store_entry_t *store_find_or_alloc(const char *const kKey) {
+  store_entry_t *entry = store_find(kKey);
+  if (NULL != entry) {
+    return entry;
+  }
+  for (size_t i = 0; STORE_MAX_KEYS > i; i++) {
+    if (kStoreStateFree == store_cache[i].state) {
+      entry = &store_cache[i];
+      memset(entry, 0, sizeof(*entry));
+      strncpy(entry->key, kKey, STORE_KEY_MAX_LENGTH);
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Initializes the store
+ *
+ * @details Registers the settings handler only; the persisted keys are
+ * loaded with the openblink subtree by config_init(), which runs after this
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t store_init(void) {
+  static bool is_initialized = false;
+  int ret;
+
+  if (false == is_initialized) {
+    is_initialized = true;
+
+    ret = settings_register(&store_handler);
+    if (0 != ret) {
+      LOG_ERR("Failed to register settings handler ret:%d", ret);
+      return kFailure;
+    }
+  }
+
+  return kSuccess;
+}
+
+/**
+ * @brief Gets a value from the store
+ *
+ * @param kKey Key name
+ * @param type Type of the stored value
+ * @param buf Destination buffer
+ * @param kSize Size of the destination buffer
+ * @return ssize_t Size of the value in bytes, or negative if not found
+ */
+ssize_t store_get(const char *const kKey, store_type_t *const type,
+                  uint8_t *const buf, const size_t kSize) {
+  ssize_t ret = -ENOENT;
+  if (false == store_key_is_valid(kKey)) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&mutex_store, K_FOREVER);
+  const store_entry_t *const kEntry = store_find(kKey);
+  if ((NULL != kEntry) && (kStoreStateDeleted != kEntry->state)) {
+    if (kSize >= kEntry->size) {
+      *type = (store_type_t)kEntry->type;
+      memcpy(buf, kEntry->data, kEntry->size);
+      ret = (ssize_t)kEntry->size;
+    } else {
+      ret = -ENOMEM;
+    }
+  }
+  k_mutex_unlock(&mutex_store);
+  return ret;
+}
+
+/**
+ * @brief Sets a value in the store and schedules a batched commit
+ *
+ * @param kKey Key name
+ * @param kType Type of the value
+ * @param kData Value data
+ * @param kSize Size of the value in bytes
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t store_set(const char *const kKey, const store_type_t kType,
+               const uint8_t *const kData, const size_t kSize) {
+  fn_t ret = kFailure;
+  bool changed = false;
+  if ((false == store_key_is_valid(kKey)) || (kStoreTypeNum <= kType) ||
+      (STORE_VALUE_MAX_SIZE < kSize)) {
+    return kFailure;
+  }
+
+  k_mutex_lock(&mutex_store, K_FOREVER);
+  store_entry_t *const entry = store_find_or_alloc(kKey);
+  if (NULL != entry) {
+    const bool kUnchanged = (kStoreStateDeleted != entry->state) &&
+                            (kStoreStateFree != entry->state) &&
+                            (kType == entry->type) && (kSize == entry->size) &&
+                            (0 == memcmp(entry->data, kData, kSize));
+    if (false == kUnchanged) {
+      entry->type = (uint8_t)kType;
+      entry->size = (uint8_t)kSize;
+      memcpy(entry->data, kData, kSize);
+      entry->state = kStoreStateDirty;
+      changed = true;
+    }
+    ret = kSuccess;
+  } else {
+    LOG_WRN("Store is full (%u keys)", STORE_MAX_KEYS);
+  }
+  k_mutex_unlock(&mutex_store);
+
+  if (true == changed) {
+    k_work_schedule(&work_store_commit, K_MSEC(STORE_COMMIT_DELAY_MS));
+  }
+  return ret;
+}
+
+/**
+ * @brief Deletes a value from the store and schedules a batched commit
+ *
+ * @param kKey Key name
+ * @return fn_t kSuccess if deleted, kFailure if not found
+ */
+fn_t store_delete(const char *const kKey) {
+  fn_t ret = kFailure;
+  if (false == store_key_is_valid(kKey)) {
+    return kFailure;
+  }
+
+  k_mutex_lock(&mutex_store, K_FOREVER);
+  store_entry_t *const entry = store_find(kKey);
+  if ((NULL != entry) && (kStoreStateDeleted != entry->state)) {
+    entry->state = kStoreStateDeleted;
+    ret = kSuccess;
+  }
+  k_mutex_unlock(&mutex_store);
+
+  if (kSuccess == ret) {
+    k_work_schedule(&work_store_commit, K_MSEC(STORE_COMMIT_DELAY_MS));
+  }
+  return ret;
+}
+
+/**
+ * @brief Writes all uncommitted changes to settings_storage now
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t store_flush(void) {
+  fn_t ret = kSuccess;
+  char name[STORE_NAME_MAX_LENGTH] = {0};
+  uint8_t record[STORE_RECORD_MAX_SIZE] = {0};
+
+  k_mutex_lock(&mutex_store, K_FOREVER);
+  for (size_t i = 0; STORE_MAX_KEYS > i; i++) {
+    store_entry_t *const entry = &store_cache[i];
+    int rc = 0;
+    if ((kStoreStateDirty != entry->state) &&
+        (kStoreStateDeleted != entry->state)) {
+      continue;
+    }
+    snprintf(name, sizeof(name), STORE_SUBTREE "/%s", entry->key);
+    if (kStoreStateDirty == entry->state) {
+      record[0] = entry->type;
+      memcpy(&record[1], entry->data, entry->size);
+      rc = settings_save_one(name, record, 1U + entry->size);
+    } else {
+      rc = settings_delete(name);
+    }
+    if (0 == rc) {
+      entry->state = (kStoreStateDirty == entry->state) ? kStoreStateClean
+                                                        : kStoreStateFree;
+    } else {
+      LOG_ERR("Failed to commit %s ret:%d", name, rc);
+      ret = kFailure;
+    }
+  }
+  k_mutex_unlock(&mutex_store);
+  return ret;
+}
+
+/**
+ * @brief Work handler committing the cache
+ *
+ * @param work Pointer to the work item
+ */
+static void store_work_commit(struct k_work *const work) {
+  if (kSuccess != store_flush()) {
+    k_work_schedule(&work_store_commit, K_MSEC(STORE_COMMIT_DELAY_MS));
+  }
+}
+
+/**
+ * @brief Handles set requests for the user subtree (loading from flash)
+ *
+ * @param name Key name relative to the subtree
+ * @param len Length of the value
+ * @param read_cb Callback function to read the value
+ * @param cb_arg Callback argument
+ * @return int 0 on success, negative on error
+ */
+static int store_handle_set(const char *name, size_t len,
+                            settings_read_cb read_cb, void *cb_arg) {
+  const char *next;
+  uint8_t record[STORE_RECORD_MAX_SIZE] = {0};
+  int ret = -ENOENT;
+
+  (void)settings_name_next(name, &next);
+  if ((NULL != next) || (false == store_key_is_valid(name))) {
+    return -ENOENT;
+  }
+  if ((1U > len) || (sizeof(record) < len)) {
+    LOG_WRN("Store: ignoring %s (%u bytes)", name, len);
+    return -EINVAL;
+  }
+  const ssize_t kRead = read_cb(cb_arg, record, len);
+  if (((ssize_t)len != kRead) || (kStoreTypeNum <= record[0])) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&mutex_store, K_FOREVER);
+  store_entry_t *const entry = store_find_or_alloc(name);
+  if (NULL != entry) {
+    entry->type = record[0];
+    entry->size = (uint8_t)(len - 1U);
+    memcpy(entry->data, &record[1], entry->size);
+    entry->state = kStoreStateClean;
+    ret = 0;
+  } else {
+    LOG_WRN("Store is full, %s not loaded", name);
+    ret = -ENOMEM;
+  }
+  k_mutex_unlock(&mutex_store);
+  return ret;
+}
+
+/**
+ * @brief Handles export requests for the user subtree
+ *
+ * @param cb Callback function to export settings
+ * @return int 0 on success, negative on error
+ */
+static int store_handle_export(int (*cb)(const char *name, const void *value,
+                                         size_t val_len)) {
+  char name[STORE_NAME_MAX_LENGTH] = {0};
+  uint8_t record[STORE_RECORD_MAX_SIZE] = {0};
+
+  k_mutex_lock(&mutex_store, K_FOREVER);
+  for (size_t i = 0; STORE_MAX_KEYS > i; i++) {
+    const store_entry_t *const kEntry = &store_cache[i];
+    if ((kStoreStateClean != kEntry->state) &&
+        (kStoreStateDirty != kEntry->state)) {
+      continue;
+    }
+    snprintf(name, sizeof(name), STORE_SUBTREE "/%s", kEntry->key);
+    record[0] = kEntry->type;
+    memcpy(&record[1], kEntry->data, kEntry->size);
+    (void)cb(name, record, 1U + kEntry->size);
+  }
+  k_mutex_unlock(&mutex_store);
+  return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file store.h
+ * @brief User key/value store interface
+ * @details Provides a small write-back cached key/value store persisted under
+ * the openblink/user settings subtree
+ */
+#ifndef APP_STORE_H
+#define APP_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "../lib/fn.h"
+
+/**
+ * @brief Maximum number of keys held by the store
+ */
+#define STORE_MAX_KEYS 16U
+
+/**
+ * @brief Maximum length of a key in characters (excluding terminator)
+ */
+#define STORE_KEY_MAX_LENGTH 15U
+
+/**
+ * @brief Maximum size of a value in bytes
+ */
+#define STORE_VALUE_MAX_SIZE 32U
+
+/**
+ * @brief Delay from the first uncommitted change to the batched commit
+ */
+#define STORE_COMMIT_DELAY_MS (5U * 1000U)
+
+/**
+ * @typedef store_type_t
+ * @brief Enumeration of stored value types
+ * @details The numeric values are written to flash; append new types at the
+ * end
+ */
+typedef enum {
+  kStoreTypeInteger, /**< Signed integer (int32_t) */
+  kStoreTypeString,  /**< Byte string */
+  kStoreTypeNum,     /**< Number of types (not a type) */
+} store_type_t;
+
+/**
+ * @brief Initializes the store
+ *
+ * @details Registers the settings handler only; the persisted keys are
+ * loaded with the openblink subtree by config_init(), which runs after this
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t store_init(void);
+
+/**
+ * @brief Gets a value from the store
+ *
+ * @param kKey Key name
+ * @param type Type of the stored value
+ * @param buf Destination buffer
+ * @param kSize Size of the destination buffer
+ * @return ssize_t Size of the value in bytes, or negative if not found
+ */
+ssize_t store_get(const char *const kKey, store_type_t *const type,
+                  uint8_t *const buf, const size_t kSize);
+
+/**
+ * @brief Sets a value in the store and schedules a batched commit
+ *
+ * @param kKey Key name
+ * @param kType Type of the value
+ * @param kData Value data
+ * @param kSize Size of the value in bytes
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t store_set(const char *const kKey, const store_type_t kType,
+               const uint8_t *const kData, const size_t kSize);
+
+/**
+ * @brief Deletes a value from the store and schedules a batched commit
+ *
+ * @param kKey Key name
+ * @return fn_t kSuccess if deleted, kFailure if not found
+ */
+fn_t store_delete(const char *const kKey);
+
+/**
+ * @brief Writes all uncommitted changes to settings_storage now
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t store_flush(void);
+
+#endif  // APP_STORE_H
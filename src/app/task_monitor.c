@@ -0,0 +1,261 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file task_monitor.c
+ * @brief Implementation of the mruby/c task monitor
+ * @details The VM tick samples the state and program counter of each slot
+ * task. Run time is counted while the task is running and reset when it
+ * waits (sleep, suspend, end); a preempted task keeps its count. A task over
+ * its budget is terminated from the system work queue, and the VM thread
+ * starts it again the next time the scheduler is idle, since starting a task
+ * allocates from the VM heap.
+ */
+#include "task_monitor.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "../../mrubyc/src/mrubyc.h"
+#include "../drv/ble.h"
+#include "../lib/fn.h"
+
+LOG_MODULE_REGISTER(app_task_monitor, LOG_LEVEL_WRN);
+
+/**
+ * @typedef task_monitor_phase_t
+ * @brief Enumeration of recovery phases
+ */
+typedef enum {
+  kTaskMonitorPhaseRun,       /**< Running normally */
+  kTaskMonitorPhaseTerminate, /**< Termination requested by the tick */
+  kTaskMonitorPhaseRestart,   /**< Terminated, waiting to be started */
+} task_monitor_phase_t;
+
+/**
+ * @brief Monitor state of a slot task
+ */
+typedef struct {
+  mrbc_tcb *tcb;              /**< Task, NULL if not monitored */
+  const uint8_t *inst;        /**< Program counter at the last tick */
+  uint32_t budget_ms;         /**< Budget, 0 for no limit */
+  uint32_t burst_ms;          /**< Run time since the last wait */
+  uint32_t still_ms;          /**< Run time without instruction progress */
+  uint8_t restarts;           /**< Restarts by the monitor */
+  task_monitor_phase_t phase; /**< Recovery phase */
+} task_monitor_slot_t;
+
+/** @brief Slot task state */
+static task_monitor_slot_t slots[TASK_MONITOR_SLOTS];
+
+/** @brief Lock between the VM tick and the threads */
+static struct k_spinlock monitor_lock;
+
+/**
+ * @brief Work handler terminating the tasks over their budget
+ *
+ * @param work Pointer to the work item
+ */
+static void task_monitor_terminate(struct k_work *const work);
+K_WORK_DEFINE(work_task_monitor, task_monitor_terminate);
+
+/**
+ * @brief Starts the terminated tasks again
+ *
+ * @details Called from the idle hook of the VM thread when no task is ready
+ */
+void task_monitor_idle(void) {
+  char buf[48] = {0};
+  for (size_t i = 0; TASK_MONITOR_SLOTS > i; i++) {
+    task_monitor_slot_t *const slot = &slots[i];
+    mrbc_tcb *tcb = NULL;
+    const k_spinlock_key_t kKey = k_spin_lock(&monitor_lock);
+    if ((kTaskMonitorPhaseRestart == slot->phase) && (NULL != slot->tcb) &&
+        (TASKSTATE_DORMANT == slot->tcb->state)) {
+      slot->phase = kTaskMonitorPhaseRun;
+      tcb = slot->tcb;
+    }
+    k_spin_unlock(&monitor_lock, kKey);
+    if (NULL == tcb) {
+      continue;
+    }
+    if (TASK_MONITOR_RESTART_MAX <= slot->restarts) {
+      LOG_ERR("Slot%u left terminated", (unsigned int)(i + 1U));
+      continue;
+    }
+    slot->restarts++;
+    mrbc_start_task(tcb);
+    snprintf(buf, sizeof(buf), "Slot%u restarted (%u/%u)\n",
+             (unsigned int)(i + 1U), slot->restarts, TASK_MONITOR_RESTART_MAX);
+    ble_print(buf);
+  }
+}
+
+/**
+ * @brief Initializes the task monitor
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t task_monitor_init(void) {
+  task_monitor_clear();
+  return kSuccess;
+}
+
+/**
+ * @brief Starts monitoring the task of a slot
+ *
+ * @details The budget is reset to TASK_MONITOR_BUDGET_MS
+ *
+ * @param kIndex Slot index (0 for slot 1)
+ * @param tcb Task of the slot
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t task_monitor_watch(const uint8_t kIndex, mrbc_tcb *const tcb) {
+  if (TASK_MONITOR_SLOTS <= kIndex) {
+    return kFailure;
+  }
+  const k_spinlock_key_t kKey = k_spin_lock(&monitor_lock);
+  memset(&slots[kIndex], 0, sizeof(slots[kIndex]));
+  slots[kIndex].tcb = tcb;
+  slots[kIndex].budget_ms = TASK_MONITOR_BUDGET_MS;
+  k_spin_unlock(&monitor_lock, kKey);
+  return kSuccess;
+}
+
+/**
+ * @brief Stops monitoring all tasks
+ *
+ * @details Call from the VM thread after mrbc_run() returns
+ */
+void task_monitor_clear(void) {
+  struct k_work_sync sync;
+  const k_spinlock_key_t kKey = k_spin_lock(&monitor_lock);
+  memset(slots, 0, sizeof(slots));
+  k_spin_unlock(&monitor_lock, kKey);
+  // The tasks live in the VM heap
+  (void)k_work_cancel_sync(&work_task_monitor, &sync);
+}
+
+/**
+ * @brief Accounts one VM tick
+ *
+ * @details Called from the VM tick timer (interrupt context)
+ */
+void task_monitor_tick(void) {
+  bool terminate = false;
+  const k_spinlock_key_t kKey = k_spin_lock(&monitor_lock);
+  for (size_t i = 0; TASK_MONITOR_SLOTS > i; i++) {
+    task_monitor_slot_t *const slot = &slots[i];
+    if (NULL == slot->tcb) {
+      continue;
+    }
+    switch (slot->tcb->state) {
+      case TASKSTATE_RUNNING:
+        slot->burst_ms += MRBC_TICK_UNIT;
+        if (slot->inst == slot->tcb->vm.inst) {
+          slot->still_ms += MRBC_TICK_UNIT;
+        } else {
+          slot->inst = slot->tcb->vm.inst;
+          slot->still_ms = 0U;
+        }
+        break;
+      case TASKSTATE_READY:
+        break;  // Preempted, the burst goes on
+      default:
+        slot->burst_ms = 0U;
+        slot->still_ms = 0U;
+        break;
+    }
+    // A stall is left to task_monitor_check() and the watchdog
+    if ((kTaskMonitorPhaseRun == slot->phase) && (0U < slot->budget_ms) &&
+        (slot->budget_ms < slot->burst_ms)) {
+      slot->phase = kTaskMonitorPhaseTerminate;
+      terminate = true;
+    }
+  }
+  k_spin_unlock(&monitor_lock, kKey);
+  if (true == terminate) {
+    k_work_submit(&work_task_monitor);
+  }
+}
+
+/**
+ * @brief Work handler terminating the tasks over their budget
+ *
+ * @details mrbc_terminate_task() locks the scheduler, so it is not called
+ * from the tick
+ *
+ * @param work Pointer to the work item
+ */
+static void task_monitor_terminate(struct k_work *const work) {
+  for (size_t i = 0; TASK_MONITOR_SLOTS > i; i++) {
+    mrbc_tcb *tcb = NULL;
+    uint32_t burst_ms = 0U;
+    const k_spinlock_key_t kKey = k_spin_lock(&monitor_lock);
+    if (kTaskMonitorPhaseTerminate == slots[i].phase) {
+      slots[i].phase = kTaskMonitorPhaseRestart;
+      tcb = slots[i].tcb;
+      burst_ms = slots[i].burst_ms;
+    }
+    k_spin_unlock(&monitor_lock, kKey);
+    if (NULL != tcb) {
+      LOG_WRN("Slot%u ran %u ms without waiting, terminating",
+              (unsigned int)(i + 1U), burst_ms);
+      mrbc_terminate_task(tcb);
+    }
+  }
+}
+
+/**
+ * @brief Sets the run time budget of a task
+ *
+ * @details The current run time of the task starts from 0
+ *
+ * @param kTcb Task
+ * @param kBudgetMs Budget in milliseconds, 0 for no limit
+ * @return fn_t kSuccess if successful, kFailure if the task is not monitored
+ */
+fn_t task_monitor_set_budget(const mrbc_tcb *const kTcb,
+                             const uint32_t kBudgetMs) {
+  fn_t ret = kFailure;
+  const k_spinlock_key_t kKey = k_spin_lock(&monitor_lock);
+  for (size_t i = 0; TASK_MONITOR_SLOTS > i; i++) {
+    if ((NULL != kTcb) && (kTcb == slots[i].tcb)) {
+      slots[i].budget_ms = kBudgetMs;
+      slots[i].burst_ms = 0U;
+      ret = kSuccess;
+    }
+  }
+  k_spin_unlock(&monitor_lock, kKey);
+  return ret;
+}
+
+/**
+ * @brief Checks that no task is stalled
+ *
+ * @details Called from the watchdog thread; a stalled task cannot be
+ * terminated from the VM, so the watchdog is not fed
+ *
+ * @return fn_t kSuccess if no task is stalled, kFailure otherwise
+ */
+fn_t task_monitor_check(void) {
+  fn_t ret = kSuccess;
+  const k_spinlock_key_t kKey = k_spin_lock(&monitor_lock);
+  for (size_t i = 0; TASK_MONITOR_SLOTS > i; i++) {
+    if ((NULL != slots[i].tcb) &&
+        (TASK_MONITOR_STALL_MS <= slots[i].still_ms)) {
+      ret = kFailure;
+    }
+  }
+  k_spin_unlock(&monitor_lock, kKey);
+  if (kSuccess != ret) {
+    LOG_ERR("mruby/c task stalled");
+  }
+  return ret;
+}
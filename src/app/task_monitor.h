@@ -0,0 +1,101 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file task_monitor.h
+ * @brief mruby/c task monitor interface
+ * @details Accounts the time each slot task runs on the VM tick. A task that
+ * runs longer than its budget without sleeping is terminated and its slot is
+ * started again; a task whose program counter does not move at all is stuck
+ * in C code and is left to the hardware watchdog.
+ */
+#ifndef APP_TASK_MONITOR_H
+#define APP_TASK_MONITOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../../mrubyc/src/mrubyc.h"
+#include "../lib/fn.h"
+
+/**
+ * @brief Number of monitored slot tasks
+ */
+#define TASK_MONITOR_SLOTS 2U
+
+/**
+ * @brief Default run time budget between two waits in milliseconds
+ */
+#define TASK_MONITOR_BUDGET_MS 2000U
+
+/**
+ * @brief Run time without instruction progress treated as a stall
+ */
+#define TASK_MONITOR_STALL_MS 5000U
+
+/**
+ * @brief Restarts of a slot before it is left terminated
+ */
+#define TASK_MONITOR_RESTART_MAX 3U
+
+/**
+ * @brief Initializes the task monitor
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t task_monitor_init(void);
+
+/**
+ * @brief Starts monitoring the task of a slot
+ *
+ * @details The budget is reset to TASK_MONITOR_BUDGET_MS
+ *
+ * @param kIndex Slot index (0 for slot 1)
+ * @param tcb Task of the slot
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t task_monitor_watch(const uint8_t kIndex, mrbc_tcb *const tcb);
+
+/**
+ * @brief Stops monitoring all tasks
+ *
+ * @details Call from the VM thread after mrbc_run() returns
+ */
+void task_monitor_clear(void);
+
+/**
+ * @brief Accounts one VM tick
+ *
+ * @details Called from the VM tick timer (interrupt context)
+ */
+void task_monitor_tick(void);
+
+/**
+ * @brief Starts the terminated tasks again
+ *
+ * @details Called from the idle hook of the VM thread when no task is ready
+ */
+void task_monitor_idle(void);
+
+/**
+ * @brief Sets the run time budget of a task
+ *
+ * @param kTcb Task
+ * @param kBudgetMs Budget in milliseconds, 0 for no limit
+ * @return fn_t kSuccess if successful, kFailure if the task is not monitored
+ */
+fn_t task_monitor_set_budget(const mrbc_tcb *const kTcb,
+                             const uint32_t kBudgetMs);
+
+/**
+ * @brief Checks that no task is stalled
+ *
+ * @details Called from the watchdog thread; a stalled task cannot be
+ * terminated from the VM, so the watchdog is not fed
+ *
+ * @return fn_t kSuccess if no task is stalled, kFailure otherwise
+ */
+fn_t task_monitor_check(void);
+
+#endif  // APP_TASK_MONITOR_H
@@ -17,8 +17,8 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 
-#include "../api/blink.h"
 #include "../lib/fn.h"
+#include "task_monitor.h"
 
 LOG_MODULE_REGISTER(app_watchdog, LOG_LEVEL_WRN);
 
@@ -101,9 +101,8 @@ static void watchdog_thread_main(void *, void *, void *) {
   while (1) {
     fn_t tmp_state = kSuccess;
 
-    // mruby/c
-    tmp_state =
-        (kSuccess != api_blink_normality_check()) ? kFailure : tmp_state;
+    // mruby/c (tasks over budget are restarted by the task monitor)
+    tmp_state = (kSuccess != task_monitor_check()) ? kFailure : tmp_state;
 
     // Thread heartbeat check
     for (size_t i = 0; kAppWatchDogThreadNum > i; i++) {
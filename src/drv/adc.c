@@ -5,14 +5,25 @@
 /**
  * @file adc.c
  * @brief Implementation of ADC driver
- * @details Implements functions for ADC initialization and reading
+ * @details Implements functions for ADC initialization and reading. Besides
+ * on-demand scans, the driver can run a background acquisition in which the
+ * SAADC is re-triggered every interval by the ADC driver and each scan is
+ * pushed from the completion callback into per-channel single-producer /
+ * single-consumer rings plus min/max/mean windows. On-demand scans, reads
+ * of the latest scan and starting or stopping the acquisition are serialized
+ * by a mutex, since the VM thread and the poller both use them.
  */
 #include "adc.h"
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include <zephyr/drivers/adc.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
 
 #include "../lib/fn.h"
 
@@ -24,55 +35,237 @@ LOG_MODULE_REGISTER(drv_adc, LOG_LEVEL_DBG);
 static const struct adc_dt_spec adc_channels[] = {
     DT_FOREACH_PROP_ELEM(DT_PATH(zephyr_user), io_channels, DT_SPEC_AND_COMMA)};
 
-static uint16_t buf[ARRAY_SIZE(adc_channels)];
-static struct adc_sequence sequence[ARRAY_SIZE(adc_channels)];
+BUILD_ASSERT(IS_POWER_OF_TWO(DRV_ADC_RING_SIZE),
+             "DRV_ADC_RING_SIZE must be a power of two");
+
+/** @brief Number of ADC channels */
+#define DRV_ADC_CHANNEL_NUM ARRAY_SIZE(adc_channels)
+
+/** @brief Scan results, one per channel in ascending channel_id order */
+static int16_t buf[DRV_ADC_CHANNEL_NUM];
+
+/** @brief Position of each channel's result in buf */
+static uint8_t buf_slot[DRV_ADC_CHANNEL_NUM];
+
+/** @brief Single scan sequence covering all channels */
+static struct adc_sequence sequence;
+
+/** @brief Lock serializing scans, reads of buf and acquisition control */
+static K_MUTEX_DEFINE(mutex_adc);
+
+/** @brief Lock between the acquisition callback and readers of buf */
+static struct k_spinlock buf_lock;
+
+/**
+ * @brief Millivolt scale of a channel: mV = (value * mv) >> shift
+ */
+typedef struct {
+  int32_t mv;    /**< Full-scale millivolts (reference / gain * divider) */
+  uint8_t shift; /**< Resolution in bits (minus sign bit if differential) */
+} adc_scale_t;
+
+/** @brief Cached millivolt scales */
+static adc_scale_t scale[DRV_ADC_CHANNEL_NUM];
+
+/**
+ * @brief Per-channel sample ring (single producer: ADC callback, single
+ * consumer: caller of drv_adc_read_block)
+ */
+typedef struct {
+  int16_t data[DRV_ADC_RING_SIZE]; /**< Raw samples */
+  atomic_t head;                   /**< Samples written (producer) */
+  atomic_t tail;                   /**< Samples read (consumer) */
+} adc_ring_t;
+
+/**
+ * @brief Window accumulator of raw samples
+ */
+typedef struct {
+  int32_t min;    /**< Minimum raw sample */
+  int32_t max;    /**< Maximum raw sample */
+  int32_t sum;    /**< Sum of raw samples */
+  uint32_t count; /**< Number of samples */
+} adc_window_acc_t;
+
+/** @brief Scan buffer of the background acquisition */
+static int16_t stream_buf[DRV_ADC_CHANNEL_NUM];
+
+/** @brief Background acquisition sequence */
+static struct adc_sequence stream_sequence;
+
+/** @brief Background acquisition options (interval and callback) */
+static struct adc_sequence_options stream_options;
+
+/** @brief Signal raised when the background acquisition has stopped */
+static struct k_poll_signal stream_signal =
+    K_POLL_SIGNAL_INITIALIZER(stream_signal);
+
+/** @brief true while the background acquisition runs */
+static atomic_t stream_running = ATOMIC_INIT(0);
+
+/** @brief Stop request checked by the ADC callback */
+static atomic_t stream_stop = ATOMIC_INIT(0);
+
+/** @brief Sample rings */
+static adc_ring_t stream_ring[DRV_ADC_CHANNEL_NUM];
+
+/** @brief Window being accumulated (ADC callback only) */
+static adc_window_acc_t stream_acc[DRV_ADC_CHANNEL_NUM];
+
+/** @brief Last completed window */
+static adc_window_acc_t stream_window[DRV_ADC_CHANNEL_NUM];
+
+/** @brief Lock protecting stream_window */
+static struct k_spinlock stream_window_lock;
+
+/**
+ * @brief Converts a raw sample of a channel to its signed value
+ *
+ * @param kIdx Index of the ADC channel
+ * @param kRaw Raw sample from the SAADC buffer
+ * @return int32_t Sample value
+ */
+static int32_t adc_raw_value(const uint8_t kIdx, const int16_t kRaw) {
+  /*
+   * If using differential mode, the 16 bit value
+   * in the ADC sample buffer should be a signed 2's
+   * complement value.
+   */
+  if (adc_channels[kIdx].channel_cfg.differential) {
+    return (int32_t)kRaw;
+  }
+  return (int32_t)(uint16_t)kRaw;
+}
+
+/**
+ * @brief Converts a raw sample value of a channel to millivolts
+ *
+ * @details Uses the scale cached by adc_scale_init(), which is equivalent to
+ * adc_raw_to_millivolts_dt() including the input divider
+ *
+ * @param kIdx Index of the ADC channel
+ * @param kValue Sample value from adc_raw_value()
+ * @return int32_t Value in millivolts, or negative on error
+ */
+static int32_t adc_value_to_mv(const uint8_t kIdx, const int32_t kValue) {
+  const adc_scale_t *const kScale = &scale[kIdx];
+  if (0 == kScale->mv) {
+    return -1;
+  }
+  return (int32_t)(((int64_t)kValue * kScale->mv) >> kScale->shift);
+}
+
+/**
+ * @brief Caches the millivolt scale of every channel
+ *
+ * @return fn_t kSuccess if successful, kFailure if a channel cannot be
+ * converted to millivolts
+ */
+static fn_t adc_scale_init(void) {
+  for (size_t i = 0U; i < DRV_ADC_CHANNEL_NUM; i++) {
+    const struct adc_dt_spec *const kSpec = &adc_channels[i];
+    int32_t ref_mv = (ADC_REF_INTERNAL == kSpec->channel_cfg.reference)
+                         ? (int32_t)adc_ref_internal(kSpec->dev)
+                         : (int32_t)kSpec->vref_mv;
+    if ((0 >= ref_mv) || (0 != adc_gain_invert(kSpec->channel_cfg.gain,
+                                               &ref_mv))) {
+      LOG_ERR("Channel #%d: value in mV not available\n", i);
+      scale[i].mv = 0;
+      return kFailure;
+    }
+    scale[i].mv = ref_mv * ((0U == i) ? 5 : 1);  // VDDH DIV 5
+    scale[i].shift = kSpec->resolution -
+                     (kSpec->channel_cfg.differential ? 1U : 0U);
+  }
+  return kSuccess;
+}
 
 /**
  * @brief Initializes the ADC subsystem
  *
+ * @details Sets up every channel and builds one sequence that converts all
+ * of them in a single scan
+ *
  * @return fn_t kSuccess if successful, kFailure otherwise
  */
 fn_t drv_adc_init(void) {
   int err;
+  uint32_t channels = 0U;
   /* Configure channels individually prior to sampling. */
-  for (size_t i = 0U; i < ARRAY_SIZE(adc_channels); i++) {
+  for (size_t i = 0U; i < DRV_ADC_CHANNEL_NUM; i++) {
     if (!adc_is_ready_dt(&adc_channels[i])) {
       LOG_ERR("ADC controller device %s not ready\n",
               adc_channels[i].dev->name);
       return kFailure;
     }
+    if ((adc_channels[0].dev != adc_channels[i].dev) ||
+        (adc_channels[0].resolution != adc_channels[i].resolution)) {
+      LOG_ERR("Channel #%d cannot share the scan sequence\n", i);
+      return kFailure;
+    }
 
     err = adc_channel_setup_dt(&adc_channels[i]);
     if (err < 0) {
       LOG_ERR("Could not setup channel #%d (%d)\n", i, err);
       return kFailure;
     }
+    channels |= BIT(adc_channels[i].channel_id);
+  }
+
+  // The SAADC stores scan results in ascending channel_id order
+  for (size_t i = 0U; i < DRV_ADC_CHANNEL_NUM; i++) {
+    buf_slot[i] = (uint8_t)popcount(channels &
+                                    (BIT(adc_channels[i].channel_id) - 1U));
+  }
 
-    sequence[i].buffer = &buf[i];
-    sequence[i].buffer_size = sizeof(buf[i]);
+  if (kSuccess != adc_scale_init()) {
+    return kFailure;
   }
+
+  sequence.channels = channels;
+  sequence.buffer = buf;
+  sequence.buffer_size = sizeof(buf);
+  sequence.resolution = adc_channels[0].resolution;
+  // No oversampling: the nRF SAADC supports it for a single channel only
+  sequence.oversampling = 0U;
+  sequence.calibrate = true;  // first conversion only
   return kSuccess;
 }
 
 /**
  * @brief Updates all ADC channel readings
  *
+ * @details Converts every channel in one scan into buf. While the background
+ * acquisition runs, buf already holds the latest scan and no conversion is
+ * started.
+ *
  * @return fn_t kSuccess if successful, kFailure otherwise
  */
 fn_t drv_adc_update(void) {
   fn_t ret = kSuccess;
-  int err;
-  for (size_t i = 0U; i < ARRAY_SIZE(adc_channels); i++) {
-    (void)adc_sequence_init_dt(&adc_channels[i], &sequence[i]);
-    err = adc_read_dt(&adc_channels[i], &sequence[i]);
-    if (err < 0) {
-      LOG_ERR("Could not read channel %d: (%d)\n", i, err);
+  k_mutex_lock(&mutex_adc, K_FOREVER);
+  // While acquiring, buf is refreshed by the acquisition callback
+  if (false == drv_adc_is_running()) {
+    const int kErr = adc_read(adc_channels[0].dev, &sequence);
+    if (kErr < 0) {
+      LOG_ERR("Could not read channels 0x%02X: (%d)\n", sequence.channels,
+              kErr);
       ret = kFailure;
+    } else {
+      sequence.calibrate = false;
     }
   }
+  k_mutex_unlock(&mutex_adc);
   return ret;
 }
 
+/**
+ * @brief Gets the number of ADC channels
+ *
+ * @return size_t Number of channels
+ */
+size_t drv_adc_channel_count(void) { return DRV_ADC_CHANNEL_NUM; }
+
 /**
  * @brief Gets the value of an ADC channel
  *
@@ -80,34 +273,265 @@ fn_t drv_adc_update(void) {
  * @return int32_t ADC reading in millivolts, or negative on error
  */
 int32_t drv_adc_get(const uint8_t kIdx) {
-  int err;
-  int32_t val_mv;
-  if (ARRAY_SIZE(adc_channels) <= kIdx) {
+  if (DRV_ADC_CHANNEL_NUM <= kIdx) {
     LOG_ERR("Invalid channel index: %d\n", kIdx);
     return -1;
   }
+  int16_t raw = 0;
+  k_mutex_lock(&mutex_adc, K_FOREVER);
+  K_SPINLOCK(&buf_lock) { raw = buf[buf_slot[kIdx]]; }
+  k_mutex_unlock(&mutex_adc);
+  return adc_value_to_mv(kIdx, adc_raw_value(kIdx, raw));
+}
 
-  /*
-   * If using differential mode, the 16 bit value
-   * in the ADC sample buffer should be a signed 2's
-   * complement value.
-   */
-  if (adc_channels[kIdx].channel_cfg.differential) {
-    val_mv = (int32_t)((int16_t)buf[kIdx]);
-  } else {
-    val_mv = (int32_t)buf[kIdx];
+/**
+ * @brief ADC callback of the background acquisition
+ *
+ * @details Runs in the ADC driver context after every scan. Pushes each
+ * channel into its ring (dropping the sample when the ring is full) and
+ * updates the window accumulators.
+ *
+ * @param dev ADC device
+ * @param seq Sequence that completed a sampling
+ * @param sampling_index Index of the sampling
+ * @return enum adc_action ADC_ACTION_REPEAT to keep sampling into the same
+ * buffer, ADC_ACTION_FINISH when a stop was requested
+ */
+static enum adc_action adc_stream_callback(const struct device *dev,
+                                           const struct adc_sequence *seq,
+                                           uint16_t sampling_index) {
+  if (atomic_get(&stream_stop)) {
+    return ADC_ACTION_FINISH;
+  }
+
+  for (uint8_t i = 0U; i < DRV_ADC_CHANNEL_NUM; i++) {
+    const int16_t kRaw = stream_buf[buf_slot[i]];
+    adc_ring_t *const ring = &stream_ring[i];
+    const atomic_val_t kHead = atomic_get(&ring->head);
+    if (DRV_ADC_RING_SIZE > (uint32_t)(kHead - atomic_get(&ring->tail))) {
+      ring->data[(uint32_t)kHead % DRV_ADC_RING_SIZE] = kRaw;
+      atomic_set(&ring->head, kHead + 1);
+    }
+
+    const int32_t kValue = adc_raw_value(i, kRaw);
+    adc_window_acc_t *const acc = &stream_acc[i];
+    if (0U == acc->count) {
+      acc->min = kValue;
+      acc->max = kValue;
+      acc->sum = 0;
+    }
+    acc->min = MIN(acc->min, kValue);
+    acc->max = MAX(acc->max, kValue);
+    acc->sum += kValue;
+    acc->count++;
+    if (DRV_ADC_WINDOW_SIZE <= acc->count) {
+      K_SPINLOCK(&stream_window_lock) { stream_window[i] = *acc; }
+      acc->count = 0U;
+    }
+  }
+  // Keep the latest scan visible to drv_adc_get(), as a whole
+  K_SPINLOCK(&buf_lock) { memcpy(buf, stream_buf, sizeof(buf)); }
+  return ADC_ACTION_REPEAT;
+}
+
+/**
+ * @brief Starts the background acquisition of all channels
+ *
+ * @details Called with mutex_adc held
+ *
+ * @param kIntervalUs Scan interval in microseconds
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+static fn_t adc_stream_start(const uint32_t kIntervalUs) {
+  if ((DRV_ADC_STREAM_MIN_INTERVAL_US > kIntervalUs) ||
+      (DRV_ADC_STREAM_MAX_INTERVAL_US < kIntervalUs)) {
+    LOG_ERR("Interval out of range: %u us\n", kIntervalUs);
+    return kFailure;
+  }
+  if (true == drv_adc_is_running()) {
+    return kFailure;
+  }
+  // Calibrate with a blocking scan first; repeated samplings must not
+  // recalibrate
+  if ((true == sequence.calibrate) && (kSuccess != drv_adc_update())) {
+    return kFailure;
+  }
+
+  for (size_t i = 0U; i < DRV_ADC_CHANNEL_NUM; i++) {
+    atomic_set(&stream_ring[i].head, 0);
+    atomic_set(&stream_ring[i].tail, 0);
+    stream_acc[i].count = 0U;
+    K_SPINLOCK(&stream_window_lock) { stream_window[i].count = 0U; }
+  }
+
+  stream_options.interval_us = kIntervalUs;
+  stream_options.callback = adc_stream_callback;
+  stream_options.user_data = NULL;
+  stream_options.extra_samplings = 0U;
+
+  stream_sequence = sequence;
+  stream_sequence.options = &stream_options;
+  stream_sequence.buffer = stream_buf;
+  stream_sequence.buffer_size = sizeof(stream_buf);
+  stream_sequence.calibrate = false;
+
+  atomic_set(&stream_stop, 0);
+  k_poll_signal_reset(&stream_signal);
+  atomic_set(&stream_running, 1);
+  const int kErr =
+      adc_read_async(adc_channels[0].dev, &stream_sequence, &stream_signal);
+  if (kErr < 0) {
+    LOG_ERR("Could not start acquisition: (%d)\n", kErr);
+    atomic_set(&stream_running, 0);
+    return kFailure;
+  }
+  LOG_DBG("Acquisition started: %u us\n", kIntervalUs);
+  return kSuccess;
+}
+
+/**
+ * @brief Starts the background acquisition of all channels
+ *
+ * @param kIntervalUs Scan interval in microseconds
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_adc_start(const uint32_t kIntervalUs) {
+  k_mutex_lock(&mutex_adc, K_FOREVER);
+  const fn_t kRet = adc_stream_start(kIntervalUs);
+  k_mutex_unlock(&mutex_adc);
+  return kRet;
+}
+
+/**
+ * @brief Stops the background acquisition
+ *
+ * @details Called with mutex_adc held. Waits until the ADC driver has
+ * finished the running sequence. The
+ * callback sees the stop request only at the next scan, so the wait covers
+ * one interval plus a margin.
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+static fn_t adc_stream_stop(void) {
+  if (false == drv_adc_is_running()) {
+    return kSuccess;
+  }
+  atomic_set(&stream_stop, 1);
+
+  struct k_poll_event event = K_POLL_EVENT_INITIALIZER(
+      K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &stream_signal);
+  const int kErr =
+      k_poll(&event, 1,
+             K_MSEC(DIV_ROUND_UP(stream_options.interval_us, USEC_PER_MSEC) +
+                    DRV_ADC_STREAM_STOP_MARGIN_MS));
+  if (0 != kErr) {
+    LOG_ERR("Acquisition did not stop: (%d)\n", kErr);
+    return kFailure;
+  }
+  atomic_set(&stream_running, 0);
+  return kSuccess;
+}
+
+/**
+ * @brief Stops the background acquisition
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_adc_stop(void) {
+  k_mutex_lock(&mutex_adc, K_FOREVER);
+  const fn_t kRet = adc_stream_stop();
+  k_mutex_unlock(&mutex_adc);
+  return kRet;
+}
+
+/**
+ * @brief Checks whether the background acquisition is running
+ *
+ * @return true if running
+ * @return false otherwise
+ */
+bool drv_adc_is_running(void) {
+  unsigned int signaled = 0U;
+  int result = 0;
+
+  if (!atomic_get(&stream_running)) {
+    return false;
   }
+  // The driver raises the signal when the sequence ends (stop or error)
+  k_poll_signal_check(&stream_signal, &signaled, &result);
+  if (0U != signaled) {
+    atomic_set(&stream_running, 0);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Drains samples of a channel from the acquisition ring
+ *
+ * @param kIdx Index of the ADC channel
+ * @param mv Destination of the samples in millivolts (oldest first)
+ * @param kCount Maximum number of samples
+ * @return size_t Number of samples written
+ */
+size_t drv_adc_read_block(const uint8_t kIdx, int32_t *const mv,
+                          const size_t kCount) {
+  if (DRV_ADC_CHANNEL_NUM <= kIdx) {
+    return 0U;
+  }
+  adc_ring_t *const ring = &stream_ring[kIdx];
+  const atomic_val_t kTail = atomic_get(&ring->tail);
+  const size_t kAvailable = (size_t)(atomic_get(&ring->head) - kTail);
+  const size_t kNum = MIN(kAvailable, kCount);
 
-  if (0 == kIdx) {
-    val_mv *= 5;  // VDDH DIV 5
+  for (size_t i = 0U; i < kNum; i++) {
+    const int16_t kRaw = ring->data[((uint32_t)kTail + i) % DRV_ADC_RING_SIZE];
+    mv[i] = adc_value_to_mv(kIdx, adc_raw_value(kIdx, kRaw));
   }
+  atomic_set(&ring->tail, kTail + (atomic_val_t)kNum);
+  return kNum;
+}
 
-  err = adc_raw_to_millivolts_dt(&adc_channels[kIdx], &val_mv);
-  /* conversion to mV may not be supported, skip if not */
-  if (err < 0) {
-    LOG_ERR(" (value in mV not available)\n");
-  } else {
-    return val_mv;
+/**
+ * @brief Gets the last completed min/max/mean window of a channel
+ *
+ * @param kIdx Index of the ADC channel
+ * @param window Destination of the window in millivolts
+ * @return fn_t kSuccess if a window is available, kFailure otherwise
+ */
+fn_t drv_adc_get_window(const uint8_t kIdx, drv_adc_window_t *const window) {
+  adc_window_acc_t acc = {0};
+  if (DRV_ADC_CHANNEL_NUM <= kIdx) {
+    return kFailure;
+  }
+  K_SPINLOCK(&stream_window_lock) { acc = stream_window[kIdx]; }
+  if (0U == acc.count) {
+    return kFailure;
+  }
+  window->min = adc_value_to_mv(kIdx, acc.min);
+  window->max = adc_value_to_mv(kIdx, acc.max);
+  window->mean = adc_value_to_mv(kIdx, acc.sum / (int32_t)acc.count);
+  window->count = acc.count;
+  return kSuccess;
+}
+
+/**
+ * @brief Gets the values of all ADC channels
+ *
+ * @param mv Destination in millivolts (negative on error), indexed by channel
+ * @param kCount Number of entries in mv
+ * @return size_t Number of channels written
+ */
+size_t drv_adc_get_all(int32_t *const mv, const size_t kCount) {
+  const size_t kNum = MIN(kCount, DRV_ADC_CHANNEL_NUM);
+  int16_t raw[DRV_ADC_CHANNEL_NUM];
+  // One copy, so that all channels come from the same scan
+  k_mutex_lock(&mutex_adc, K_FOREVER);
+  K_SPINLOCK(&buf_lock) { memcpy(raw, buf, sizeof(raw)); }
+  k_mutex_unlock(&mutex_adc);
+  for (size_t i = 0U; i < kNum; i++) {
+    mv[i] = adc_value_to_mv((uint8_t)i,
+                            adc_raw_value((uint8_t)i, raw[buf_slot[i]]));
   }
-  return -1;
+  return kNum;
 }
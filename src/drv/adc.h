@@ -10,10 +10,50 @@
 #ifndef DRV_ADC_H
 #define DRV_ADC_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "../lib/fn.h"
 
+/**
+ * @brief Samples kept per channel by the background acquisition (power of
+ * two)
+ */
+#define DRV_ADC_RING_SIZE 256U
+
+/**
+ * @brief Samples per min/max/mean window of the background acquisition
+ */
+#define DRV_ADC_WINDOW_SIZE 64U
+
+/**
+ * @brief Shortest scan interval of the background acquisition
+ */
+#define DRV_ADC_STREAM_MIN_INTERVAL_US 100U
+
+/**
+ * @brief Longest scan interval of the background acquisition
+ * @details Bounds the time a stop waits for the next scan, so a reload is not
+ * held up
+ */
+#define DRV_ADC_STREAM_MAX_INTERVAL_US 1000000U
+
+/**
+ * @brief Time to wait beyond one scan interval when stopping the acquisition
+ */
+#define DRV_ADC_STREAM_STOP_MARGIN_MS 100U
+
+/**
+ * @brief Min/max/mean window of a channel
+ */
+typedef struct {
+  int32_t min;    /**< Minimum in millivolts */
+  int32_t max;    /**< Maximum in millivolts */
+  int32_t mean;   /**< Mean in millivolts */
+  uint32_t count; /**< Number of samples in the window */
+} drv_adc_window_t;
+
 /**
  * @brief Initializes the ADC subsystem
  *
@@ -28,6 +68,13 @@ fn_t drv_adc_init(void);
  */
 fn_t drv_adc_update(void);
 
+/**
+ * @brief Gets the number of ADC channels
+ *
+ * @return size_t Number of channels
+ */
+size_t drv_adc_channel_count(void);
+
 /**
  * @brief Gets the value of an ADC channel
  *
@@ -36,4 +83,56 @@ fn_t drv_adc_update(void);
  */
 int32_t drv_adc_get(const uint8_t kIdx);
 
+/**
+ * @brief Gets the values of all ADC channels
+ *
+ * @param mv Destination in millivolts (negative on error), indexed by channel
+ * @param kCount Number of entries in mv
+ * @return size_t Number of channels written
+ */
+size_t drv_adc_get_all(int32_t *const mv, const size_t kCount);
+
+/**
+ * @brief Starts the background acquisition of all channels
+ *
+ * @param kIntervalUs Scan interval in microseconds
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_adc_start(const uint32_t kIntervalUs);
+
+/**
+ * @brief Stops the background acquisition
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_adc_stop(void);
+
+/**
+ * @brief Checks whether the background acquisition is running
+ *
+ * @return true if running
+ * @return false otherwise
+ */
+bool drv_adc_is_running(void);
+
+/**
+ * @brief Drains samples of a channel from the acquisition ring
+ *
+ * @param kIdx Index of the ADC channel
+ * @param mv Destination of the samples in millivolts (oldest first)
+ * @param kCount Maximum number of samples
+ * @return size_t Number of samples written
+ */
+size_t drv_adc_read_block(const uint8_t kIdx, int32_t *const mv,
+                          const size_t kCount);
+
+/**
+ * @brief Gets the last completed min/max/mean window of a channel
+ *
+ * @param kIdx Index of the ADC channel
+ * @param window Destination of the window in millivolts
+ * @return fn_t kSuccess if a window is available, kFailure otherwise
+ */
+fn_t drv_adc_get_window(const uint8_t kIdx, drv_adc_window_t *const window);
+
 #endif
@@ -27,6 +27,7 @@
 #include <zephyr/settings/settings.h>
 #include <zephyr/sys/util.h>
 
+#include "../app/boot_trace.h"
 #include "../app/comm.h"
 #include "ble_blink.h"
 
@@ -243,6 +244,7 @@ static void bt_ready(int err) {
   };
 
   // Complete the initialization
+  boot_trace_mark(kBootTraceBtReady);
   k_sem_give(&ble_init_ok);
 }
 
@@ -273,9 +275,13 @@ int ble_init(BLE_CALLBACK cb) {
     LOG_ERR("BLE: initialization failed");
     return err;
   }
+  boot_trace_mark(kBootTraceBtEnable);
 
-  LOG_DBG("settings_load()");
-  settings_load();
+  // Only the Bluetooth subtree is needed before advertising; the other
+  // subtrees are loaded by their owners during boot
+  LOG_DBG("settings_load_subtree(bt)");
+  settings_load_subtree("bt");
+  boot_trace_mark(kBootTraceSettingsLoad);
 
   // Wait for initialization to complete
   err = k_sem_take(&ble_init_ok, K_MSEC(100));
@@ -60,7 +60,9 @@ typedef struct {
       size_t length;           /**< Length of bytecode */
     } blink;
     struct {
-      uint16_t mtu; /**< Maximum Transmission Unit */
+      uint16_t mtu;  /**< Maximum Transmission Unit */
+      uint8_t *data; /**< Buffer for extended status records */
+      size_t size;   /**< In: capacity of data, Out: bytes written */
     } status;
     struct {
     } reboot; /**< Reboot event data (empty) */
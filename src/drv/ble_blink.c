@@ -23,6 +23,7 @@
 #include <zephyr/device.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
 #include <zephyr/sys/crc.h>
 #include <zephyr/sys/util.h>
 #include <zephyr/types.h>
@@ -59,6 +60,9 @@ LOG_MODULE_REGISTER(ble_blink, LOG_LEVEL_DBG);
 /** @brief Blink protocol version */
 #define BLINK_VERSION 0x01
 
+/** @brief Maximum size of the Status characteristic value in bytes */
+#define BLINK_STATUS_MAX_SIZE 256U
+
 /** @brief Command code for data chunk transfer */
 #define BLINK_CMD_DATA 'D'  // Data
 /** @brief Command code for program execution */
@@ -111,6 +115,9 @@ extern BLE_CONTEXT ble_context;
 /** @brief Buffer for storing received bytecode */
 static uint8_t blink_bytecode[BLINK_MAX_BYTECODE_SIZE] = {0};
 
+/** @brief Buffer for the Status characteristic value */
+static uint8_t blink_status[BLINK_STATUS_MAX_SIZE] = {0};
+
 /**
  * @brief Sends a notification through the program characteristic
  *
@@ -271,6 +278,9 @@ static ssize_t blink_write_program(struct bt_conn *conn,
 /**
  * @brief Callback for status characteristic read operations
  *
+ * @details The value starts with the MTU (uint16_t, little endian) and is
+ * followed by extended status records filled in by the event callback
+ *
  * @param conn Bluetooth connection handle
  * @param attr GATT attribute being read from
  * @param buf Buffer to store the read data
@@ -284,11 +294,18 @@ static ssize_t blink_read_mtu(struct bt_conn *conn,
   BLE_PARAM param = {
       .event = BLE_EVENT_STATUS,
       .status.mtu = bt_gatt_get_mtu(conn),
+      .status.data = &blink_status[sizeof(uint16_t)],
+      .status.size = sizeof(blink_status) - sizeof(uint16_t),
   };
   ble_context.event_cb(&param);
 
-  return bt_gatt_attr_read(conn, attr, buf, len, offset, &param.status.mtu,
-                           sizeof(param.status.mtu));
+  sys_put_le16(param.status.mtu, &blink_status[0]);
+  const size_t kLength =
+      sizeof(uint16_t) + MIN(param.status.size,
+                             sizeof(blink_status) - sizeof(uint16_t));
+
+  return bt_gatt_attr_read(conn, attr, buf, len, offset, blink_status,
+                           kLength);
 }
 
 /**
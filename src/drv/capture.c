@@ -0,0 +1,266 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file capture.c
+ * @brief Implementation of input capture driver
+ * @details TIMER3 runs freely at 1 MHz. For each channel, a GPIOTE IN event
+ * triggers a TIMER3 CAPTURE task over PPI, so the timestamp is taken by
+ * hardware at the edge. The GPIOTE interrupt only moves the captured value
+ * into the ring; no thread or VM task runs per edge.
+ */
+#include "capture.h"
+
+#include <hal/nrf_gpio.h>
+#include <helpers/nrfx_gppi.h>
+#include <nrfx_gpiote.h>
+#include <nrfx_timer.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+#include "../lib/fn.h"
+#include "gpio.h"
+
+LOG_MODULE_REGISTER(drv_capture, LOG_LEVEL_DBG);
+
+BUILD_ASSERT(IS_POWER_OF_TWO(DRV_CAPTURE_RING_SIZE),
+             "DRV_CAPTURE_RING_SIZE must be a power of 2");
+
+/**
+ * @brief Capture channel state
+ */
+typedef struct {
+  uint32_t timestamps[DRV_CAPTURE_RING_SIZE]; /**< Ring of edge times */
+  uint8_t levels[DRV_CAPTURE_RING_SIZE];      /**< Ring of levels */
+  uint32_t count;                             /**< Edges since start */
+  uint8_t pin;                                /**< Pin number */
+  uint8_t gpiote_channel;                     /**< GPIOTE channel */
+  uint8_t ppi_channel;                        /**< PPI channel */
+  bool active;                                /**< Channel is running */
+} capture_t;
+
+/** @brief Free running timestamp timer */
+static const nrfx_timer_t capture_timer = NRFX_TIMER_INSTANCE(3);
+
+/** @brief GPIOTE instance shared with the Zephyr GPIO driver */
+static const nrfx_gpiote_t capture_gpiote = NRFX_GPIOTE_INSTANCE(0);
+
+/** @brief true once capture_timer runs */
+static bool timer_running = false;
+
+/** @brief Channel state */
+static capture_t captures[DRV_CAPTURE_CHANNELS];
+
+/** @brief Lock between the GPIOTE interrupt and readers */
+static struct k_spinlock capture_lock;
+
+/**
+ * @brief Timer event handler (no timer interrupts are enabled)
+ *
+ * @param event_type Timer event
+ * @param p_context Unused
+ */
+static void capture_timer_handler(nrf_timer_event_t event_type,
+                                  void *p_context) {}
+
+/**
+ * @brief Starts the timestamp timer on first use
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+static fn_t capture_timer_start(void) {
+  if (true == timer_running) {
+    return kSuccess;
+  }
+  nrfx_timer_config_t config = NRFX_TIMER_DEFAULT_CONFIG(DRV_CAPTURE_TIMER_HZ);
+  config.bit_width = NRF_TIMER_BIT_WIDTH_32;
+  if (NRFX_SUCCESS !=
+      nrfx_timer_init(&capture_timer, &config, capture_timer_handler)) {
+    LOG_ERR("nrfx_timer_init() failed");
+    return kFailure;
+  }
+  nrfx_timer_enable(&capture_timer);
+  timer_running = true;
+  return kSuccess;
+}
+
+/**
+ * @brief GPIOTE handler storing the timestamp captured by hardware
+ *
+ * @details Runs in interrupt context. An edge that arrives before this runs
+ * overwrites the captured value, which bounds the measurable rate.
+ *
+ * @param pin Pin that triggered
+ * @param trigger Trigger type
+ * @param p_context Channel state
+ */
+static void capture_gpiote_handler(nrfx_gpiote_pin_t pin,
+                                   nrfx_gpiote_trigger_t trigger,
+                                   void *p_context) {
+  capture_t *const capture = (capture_t *)p_context;
+  const size_t kChannel = (size_t)(capture - captures);
+  const k_spinlock_key_t kKey = k_spin_lock(&capture_lock);
+  const size_t kIndex = capture->count & (DRV_CAPTURE_RING_SIZE - 1U);
+  capture->timestamps[kIndex] = nrfx_timer_capture_get(
+      &capture_timer, (nrf_timer_cc_channel_t)kChannel);
+  capture->levels[kIndex] = (uint8_t)nrf_gpio_pin_read(pin);
+  capture->count++;
+  k_spin_unlock(&capture_lock, kKey);
+}
+
+/**
+ * @brief Starts capturing the edges of a pin
+ *
+ * @details A running capture on the channel is stopped first. The pin is
+ * claimed from the GPIO driver, so pins owned there or by other channels
+ * are refused.
+ *
+ * @param kChannel Channel index
+ * @param kPin Pin number (port * 32 + pin)
+ * @param kEdge Edges to capture
+ * @param kPullUp true to enable the pull-up
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_capture_start(const uint8_t kChannel, const uint8_t kPin,
+                       const drv_capture_edge_t kEdge, const bool kPullUp) {
+  static const nrfx_gpiote_trigger_t kTriggers[] = {
+      [kDrvCaptureEdgeRising] = NRFX_GPIOTE_TRIGGER_LOTOHI,
+      [kDrvCaptureEdgeFalling] = NRFX_GPIOTE_TRIGGER_HITOLO,
+      [kDrvCaptureEdgeBoth] = NRFX_GPIOTE_TRIGGER_TOGGLE,
+  };
+  if ((DRV_CAPTURE_CHANNELS <= kChannel) || (ARRAY_SIZE(kTriggers) <= kEdge) ||
+      (false == nrf_gpio_pin_present_check(kPin))) {
+    return kFailure;
+  }
+  // The pin of this channel is given back by the stop below
+  if ((false == drv_gpio_pin_available(kPin)) &&
+      ((false == captures[kChannel].active) ||
+       (kPin != captures[kChannel].pin))) {
+    return kFailure;
+  }
+  (void)drv_capture_stop(kChannel);
+  if ((kSuccess != capture_timer_start()) ||
+      (kSuccess != drv_gpio_pin_claim(kPin))) {
+    return kFailure;
+  }
+
+  capture_t *const capture = &captures[kChannel];
+  memset(capture, 0, sizeof(*capture));
+  capture->pin = kPin;
+  if (NRFX_SUCCESS != nrfx_gpiote_channel_alloc(&capture_gpiote,
+                                                &capture->gpiote_channel)) {
+    LOG_ERR("No GPIOTE channel left");
+    drv_gpio_pin_unclaim(kPin);
+    return kFailure;
+  }
+  if (NRFX_SUCCESS != nrfx_gppi_channel_alloc(&capture->ppi_channel)) {
+    LOG_ERR("No PPI channel left");
+    (void)nrfx_gpiote_channel_free(&capture_gpiote, capture->gpiote_channel);
+    drv_gpio_pin_unclaim(kPin);
+    return kFailure;
+  }
+
+  const nrf_gpio_pin_pull_t kPull =
+      kPullUp ? NRF_GPIO_PIN_PULLUP : NRF_GPIO_PIN_NOPULL;
+  const nrfx_gpiote_trigger_config_t kTrigger = {
+      .trigger = kTriggers[kEdge],
+      .p_in_channel = &capture->gpiote_channel,
+  };
+  const nrfx_gpiote_handler_config_t kHandler = {
+      .handler = capture_gpiote_handler,
+      .p_context = capture,
+  };
+  const nrfx_gpiote_input_pin_config_t kInput = {
+      .p_pull_config = &kPull,
+      .p_trigger_config = &kTrigger,
+      .p_handler_config = &kHandler,
+  };
+  if (NRFX_SUCCESS !=
+      nrfx_gpiote_input_configure(&capture_gpiote, kPin, &kInput)) {
+    LOG_ERR("Failed to configure capture pin %u", kPin);
+    (void)nrfx_gppi_channel_free(capture->ppi_channel);
+    (void)nrfx_gpiote_channel_free(&capture_gpiote, capture->gpiote_channel);
+    drv_gpio_pin_unclaim(kPin);
+    return kFailure;
+  }
+
+  // Edge -> CAPTURE[kChannel], so the timestamp does not wait for the ISR
+  nrfx_gppi_channel_endpoints_setup(
+      capture->ppi_channel,
+      nrfx_gpiote_in_event_address_get(&capture_gpiote, kPin),
+      nrfx_timer_task_address_get(
+          &capture_timer,
+          nrf_timer_capture_task_get((nrf_timer_cc_channel_t)kChannel)));
+  nrfx_gppi_channels_enable(BIT(capture->ppi_channel));
+  capture->active = true;
+  nrfx_gpiote_trigger_enable(&capture_gpiote, kPin, true);
+  return kSuccess;
+}
+
+/**
+ * @brief Stops a capture channel and releases its pin
+ *
+ * @param kChannel Channel index
+ * @return fn_t kSuccess if successful, kFailure if not running
+ */
+fn_t drv_capture_stop(const uint8_t kChannel) {
+  if ((DRV_CAPTURE_CHANNELS <= kChannel) ||
+      (false == captures[kChannel].active)) {
+    return kFailure;
+  }
+  capture_t *const capture = &captures[kChannel];
+  nrfx_gpiote_trigger_disable(&capture_gpiote, capture->pin);
+  nrfx_gppi_channels_disable(BIT(capture->ppi_channel));
+  (void)nrfx_gppi_channel_free(capture->ppi_channel);
+  (void)nrfx_gpiote_pin_uninit(&capture_gpiote, capture->pin);
+  (void)nrfx_gpiote_channel_free(&capture_gpiote, capture->gpiote_channel);
+  drv_gpio_pin_unclaim(capture->pin);
+  capture->active = false;
+  return kSuccess;
+}
+
+/**
+ * @brief Stops all capture channels
+ */
+void drv_capture_stop_all(void) {
+  for (uint8_t i = 0U; DRV_CAPTURE_CHANNELS > i; i++) {
+    (void)drv_capture_stop(i);
+  }
+}
+
+/**
+ * @brief Copies the state of a capture channel
+ *
+ * @param kChannel Channel index
+ * @param snapshot Destination
+ * @return fn_t kSuccess if successful, kFailure if not running
+ */
+fn_t drv_capture_snapshot(const uint8_t kChannel,
+                          drv_capture_snapshot_t *const snapshot) {
+  if ((DRV_CAPTURE_CHANNELS <= kChannel) ||
+      (false == captures[kChannel].active)) {
+    return kFailure;
+  }
+  const capture_t *const kCapture = &captures[kChannel];
+  const k_spinlock_key_t kKey = k_spin_lock(&capture_lock);
+  snapshot->count = kCapture->count;
+  snapshot->stored = MIN(kCapture->count, DRV_CAPTURE_RING_SIZE);
+  // Unroll the ring so that the oldest entry comes first
+  for (uint32_t i = 0U; snapshot->stored > i; i++) {
+    const size_t kIndex =
+        (kCapture->count - snapshot->stored + i) & (DRV_CAPTURE_RING_SIZE - 1U);
+    snapshot->timestamps[i] = kCapture->timestamps[kIndex];
+    snapshot->levels[i] = kCapture->levels[kIndex];
+  }
+  // CAPTURE of the spare channel gives the current time
+  snapshot->now = nrfx_timer_capture(
+      &capture_timer, (nrf_timer_cc_channel_t)DRV_CAPTURE_CHANNELS);
+  k_spin_unlock(&capture_lock, kKey);
+  return kSuccess;
+}
@@ -0,0 +1,97 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file capture.h
+ * @brief Input capture driver interface
+ * @details Timestamps the edges of input pins in hardware and keeps the
+ * latest timestamps in a ring per channel, so pulse rates can be measured
+ * without polling
+ */
+#ifndef DRV_CAPTURE_H
+#define DRV_CAPTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../lib/fn.h"
+
+/**
+ * @brief Number of capture channels
+ */
+#define DRV_CAPTURE_CHANNELS 2U
+
+/**
+ * @brief Timestamps kept per channel (power of 2)
+ */
+#define DRV_CAPTURE_RING_SIZE 64U
+
+/**
+ * @brief Timestamp resolution in Hz
+ */
+#define DRV_CAPTURE_TIMER_HZ 1000000U
+
+/**
+ * @typedef drv_capture_edge_t
+ * @brief Enumeration of captured edges
+ */
+typedef enum {
+  kDrvCaptureEdgeRising,  /**< Low to high */
+  kDrvCaptureEdgeFalling, /**< High to low */
+  kDrvCaptureEdgeBoth,    /**< Both edges */
+} drv_capture_edge_t;
+
+/**
+ * @brief Snapshot of a capture channel
+ *
+ * @details timestamps and levels hold the latest edges, oldest first
+ */
+typedef struct {
+  uint32_t count;                             /**< Edges since start */
+  uint32_t stored;                            /**< Valid timestamps */
+  uint32_t timestamps[DRV_CAPTURE_RING_SIZE]; /**< Edge times in us */
+  uint8_t levels[DRV_CAPTURE_RING_SIZE];      /**< Level after each edge */
+  uint32_t now;                               /**< Time of the snapshot */
+} drv_capture_snapshot_t;
+
+/**
+ * @brief Starts capturing the edges of a pin
+ *
+ * @details A running capture on the channel is stopped first. The pin is
+ * claimed from the GPIO driver, so pins owned there or by other channels
+ * are refused.
+ *
+ * @param kChannel Channel index
+ * @param kPin Pin number (port * 32 + pin)
+ * @param kEdge Edges to capture
+ * @param kPullUp true to enable the pull-up
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_capture_start(const uint8_t kChannel, const uint8_t kPin,
+                       const drv_capture_edge_t kEdge, const bool kPullUp);
+
+/**
+ * @brief Stops a capture channel and releases its pin
+ *
+ * @param kChannel Channel index
+ * @return fn_t kSuccess if successful, kFailure if not running
+ */
+fn_t drv_capture_stop(const uint8_t kChannel);
+
+/**
+ * @brief Stops all capture channels
+ */
+void drv_capture_stop_all(void);
+
+/**
+ * @brief Copies the state of a capture channel
+ *
+ * @param kChannel Channel index
+ * @param snapshot Destination
+ * @return fn_t kSuccess if successful, kFailure if not running
+ */
+fn_t drv_capture_snapshot(const uint8_t kChannel,
+                          drv_capture_snapshot_t *const snapshot);
+
+#endif
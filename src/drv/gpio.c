@@ -5,7 +5,9 @@
 /**
  * @file gpio.c
  * @brief Implementation of GPIO driver
- * @details Implements functions for controlling LEDs and reading switch states
+ * @details Implements functions for controlling LEDs and reading switch
+ * states. Blink patterns advance in k_timer expiry functions, so a blinking
+ * LED wakes neither the VM nor any other thread.
  */
 #include "gpio.h"
 
@@ -13,24 +15,118 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <zephyr/drivers/gpio.h>
+#include <zephyr/dt-bindings/pinctrl/nrf-pinctrl.h>
+#include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
 
 #include "../lib/fn.h"
 
 LOG_MODULE_REGISTER(drv_gpio, LOG_LEVEL_DBG);
 
-/** @brief GPIO specifications for switches */
-static const struct gpio_dt_spec kSw[4] = {
-    GPIO_DT_SPEC_GET(DT_ALIAS(sw0), gpios),
-    GPIO_DT_SPEC_GET(DT_ALIAS(sw1), gpios),
-    GPIO_DT_SPEC_GET(DT_ALIAS(sw2), gpios),
-    GPIO_DT_SPEC_GET(DT_ALIAS(sw3), gpios)};
+/** @brief GPIO specifications, indexed by drv_gpio_t */
+static const struct gpio_dt_spec kPins[kDrvGpioTSize] = {
+#define DRV_GPIO_SPEC(name, alias, output) \
+  [kDrvGpio##name] = GPIO_DT_SPEC_GET(DT_ALIAS(alias), gpios),
+    DRV_GPIO_PINS(DRV_GPIO_SPEC)
+#undef DRV_GPIO_SPEC
+};
 
-/** @brief GPIO specifications for LEDs */
-static const struct gpio_dt_spec kLed[3] = {
-    GPIO_DT_SPEC_GET(DT_ALIAS(led0), gpios),
-    GPIO_DT_SPEC_GET(DT_ALIAS(led1), gpios),
-    GPIO_DT_SPEC_GET(DT_ALIAS(led2), gpios)};
+/** @brief true for output pins, indexed by drv_gpio_t */
+static const bool kOutput[kDrvGpioTSize] = {
+#define DRV_GPIO_OUTPUT(name, alias, output) [kDrvGpio##name] = output,
+    DRV_GPIO_PINS(DRV_GPIO_OUTPUT)
+#undef DRV_GPIO_OUTPUT
+};
+
+/** @brief GPIO ports */
+static const struct device *const kPorts[] = {
+    DEVICE_DT_GET(DT_NODELABEL(gpio0)),
+#if DT_NODE_HAS_STATUS(DT_NODELABEL(gpio1), okay)
+    DEVICE_DT_GET(DT_NODELABEL(gpio1)),
+#endif
+};
+
+/** @brief Pin of a pinctrl psels entry (port * 32 + pin) */
+#define DRV_GPIO_PSEL_PIN(psel) (((psel) >> NRF_PIN_POS) & NRF_PIN_MSK)
+
+/** @brief Bit of a psels entry, nothing for a disconnected one */
+#define DRV_GPIO_PSEL_BIT(node, prop, idx)                           \
+  | ((64U > DRV_GPIO_PSEL_PIN(DT_PROP_BY_IDX(node, prop, idx)))      \
+         ? BIT64(DRV_GPIO_PSEL_PIN(DT_PROP_BY_IDX(node, prop, idx)) & \
+                 0x3FU)                                               \
+         : 0ULL)
+
+/** @brief Bits of all psels of a pinctrl group */
+#define DRV_GPIO_GROUP_PINS(group) \
+  DT_FOREACH_PROP_ELEM(group, psels, DRV_GPIO_PSEL_BIT)
+
+/** @brief Bits of the default pinctrl state of an enabled node */
+#define DRV_GPIO_NODE_PINS(label)                                        \
+  COND_CODE_1(DT_NODE_HAS_STATUS(DT_NODELABEL(label), okay),            \
+              (COND_CODE_1(DT_PINCTRL_HAS_IDX(DT_NODELABEL(label), 0),  \
+                           (DT_FOREACH_CHILD(                           \
+                               DT_PINCTRL_BY_IDX(DT_NODELABEL(label), 0, \
+                                                 0),                    \
+                               DRV_GPIO_GROUP_PINS)),                   \
+                           ())),                                        \
+              ())
+
+/**
+ * @brief Peripherals whose pins are routed by pinctrl
+ *
+ * @details Their pins are refused by drv_gpio_port_setup()
+ */
+#define DRV_GPIO_PERIPHERALS(X) \
+  X(uart0)                      \
+  X(uart1)                      \
+  X(i2c0)                       \
+  X(i2c1)                       \
+  X(spi0)                       \
+  X(spi1)                       \
+  X(spi2)                       \
+  X(spi3)                       \
+  X(pwm0)                       \
+  X(pwm1)                       \
+  X(pwm2)                       \
+  X(pwm3)                       \
+  X(qspi)
+
+/** @brief Pins of the peripherals (bit port * 32 + pin) */
+static const uint64_t kPeripheralPins =
+    0ULL DRV_GPIO_PERIPHERALS(DRV_GPIO_NODE_PINS);
+
+/** @brief Pins of each port owned by kPins or by other peripherals */
+static uint32_t port_owned[ARRAY_SIZE(kPorts)];
+
+/** @brief Pins of each port set up with drv_gpio_port_setup() */
+static uint32_t port_used[ARRAY_SIZE(kPorts)];
+
+/** @brief Output pins of each port set up with drv_gpio_port_setup() */
+static uint32_t port_output[ARRAY_SIZE(kPorts)];
+
+/** @brief Pins of each port claimed with drv_gpio_pin_claim() */
+static uint32_t port_claimed[ARRAY_SIZE(kPorts)];
+
+/**
+ * @brief Running blink pattern of an LED
+ */
+typedef struct {
+  struct k_timer timer;       /**< Timer ending the current phase */
+  drv_gpio_pattern_t pattern; /**< Pattern */
+  uint16_t bursts;            /**< Completed bursts */
+  uint16_t phase;             /**< Even: flash on, odd: off after a flash */
+} led_pattern_t;
+
+/** @brief Blink pattern state, indexed by drv_gpio_t (outputs only) */
+static led_pattern_t led_patterns[kDrvGpioTSize];
+
+/**
+ * @brief Timer expiry function advancing a blink pattern
+ *
+ * @param timer Pointer to the timer
+ */
+static void led_pattern_expiry(struct k_timer *timer);
 
 /**
  * @brief Initializes the GPIO subsystem
@@ -41,10 +137,10 @@ static const struct gpio_dt_spec kLed[3] = {
  */
 fn_t drv_gpio_init(void) {
   fn_t tmp_ret = kSuccess;
-  // input
-  for (size_t i = 0; i < sizeof(kSw) / sizeof(kSw[0]); i++) {
-    if (true == gpio_is_ready_dt(&kSw[i])) {
-      if (0 > gpio_pin_configure_dt(&kSw[i], GPIO_INPUT)) {
+  for (size_t i = 0; i < ARRAY_SIZE(kPins); i++) {
+    const gpio_flags_t kFlags = kOutput[i] ? GPIO_OUTPUT_INACTIVE : GPIO_INPUT;
+    if (true == gpio_is_ready_dt(&kPins[i])) {
+      if (0 > gpio_pin_configure_dt(&kPins[i], kFlags)) {
         tmp_ret = kFailure;
         LOG_ERR("Failed to configure GPIO %d", i);
       }
@@ -52,19 +148,18 @@ fn_t drv_gpio_init(void) {
       tmp_ret = kFailure;
       LOG_ERR("Failed to get GPIO %d", i);
     }
-  }
-  // output
-  for (size_t i = 0; i < sizeof(kLed) / sizeof(kLed[0]); i++) {
-    if (true == gpio_is_ready_dt(&kLed[i])) {
-      if (0 > gpio_pin_configure_dt(&kLed[i], GPIO_OUTPUT_INACTIVE)) {
-        tmp_ret = kFailure;
-        LOG_ERR("Failed to configure LED %d", i);
+    if (true == kOutput[i]) {
+      k_timer_init(&led_patterns[i].timer, led_pattern_expiry, NULL);
+    }
+    for (size_t port = 0; ARRAY_SIZE(kPorts) > port; port++) {
+      if (kPorts[port] == kPins[i].port) {
+        port_owned[port] |= BIT(kPins[i].pin);
       }
-    } else {
-      tmp_ret = kFailure;
-      LOG_ERR("Failed to get LED %d", i);
     }
   }
+  for (size_t port = 0; ARRAY_SIZE(kPorts) > port; port++) {
+    port_owned[port] |= (uint32_t)(kPeripheralPins >> (32U * port));
+  }
 
   return tmp_ret;
 }
@@ -74,57 +169,292 @@ fn_t drv_gpio_init(void) {
  *
  * @param kTgt Target GPIO pin
  * @return true if the pin is active (switch pressed)
- * @return false if the pin is inactive (switch released)
+ * @return false if the pin is inactive (switch released) or an output
  */
 bool drv_gpio_get(const drv_gpio_t kTgt) {
-  switch (kTgt) {
-    case kDrvGpioSW1:
-      if (1 == gpio_pin_get_dt(&kSw[0])) {
-        return true;
-      }
-      break;
-    case kDrvGpioSW2:
-      if (1 == gpio_pin_get_dt(&kSw[1])) {
-        return true;
-      }
-      break;
-    case kDrvGpioSW3:
-      if (1 == gpio_pin_get_dt(&kSw[2])) {
-        return true;
-      }
-      break;
-    case kDrvGpioSW4:
-      if (1 == gpio_pin_get_dt(&kSw[3])) {
-        return true;
-      }
-      break;
-    default:
-      return false;
+  if ((kDrvGpioTSize <= kTgt) || (true == kOutput[kTgt])) {
+    return false;
   }
-  return false;
+  return (1 == gpio_pin_get_dt(&kPins[kTgt]));
 }
 
 /**
  * @brief Sets the state of a GPIO pin
  *
+ * @details Stops a blink pattern running on the pin
+ *
  * @param kTgt Target GPIO pin
  * @param kReq Requested state (true for active, false for inactive)
  * @return fn_t kSuccess if successful, kFailure otherwise
  */
 fn_t drv_gpio_set(const drv_gpio_t kTgt, const bool kReq) {
-  int tmp_value = kReq ? 1 : 0;
-  switch (kTgt) {
-    case kDrvGpioLED1:
-      gpio_pin_set_dt(&kLed[0], tmp_value);
-      return kSuccess;
-    case kDrvGpioLED2:
-      gpio_pin_set_dt(&kLed[1], tmp_value);
-      return kSuccess;
-    case kDrvGpioLED3:
-      gpio_pin_set_dt(&kLed[2], tmp_value);
-      return kSuccess;
+  if ((kDrvGpioTSize <= kTgt) || (false == kOutput[kTgt])) {
+    return kFailure;
+  }
+  k_timer_stop(&led_patterns[kTgt].timer);
+  gpio_pin_set_dt(&kPins[kTgt], kReq ? 1 : 0);
+  return kSuccess;
+}
+
+/**
+ * @brief Drives an LED for the current phase of its pattern
+ *
+ * @details Called from thread context to start a pattern and from the timer
+ * expiry function afterwards
+ *
+ * @param kIndex Output pin (drv_gpio_t)
+ */
+static void led_pattern_apply(const size_t kIndex) {
+  led_pattern_t *const led = &led_patterns[kIndex];
+  const drv_gpio_pattern_t *const kPattern = &led->pattern;
+  const bool kOn = (0U == (led->phase % 2U));
+  const bool kBurstEnd = ((2U * kPattern->count) - 1U) == led->phase;
+
+  (void)gpio_pin_set_dt(&kPins[kIndex], kOn ? 1 : 0);
+  if (true == kOn) {
+    k_timer_start(&led->timer, K_MSEC(kPattern->on_ms), K_NO_WAIT);
+  } else if (false == kBurstEnd) {
+    k_timer_start(&led->timer, K_MSEC(kPattern->off_ms), K_NO_WAIT);
+  } else if ((0U == kPattern->repeat) ||
+             ((led->bursts + 1U) < kPattern->repeat)) {
+    k_timer_start(&led->timer,
+                  K_MSEC((uint32_t)kPattern->off_ms + kPattern->pause_ms),
+                  K_NO_WAIT);
+  } else {
+    // Last burst: the LED stays off and the timer is not restarted
+  }
+}
+
+/**
+ * @brief Timer expiry function advancing a blink pattern
+ *
+ * @param timer Pointer to the timer
+ */
+static void led_pattern_expiry(struct k_timer *timer) {
+  led_pattern_t *const led = CONTAINER_OF(timer, led_pattern_t, timer);
+  led->phase++;
+  if ((2U * led->pattern.count) <= led->phase) {
+    led->phase = 0U;
+    led->bursts++;
+  }
+  led_pattern_apply((size_t)(led - led_patterns));
+}
+
+/**
+ * @brief Starts a blink pattern on an LED
+ *
+ * @details Replaces any pattern already running on the LED. drv_gpio_set()
+ * on the LED stops the pattern.
+ *
+ * @param kTgt Target LED
+ * @param kPattern Pattern (copied)
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_gpio_pattern_start(const drv_gpio_t kTgt,
+                            const drv_gpio_pattern_t *const kPattern) {
+  if ((kDrvGpioTSize <= kTgt) || (false == kOutput[kTgt]) ||
+      (NULL == kPattern) || (0U == kPattern->on_ms) ||
+      (0U == kPattern->count) ||
+      (0U == ((uint32_t)kPattern->off_ms + kPattern->pause_ms))) {
+    return kFailure;
+  }
+  const size_t kIndex = (size_t)kTgt;
+  led_pattern_t *const led = &led_patterns[kIndex];
+
+  // Once stopped, the expiry function no longer touches the state
+  k_timer_stop(&led->timer);
+  led->pattern = *kPattern;
+  led->bursts = 0U;
+  led->phase = 0U;
+  led_pattern_apply(kIndex);
+  return kSuccess;
+}
+
+/**
+ * @brief Stops the blink patterns of all LEDs and turns them off
+ */
+void drv_gpio_pattern_stop_all(void) {
+  for (size_t i = 0; kDrvGpioTSize > i; i++) {
+    if (true == kOutput[i]) {
+      k_timer_stop(&led_patterns[i].timer);
+      (void)gpio_pin_set_dt(&kPins[i], 0);
+    }
+  }
+}
+
+/**
+ * @brief Gets the number of GPIO ports
+ *
+ * @return size_t Number of ports
+ */
+size_t drv_gpio_port_count(void) { return ARRAY_SIZE(kPorts); }
+
+/**
+ * @brief Checks a port index and pin mask
+ *
+ * @param kPort Port index
+ * @param kMask Pins
+ * @return true if the port is ready and all pins exist
+ */
+static bool port_valid(const uint8_t kPort, const uint32_t kMask) {
+  if ((ARRAY_SIZE(kPorts) <= kPort) ||
+      (false == device_is_ready(kPorts[kPort]))) {
+    return false;
+  }
+  const struct gpio_driver_config *const kConfig = kPorts[kPort]->config;
+  return (0U != kMask) && (kMask == (kMask & kConfig->port_pin_mask));
+}
+
+/**
+ * @brief Sets the mode of port pins
+ *
+ * @details Pins in DRV_GPIO_PINS, pins routed to other peripherals by
+ * pinctrl and pins claimed by other drivers (PWM sequence, capture) are
+ * owned elsewhere and rejected
+ *
+ * @param kPort Port index
+ * @param kMask Pins to configure
+ * @param kMode Mode
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_gpio_port_setup(const uint8_t kPort, const uint32_t kMask,
+                         const drv_gpio_port_mode_t kMode) {
+  gpio_flags_t flags;
+  if ((false == port_valid(kPort, kMask)) ||
+      (0U != (kMask & (port_owned[kPort] | port_claimed[kPort])))) {
+    return kFailure;
+  }
+  switch (kMode) {
+    case kDrvGpioPortDisconnect:
+      flags = GPIO_DISCONNECTED;
+      break;
+    case kDrvGpioPortInput:
+      flags = GPIO_INPUT;
+      break;
+    case kDrvGpioPortInputPullUp:
+      flags = GPIO_INPUT | GPIO_PULL_UP;
+      break;
+    case kDrvGpioPortOutput:
+      flags = GPIO_OUTPUT_LOW;
+      break;
     default:
       return kFailure;
   }
-  return kFailure;
+  for (uint32_t pin = 0U; 32U > pin; pin++) {
+    if ((0U != (kMask & BIT(pin))) &&
+        (0 > gpio_pin_configure(kPorts[kPort], (gpio_pin_t)pin, flags))) {
+      LOG_ERR("Failed to configure P%u.%02u", kPort, pin);
+      return kFailure;
+    }
+  }
+  if (kDrvGpioPortDisconnect == kMode) {
+    port_used[kPort] &= ~kMask;
+  } else {
+    port_used[kPort] |= kMask;
+  }
+  if (kDrvGpioPortOutput == kMode) {
+    port_output[kPort] |= kMask;
+  } else {
+    port_output[kPort] &= ~kMask;
+  }
+  return kSuccess;
+}
+
+/**
+ * @brief Reads the raw levels of port pins in one register access
+ *
+ * @param kPort Port index
+ * @param kMask Pins to read
+ * @param value Levels, bits outside kMask are 0
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_gpio_port_read(const uint8_t kPort, const uint32_t kMask,
+                        uint32_t *const value) {
+  gpio_port_value_t raw;
+  if ((false == port_valid(kPort, kMask)) ||
+      (0 > gpio_port_get_raw(kPorts[kPort], &raw))) {
+    return kFailure;
+  }
+  *value = (uint32_t)raw & kMask;
+  return kSuccess;
+}
+
+/**
+ * @brief Writes the raw levels of port output pins in one register access
+ *
+ * @param kPort Port index
+ * @param kMask Pins to write (must be set up as outputs)
+ * @param kValue Levels
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_gpio_port_write(const uint8_t kPort, const uint32_t kMask,
+                         const uint32_t kValue) {
+  if ((false == port_valid(kPort, kMask)) ||
+      (kMask != (kMask & port_output[kPort]))) {
+    return kFailure;
+  }
+  if (0 > gpio_port_set_masked_raw(kPorts[kPort], kMask, kValue)) {
+    return kFailure;
+  }
+  return kSuccess;
+}
+
+/**
+ * @brief Checks that a pin is free for another driver
+ *
+ * @details Pins in DRV_GPIO_PINS, pins routed to other peripherals by
+ * pinctrl, port pins set up with drv_gpio_port_setup() and claimed pins are
+ * not free
+ *
+ * @param kPin Pin number (port * 32 + pin)
+ * @return true if the pin is free
+ */
+bool drv_gpio_pin_available(const uint8_t kPin) {
+  const size_t kPort = kPin / 32U;
+  if (ARRAY_SIZE(kPorts) <= kPort) {
+    return false;
+  }
+  const uint32_t kTaken =
+      port_owned[kPort] | port_used[kPort] | port_claimed[kPort];
+  return (0U == (kTaken & BIT(kPin % 32U)));
+}
+
+/**
+ * @brief Claims a pin for another driver
+ *
+ * @details A claimed pin is refused by drv_gpio_port_setup() until it is
+ * unclaimed
+ *
+ * @param kPin Pin number (port * 32 + pin)
+ * @return fn_t kSuccess if successful, kFailure if the pin is not free
+ */
+fn_t drv_gpio_pin_claim(const uint8_t kPin) {
+  if (false == drv_gpio_pin_available(kPin)) {
+    return kFailure;
+  }
+  port_claimed[kPin / 32U] |= BIT(kPin % 32U);
+  return kSuccess;
+}
+
+/**
+ * @brief Unclaims a pin claimed with drv_gpio_pin_claim()
+ *
+ * @param kPin Pin number (port * 32 + pin)
+ */
+void drv_gpio_pin_unclaim(const uint8_t kPin) {
+  if (ARRAY_SIZE(kPorts) > (kPin / 32U)) {
+    port_claimed[kPin / 32U] &= ~BIT(kPin % 32U);
+  }
+}
+
+/**
+ * @brief Releases all pins set up with drv_gpio_port_setup()
+ */
+void drv_gpio_port_release(void) {
+  for (size_t port = 0; ARRAY_SIZE(kPorts) > port; port++) {
+    if (0U != port_used[port]) {
+      (void)drv_gpio_port_setup((uint8_t)port, port_used[port],
+                                kDrvGpioPortDisconnect);
+    }
+  }
 }
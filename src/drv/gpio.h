@@ -5,29 +5,72 @@
 /**
  * @file gpio.h
  * @brief GPIO driver interface
- * @details Provides functions for controlling LEDs and reading switch states
+ * @details Provides functions for controlling LEDs and reading switch states.
+ * LEDs can also run blink patterns from a kernel timer without involving any
+ * thread. Port functions access several pins of a port in one register
+ * access.
  */
 #ifndef DRV_GPIO_H
 #define DRV_GPIO_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include "../lib/fn.h"
 
+/**
+ * @brief GPIO pins as X(name, devicetree alias, output)
+ *
+ * @details Adding a pin takes one line here and the alias in devicetree; the
+ * enumeration and the pin table are generated from this list
+ */
+#define DRV_GPIO_PINS(X) \
+  X(SW1, sw0, false)     \
+  X(SW2, sw1, false)     \
+  X(SW3, sw2, false)     \
+  X(SW4, sw3, false)     \
+  X(LED1, led0, true)    \
+  X(LED2, led1, true)    \
+  X(LED3, led2, true)
+
 /**
  * @typedef drv_gpio_t
  * @brief Enumeration of GPIO pins for switches and LEDs
  */
 typedef enum {
-  kDrvGpioSW1,  /**< Switch 1 */
-  kDrvGpioSW2,  /**< Switch 2 */
-  kDrvGpioSW3,  /**< Switch 3 */
-  kDrvGpioSW4,  /**< Switch 4 */
-  kDrvGpioLED1, /**< LED 1 */
-  kDrvGpioLED2, /**< LED 2 */
-  kDrvGpioLED3, /**< LED 3 */
+#define DRV_GPIO_ENUM(name, alias, output) kDrvGpio##name,
+  DRV_GPIO_PINS(DRV_GPIO_ENUM)
+#undef DRV_GPIO_ENUM
+  kDrvGpioTSize /**< Total number of pins (enum size) */
 } drv_gpio_t;
 
+/**
+ * @typedef drv_gpio_port_mode_t
+ * @brief Enumeration of modes of port pins
+ */
+typedef enum {
+  kDrvGpioPortDisconnect,  /**< Released (input buffer disconnected) */
+  kDrvGpioPortInput,       /**< Input */
+  kDrvGpioPortInputPullUp, /**< Input with pull-up */
+  kDrvGpioPortOutput,      /**< Output, initially low */
+} drv_gpio_port_mode_t;
+
+/**
+ * @brief LED blink pattern
+ *
+ * @details A burst is count flashes of on_ms separated by off_ms; the last
+ * flash of a burst is followed by off_ms + pause_ms. The LED is left off when
+ * the pattern ends.
+ */
+typedef struct {
+  uint16_t on_ms;    /**< On time of a flash (at least 1) */
+  uint16_t off_ms;   /**< Off time between flashes */
+  uint16_t pause_ms; /**< Extra off time after a burst */
+  uint8_t count;     /**< Flashes per burst (at least 1) */
+  uint16_t repeat;   /**< Number of bursts, 0 for endless */
+} drv_gpio_pattern_t;
+
 /**
  * @brief Initializes the GPIO subsystem
  *
@@ -40,7 +83,7 @@ fn_t drv_gpio_init(void);
  *
  * @param kTgt Target GPIO pin
  * @return true if the pin is active (switch pressed)
- * @return false if the pin is inactive (switch released)
+ * @return false if the pin is inactive (switch released) or an output
  */
 bool drv_gpio_get(const drv_gpio_t kTgt);
 
@@ -53,4 +96,101 @@ bool drv_gpio_get(const drv_gpio_t kTgt);
  */
 fn_t drv_gpio_set(const drv_gpio_t kTgt, const bool kReq);
 
+/**
+ * @brief Starts a blink pattern on an LED
+ *
+ * @details Replaces any pattern already running on the LED. drv_gpio_set()
+ * on the LED stops the pattern.
+ *
+ * @param kTgt Target LED
+ * @param kPattern Pattern (copied)
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_gpio_pattern_start(const drv_gpio_t kTgt,
+                            const drv_gpio_pattern_t *const kPattern);
+
+/**
+ * @brief Stops the blink patterns of all LEDs and turns them off
+ */
+void drv_gpio_pattern_stop_all(void);
+
+/**
+ * @brief Gets the number of GPIO ports
+ *
+ * @return size_t Number of ports
+ */
+size_t drv_gpio_port_count(void);
+
+/**
+ * @brief Sets the mode of port pins
+ *
+ * @details Pins in DRV_GPIO_PINS, pins routed to other peripherals by
+ * pinctrl and pins claimed by other drivers (PWM sequence, capture) are
+ * owned elsewhere and rejected
+ *
+ * @param kPort Port index
+ * @param kMask Pins to configure
+ * @param kMode Mode
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_gpio_port_setup(const uint8_t kPort, const uint32_t kMask,
+                         const drv_gpio_port_mode_t kMode);
+
+/**
+ * @brief Reads the raw levels of port pins in one register access
+ *
+ * @param kPort Port index
+ * @param kMask Pins to read
+ * @param value Levels, bits outside kMask are 0
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_gpio_port_read(const uint8_t kPort, const uint32_t kMask,
+                        uint32_t *const value);
+
+/**
+ * @brief Writes the raw levels of port output pins in one register access
+ *
+ * @param kPort Port index
+ * @param kMask Pins to write (must be set up as outputs)
+ * @param kValue Levels
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_gpio_port_write(const uint8_t kPort, const uint32_t kMask,
+                         const uint32_t kValue);
+
+/**
+ * @brief Checks that a pin is free for another driver
+ *
+ * @details Pins in DRV_GPIO_PINS, pins routed to other peripherals by
+ * pinctrl, port pins set up with drv_gpio_port_setup() and claimed pins are
+ * not free
+ *
+ * @param kPin Pin number (port * 32 + pin)
+ * @return true if the pin is free
+ */
+bool drv_gpio_pin_available(const uint8_t kPin);
+
+/**
+ * @brief Claims a pin for another driver
+ *
+ * @details A claimed pin is refused by drv_gpio_port_setup() until it is
+ * unclaimed
+ *
+ * @param kPin Pin number (port * 32 + pin)
+ * @return fn_t kSuccess if successful, kFailure if the pin is not free
+ */
+fn_t drv_gpio_pin_claim(const uint8_t kPin);
+
+/**
+ * @brief Unclaims a pin claimed with drv_gpio_pin_claim()
+ *
+ * @param kPin Pin number (port * 32 + pin)
+ */
+void drv_gpio_pin_unclaim(const uint8_t kPin);
+
+/**
+ * @brief Releases all pins set up with drv_gpio_port_setup()
+ */
+void drv_gpio_port_release(void);
+
 #endif
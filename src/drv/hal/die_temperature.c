@@ -6,11 +6,13 @@
  * @file die_temperature.c
  * @brief Implementation of die temperature sensor interface
  * @details Implements functions for reading the die temperature from the Nordic
- * nRF chip
+ * nRF chip. A delayable work item on the system work queue samples the sensor
+ * periodically, so readers never wait for a conversion.
  */
 #include "die_temperature.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <zephyr/device.h>
 #include <zephyr/drivers/sensor.h>
 #include <zephyr/kernel.h>
@@ -22,29 +24,148 @@ LOG_MODULE_REGISTER(hal_die_temperature, LOG_LEVEL_WRN);
 
 static const struct device* kDevDieTemp = DEVICE_DT_GET_ANY(nordic_nrf_temp);
 
+/** @brief Sampling period in milliseconds */
+static uint32_t period_ms = HAL_DIE_TEMPERATURE_PERIOD_MS;
+
+/** @brief Latest sample in millidegrees Celsius */
+static int32_t temp_mdeg = 0;
+
+/** @brief Moving average in millidegrees Celsius */
+static int32_t average_mdeg = 0;
+
+/** @brief Uptime of the latest sample in milliseconds */
+static int64_t timestamp_ms = 0;
+
+/** @brief true once a sample is available */
+static bool is_valid = false;
+
+/** @brief Lock protecting the cached values */
+static struct k_spinlock temp_lock;
+
 /**
- * @brief Gets the current die temperature
+ * @brief Work handler sampling the sensor
  *
- * @details Reads the temperature from the Nordic nRF temperature sensor
+ * @param work Pointer to the work item
+ */
+static void die_temperature_work(struct k_work* const work);
+K_WORK_DELAYABLE_DEFINE(work_die_temperature, die_temperature_work);
+
+/**
+ * @brief Initializes the die temperature sensor and starts sampling
  *
- * @return float Temperature in degrees Celsius, or INT32_MIN on error
+ * @return fn_t kSuccess if successful, kFailure otherwise
  */
-float hal_die_temperature_get(void) {
-  struct sensor_value temp_val;
-  if (true == device_is_ready(kDevDieTemp)) {
-    int ret;
-    ret = sensor_sample_fetch(kDevDieTemp);
-    if (0 != ret) {
-      LOG_ERR("sensor_sample_fetch() failed: %d", ret);
-      return INT32_MIN;
-    }
+fn_t hal_die_temperature_init(void) {
+  if (false == device_is_ready(kDevDieTemp)) {
+    LOG_ERR("Die temperature sensor is not ready");
+    return kFailure;
+  }
+  k_work_schedule(&work_die_temperature, K_NO_WAIT);
+  return kSuccess;
+}
+
+/**
+ * @brief Sets the sampling period
+ *
+ * @param kPeriodMs Sampling period in milliseconds
+ * @return fn_t kSuccess if successful, kFailure if the period is too short
+ */
+fn_t hal_die_temperature_set_period(const uint32_t kPeriodMs) {
+  if (HAL_DIE_TEMPERATURE_PERIOD_MIN_MS > kPeriodMs) {
+    return kFailure;
+  }
+  K_SPINLOCK(&temp_lock) { period_ms = kPeriodMs; }
+  // Apply at once when the new period is shorter than the remaining wait
+  if (k_ticks_to_ms_ceil32(k_work_delayable_remaining_get(
+          &work_die_temperature)) > kPeriodMs) {
+    k_work_reschedule(&work_die_temperature, K_MSEC(kPeriodMs));
+  }
+  return kSuccess;
+}
+
+/**
+ * @brief Work handler sampling the sensor
+ *
+ * @param work Pointer to the work item
+ */
+static void die_temperature_work(struct k_work* const work) {
+  struct sensor_value temp_val = {0};
+  uint32_t next_ms = HAL_DIE_TEMPERATURE_PERIOD_MS;
+  int ret;
+
+  ret = sensor_sample_fetch(kDevDieTemp);
+  if (0 != ret) {
+    LOG_ERR("sensor_sample_fetch() failed: %d", ret);
+  } else {
     ret = sensor_channel_get(kDevDieTemp, SENSOR_CHAN_DIE_TEMP, &temp_val);
     if (0 != ret) {
       LOG_ERR("sensor_channel_get() failed: %d", ret);
-      return INT32_MIN;
+    } else {
+      LOG_DBG("%d, %d", temp_val.val1, temp_val.val2);
     }
-    LOG_DBG("%d, %d", temp_val.val1, temp_val.val2);
   }
 
-  return ((float)temp_val.val1 + ((float)temp_val.val2 / 1000000.0f));
+  K_SPINLOCK(&temp_lock) {
+    if (0 == ret) {
+      const int32_t kMdeg = (temp_val.val1 * 1000) + (temp_val.val2 / 1000);
+      temp_mdeg = kMdeg;
+      average_mdeg =
+          (false == is_valid)
+              ? kMdeg
+              : (average_mdeg +
+                 ((kMdeg - average_mdeg) >> HAL_DIE_TEMPERATURE_AVERAGE_SHIFT));
+      timestamp_ms = k_uptime_get();
+      is_valid = true;
+    }
+    next_ms = period_ms;
+  }
+
+  k_work_schedule(&work_die_temperature, K_MSEC(next_ms));
+}
+
+/**
+ * @brief Gets the latest die temperature
+ *
+ * @return float Temperature in degrees Celsius, or INT32_MIN if no sample is
+ * available
+ */
+float hal_die_temperature_get(void) {
+  float ret = (float)INT32_MIN;
+  K_SPINLOCK(&temp_lock) {
+    if (true == is_valid) {
+      ret = (float)temp_mdeg / 1000.0f;
+    }
+  }
+  return ret;
+}
+
+/**
+ * @brief Gets the moving average of the die temperature
+ *
+ * @return float Temperature in degrees Celsius, or INT32_MIN if no sample is
+ * available
+ */
+float hal_die_temperature_get_average(void) {
+  float ret = (float)INT32_MIN;
+  K_SPINLOCK(&temp_lock) {
+    if (true == is_valid) {
+      ret = (float)average_mdeg / 1000.0f;
+    }
+  }
+  return ret;
+}
+
+/**
+ * @brief Gets the age of the latest sample
+ *
+ * @return int64_t Age in milliseconds, or -1 if no sample is available
+ */
+int64_t hal_die_temperature_get_age(void) {
+  int64_t ret = -1;
+  K_SPINLOCK(&temp_lock) {
+    if (true == is_valid) {
+      ret = k_uptime_get() - timestamp_ms;
+    }
+  }
+  return ret;
 }
@@ -5,18 +5,67 @@
 /**
  * @file die_temperature.h
  * @brief Die temperature sensor interface
- * @details Provides functions for reading the die temperature
+ * @details Provides functions for reading the die temperature. The sensor is
+ * sampled in the background; all getters return cached values.
  */
 #ifndef HAL_DIE_TEMPERATURE_H
 #define HAL_DIE_TEMPERATURE_H
 
+#include <stdint.h>
+
 #include "../../lib/fn.h"
 
 /**
- * @brief Gets the current die temperature
+ * @brief Default sampling period in milliseconds
+ */
+#define HAL_DIE_TEMPERATURE_PERIOD_MS 1000U
+
+/**
+ * @brief Shortest sampling period in milliseconds
+ */
+#define HAL_DIE_TEMPERATURE_PERIOD_MIN_MS 50U
+
+/**
+ * @brief Moving average weight of a new sample (1 / 2^n)
+ */
+#define HAL_DIE_TEMPERATURE_AVERAGE_SHIFT 3U
+
+/**
+ * @brief Initializes the die temperature sensor and starts sampling
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t hal_die_temperature_init(void);
+
+/**
+ * @brief Sets the sampling period
  *
- * @return float Temperature in degrees Celsius
+ * @param kPeriodMs Sampling period in milliseconds
+ * @return fn_t kSuccess if successful, kFailure if the period is too short
+ */
+fn_t hal_die_temperature_set_period(const uint32_t kPeriodMs);
+
+/**
+ * @brief Gets the latest die temperature
+ *
+ * @return float Temperature in degrees Celsius, or INT32_MIN if no sample is
+ * available
  */
 float hal_die_temperature_get(void);
 
+/**
+ * @brief Gets the moving average of the die temperature
+ *
+ * @return float Temperature in degrees Celsius, or INT32_MIN if no sample is
+ * available
+ */
+float hal_die_temperature_get_average(void);
+
+/**
+ * @brief Gets the age of the latest sample
+ *
+ * @return int64_t Age in milliseconds, or -1 if no sample is available
+ */
+int64_t hal_die_temperature_get_age(void);
+
 #endif
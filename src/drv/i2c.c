@@ -0,0 +1,364 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file i2c.c
+ * @brief Implementation of I2C driver
+ * @details Keeps the device handles of all enabled I2C buses and a registry of
+ * named devices. Each bus remembers the speed it is configured for, so
+ * i2c_configure() runs only when consecutive transfers target devices with
+ * different speeds.
+ */
+#include "i2c.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+#include "../lib/fn.h"
+
+LOG_MODULE_REGISTER(drv_i2c, LOG_LEVEL_WRN);
+
+/**
+ * @brief Bus state
+ */
+typedef struct {
+  const struct device *dev; /**< Bus controller */
+  uint32_t default_hz;      /**< clock-frequency from devicetree */
+  struct k_mutex lock;      /**< Serializes speed changes and transfers */
+  int speed;                /**< Configured I2C_SPEED_*, negative if unknown */
+} drv_i2c_bus_t;
+
+/**
+ * @brief Registry entry
+ */
+typedef struct {
+  char name[DRV_I2C_NAME_MAX_LENGTH + 1U]; /**< Name, empty if free */
+  drv_i2c_target_t target;                 /**< Target */
+} drv_i2c_device_t;
+
+/**
+ * @brief Devicetree device descriptor
+ */
+typedef struct {
+  const char *name; /**< label property, or node name */
+  uint8_t bus;      /**< Bus index */
+  uint16_t addr;    /**< reg property */
+} drv_i2c_dt_device_t;
+
+#define DRV_I2C_BUS_ENTRY(node)                              \
+  {                                                          \
+    .dev = DEVICE_DT_GET(node),                              \
+    .default_hz = DT_PROP_OR(node, clock_frequency, 100000), \
+    .speed = -1,                                             \
+  }
+
+#define DRV_I2C_DT_DEVICE(node, bus_idx)                      \
+  {.name = DT_PROP_OR(node, label, DT_NODE_FULL_NAME(node)), \
+   .bus = (bus_idx),                                         \
+   .addr = DT_REG_ADDR(node)},
+
+/** @brief Enabled buses; index 0 is the default bus */
+static drv_i2c_bus_t buses[] = {
+    DRV_I2C_BUS_ENTRY(DT_NODELABEL(i2c0)),
+#if DT_NODE_HAS_STATUS(DT_NODELABEL(i2c1), okay)
+    DRV_I2C_BUS_ENTRY(DT_NODELABEL(i2c1)),
+#endif
+};
+
+/** @brief Devices declared as children of the buses in devicetree */
+static const drv_i2c_dt_device_t kDtDevices[] = {
+    DT_FOREACH_CHILD_STATUS_OKAY_VARGS(DT_NODELABEL(i2c0), DRV_I2C_DT_DEVICE,
+                                       0)
+#if DT_NODE_HAS_STATUS(DT_NODELABEL(i2c1), okay)
+        DT_FOREACH_CHILD_STATUS_OKAY_VARGS(DT_NODELABEL(i2c1),
+                                           DRV_I2C_DT_DEVICE, 1)
+#endif
+            {.name = NULL},
+};
+
+/** @brief Named devices */
+static drv_i2c_device_t devices[DRV_I2C_DEVICE_MAX];
+
+/** @brief Lock protecting the registry */
+static K_MUTEX_DEFINE(mutex_registry);
+
+/**
+ * @brief Initializes the I2C buses and registers the devicetree devices
+ *
+ * @details Every bus starts at the speed of its clock-frequency property
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_i2c_init(void) {
+  fn_t ret = kSuccess;
+
+  for (size_t i = 0; ARRAY_SIZE(buses) > i; i++) {
+    k_mutex_init(&buses[i].lock);
+    if (!device_is_ready(buses[i].dev)) {
+      LOG_ERR("I2C bus %u is not ready", i);
+      ret = kFailure;
+      continue;
+    }
+    const int kSpeed = drv_i2c_speed_from_hz(buses[i].default_hz);
+    if ((0 > kSpeed) ||
+        (0 != i2c_configure(buses[i].dev, I2C_SPEED_SET(kSpeed)))) {
+      LOG_ERR("Failed to configure I2C bus %u", i);
+      ret = kFailure;
+      continue;
+    }
+    buses[i].speed = kSpeed;
+  }
+
+  for (size_t i = 0; NULL != kDtDevices[i].name; i++) {
+    const int kSpeed =
+        drv_i2c_speed_from_hz(buses[kDtDevices[i].bus].default_hz);
+    const drv_i2c_target_t kTarget = {
+        .bus = kDtDevices[i].bus,
+        .speed = (uint8_t)((0 > kSpeed) ? DRV_I2C_SPEED_DEFAULT : kSpeed),
+        .reg_width = 1U,
+        .addr = kDtDevices[i].addr,
+    };
+    if (kSuccess != drv_i2c_device_register(kDtDevices[i].name, &kTarget)) {
+      LOG_WRN("Devicetree I2C device %s not registered", kDtDevices[i].name);
+    }
+  }
+  return ret;
+}
+
+/**
+ * @brief Gets the number of available buses
+ *
+ * @return size_t Number of buses
+ */
+size_t drv_i2c_bus_count(void) { return ARRAY_SIZE(buses); }
+
+/**
+ * @brief Converts a bus frequency to an I2C_SPEED_* value
+ *
+ * @details Rounds down to the fastest standard speed not above kHz
+ *
+ * @param kHz Bus frequency in Hz
+ * @return int I2C_SPEED_* value, or negative if unsupported
+ */
+int drv_i2c_speed_from_hz(const uint32_t kHz) {
+  if (I2C_BITRATE_FAST_PLUS <= kHz) {
+    return I2C_SPEED_FAST_PLUS;
+  } else if (I2C_BITRATE_FAST <= kHz) {
+    return I2C_SPEED_FAST;
+  } else if (I2C_BITRATE_STANDARD <= kHz) {
+    return I2C_SPEED_STANDARD;
+  }
+  return -EINVAL;
+}
+
+/**
+ * @brief Registers a named device or updates an existing one
+ *
+ * @param kName Device name
+ * @param kTarget Bus, address, speed and register width of the device
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_i2c_device_register(const char *const kName,
+                             const drv_i2c_target_t *const kTarget) {
+  const size_t kLength = strlen(kName);
+  drv_i2c_device_t *slot = NULL;
+
+  if ((0U == kLength) || (DRV_I2C_NAME_MAX_LENGTH < kLength) ||
+      (ARRAY_SIZE(buses) <= kTarget->bus) || (0x7FU < kTarget->addr) ||
+      (2U < kTarget->reg_width)) {
+    return kFailure;
+  }
+  if (DRV_I2C_SPEED_MAX < kTarget->speed) {
+    LOG_ERR("%s: speed %u not supported by the controller", kName,
+            kTarget->speed);
+    return kFailure;
+  }
+
+  k_mutex_lock(&mutex_registry, K_FOREVER);
+  for (size_t i = 0; DRV_I2C_DEVICE_MAX > i; i++) {
+    if (0 == strcmp(devices[i].name, kName)) {
+      slot = &devices[i];
+      break;
+    }
+    if ((NULL == slot) && ('\0' == devices[i].name[0])) {
+      slot = &devices[i];
+    }
+  }
+  if (NULL != slot) {
+    memcpy(slot->name, kName, kLength + 1U);
+    slot->target = *kTarget;
+  }
+  k_mutex_unlock(&mutex_registry);
+
+  if (NULL == slot) {
+    LOG_ERR("I2C registry full");
+    return kFailure;
+  }
+  LOG_DBG("%s: bus %u, 0x%02X, speed %u", kName, kTarget->bus, kTarget->addr,
+          kTarget->speed);
+  return kSuccess;
+}
+
+/**
+ * @brief Looks up a named device
+ *
+ * @details Copies the target under the registry lock, since an entry can be
+ * updated by drv_i2c_device_register() at any time
+ *
+ * @param kName Device name
+ * @param kLength Length of the name
+ * @param target Destination of the target
+ * @return fn_t kSuccess if found, kFailure if not registered
+ */
+fn_t drv_i2c_device_find(const char *const kName, const size_t kLength,
+                         drv_i2c_target_t *const target) {
+  fn_t ret = kFailure;
+  if ((0U == kLength) || (DRV_I2C_NAME_MAX_LENGTH < kLength)) {
+    return kFailure;
+  }
+  k_mutex_lock(&mutex_registry, K_FOREVER);
+  for (size_t i = 0; DRV_I2C_DEVICE_MAX > i; i++) {
+    if ((0 == strncmp(devices[i].name, kName, kLength)) &&
+        ('\0' == devices[i].name[kLength])) {
+      *target = devices[i].target;
+      ret = kSuccess;
+      break;
+    }
+  }
+  k_mutex_unlock(&mutex_registry);
+  return ret;
+}
+
+/**
+ * @brief Makes a target for a bare address on the default bus
+ *
+ * @param kAddr 7-bit device address
+ * @return drv_i2c_target_t Target with the default speed and an 8-bit
+ * register address
+ */
+drv_i2c_target_t drv_i2c_target_default(const uint16_t kAddr) {
+  return (drv_i2c_target_t){.bus = 0U,
+                            .speed = DRV_I2C_SPEED_DEFAULT,
+                            .reg_width = 1U,
+                            .addr = kAddr};
+}
+
+/**
+ * @brief Runs a list of messages as one transaction
+ *
+ * @details Reconfigures the bus first if it runs at a different speed
+ *
+ * @param kTarget Target device
+ * @param msgs Messages
+ * @param kNum Number of messages
+ * @return int 0 on success, negative errno otherwise
+ */
+int drv_i2c_transfer(const drv_i2c_target_t *const kTarget,
+                     struct i2c_msg *const msgs, const uint8_t kNum) {
+  if (ARRAY_SIZE(buses) <= kTarget->bus) {
+    return -ENODEV;
+  }
+  drv_i2c_bus_t *const bus = &buses[kTarget->bus];
+  int rc = 0;
+
+  k_mutex_lock(&bus->lock, K_FOREVER);
+  if (bus->speed != kTarget->speed) {
+    rc = i2c_configure(bus->dev, I2C_SPEED_SET(kTarget->speed));
+    bus->speed = (0 == rc) ? kTarget->speed : -1;
+    LOG_DBG("bus %u: speed %u rc:%d", kTarget->bus, kTarget->speed, rc);
+  }
+  if (0 == rc) {
+    rc = i2c_transfer(bus->dev, msgs, kNum, kTarget->addr);
+  }
+  k_mutex_unlock(&bus->lock);
+  return rc;
+}
+
+/**
+ * @brief Encodes a register address (big-endian)
+ *
+ * @param kTarget Target device
+ * @param kReg Register address
+ * @param buf Destination (at least 2 bytes)
+ * @return size_t Number of bytes written
+ */
+static size_t reg_encode(const drv_i2c_target_t *const kTarget,
+                         const uint16_t kReg, uint8_t *const buf) {
+  if (2U == kTarget->reg_width) {
+    buf[0] = (uint8_t)(kReg >> 8);
+    buf[1] = (uint8_t)kReg;
+    return 2U;
+  } else if (1U == kTarget->reg_width) {
+    buf[0] = (uint8_t)kReg;
+    return 1U;
+  }
+  return 0U;
+}
+
+/**
+ * @brief Reads registers of a device
+ *
+ * @param kTarget Target device
+ * @param kReg First register address
+ * @param buf Destination
+ * @param kSize Number of bytes to read
+ * @return int 0 on success, negative errno otherwise
+ */
+int drv_i2c_reg_read(const drv_i2c_target_t *const kTarget,
+                     const uint16_t kReg, uint8_t *const buf,
+                     const size_t kSize) {
+  uint8_t reg[2] = {0U};
+  struct i2c_msg msgs[2];
+  uint8_t num = 0U;
+
+  const size_t kRegSize = reg_encode(kTarget, kReg, reg);
+  if (0U < kRegSize) {
+    msgs[num].buf = reg;
+    msgs[num].len = kRegSize;
+    msgs[num].flags = I2C_MSG_WRITE;
+    num++;
+  }
+  msgs[num].buf = buf;
+  msgs[num].len = kSize;
+  msgs[num].flags = I2C_MSG_READ | I2C_MSG_STOP |
+                    ((0U < num) ? I2C_MSG_RESTART : 0U);
+  num++;
+  return drv_i2c_transfer(kTarget, msgs, num);
+}
+
+/**
+ * @brief Writes registers of a device
+ *
+ * @param kTarget Target device
+ * @param kReg First register address
+ * @param kData Data
+ * @param kSize Number of bytes to write (up to DRV_I2C_DATA_MAX)
+ * @return int 0 on success, negative errno otherwise
+ */
+int drv_i2c_reg_write(const drv_i2c_target_t *const kTarget,
+                      const uint16_t kReg, const uint8_t *const kData,
+                      const size_t kSize) {
+  uint8_t buf[2U + DRV_I2C_DATA_MAX];
+  struct i2c_msg msg;
+
+  if (DRV_I2C_DATA_MAX < kSize) {
+    return -EINVAL;
+  }
+  // One message: the TWIM peripheral cannot chain writes without a buffer
+  const size_t kRegSize = reg_encode(kTarget, kReg, buf);
+  memcpy(&buf[kRegSize], kData, kSize);
+  msg.buf = buf;
+  msg.len = kRegSize + kSize;
+  msg.flags = I2C_MSG_WRITE | I2C_MSG_STOP;
+  return drv_i2c_transfer(kTarget, &msg, 1U);
+}
@@ -0,0 +1,146 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file i2c.h
+ * @brief I2C driver interface
+ * @details Provides a registry of named I2C devices and transfers that switch
+ * the bus speed only when the target device needs a different one
+ */
+#ifndef DRV_I2C_H
+#define DRV_I2C_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/drivers/i2c.h>
+
+#include "../lib/fn.h"
+
+/**
+ * @brief Maximum number of named devices
+ */
+#define DRV_I2C_DEVICE_MAX 8U
+
+/**
+ * @brief Maximum length of a device name in characters (excluding
+ * terminator)
+ */
+#define DRV_I2C_NAME_MAX_LENGTH 15U
+
+/**
+ * @brief Maximum number of data bytes in one register transfer
+ */
+#define DRV_I2C_DATA_MAX 255U
+
+/**
+ * @brief Bus speed of targets given as a bare address
+ */
+#define DRV_I2C_SPEED_DEFAULT I2C_SPEED_FAST
+
+/**
+ * @brief Fastest bus speed of the nRF TWIM (no Fast-mode Plus)
+ */
+#define DRV_I2C_SPEED_MAX I2C_SPEED_FAST
+
+/**
+ * @brief I2C transfer target
+ */
+typedef struct {
+  uint8_t bus;       /**< Bus index */
+  uint8_t speed;     /**< Bus speed (I2C_SPEED_*) */
+  uint8_t reg_width; /**< Register address width in bytes (0 to 2) */
+  uint16_t addr;     /**< 7-bit device address */
+} drv_i2c_target_t;
+
+/**
+ * @brief Initializes the I2C buses and registers the devicetree devices
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_i2c_init(void);
+
+/**
+ * @brief Gets the number of available buses
+ *
+ * @return size_t Number of buses
+ */
+size_t drv_i2c_bus_count(void);
+
+/**
+ * @brief Converts a bus frequency to an I2C_SPEED_* value
+ *
+ * @param kHz Bus frequency in Hz
+ * @return int I2C_SPEED_* value, or negative if unsupported
+ */
+int drv_i2c_speed_from_hz(const uint32_t kHz);
+
+/**
+ * @brief Registers a named device or updates an existing one
+ *
+ * @param kName Device name
+ * @param kTarget Bus, address, speed and register width of the device
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_i2c_device_register(const char *const kName,
+                             const drv_i2c_target_t *const kTarget);
+
+/**
+ * @brief Looks up a named device
+ *
+ * @param kName Device name
+ * @param kLength Length of the name
+ * @param target Destination of the target
+ * @return fn_t kSuccess if found, kFailure if not registered
+ */
+fn_t drv_i2c_device_find(const char *const kName, const size_t kLength,
+                         drv_i2c_target_t *const target);
+
+/**
+ * @brief Makes a target for a bare address on the default bus
+ *
+ * @param kAddr 7-bit device address
+ * @return drv_i2c_target_t Target with the default speed and an 8-bit
+ * register address
+ */
+drv_i2c_target_t drv_i2c_target_default(const uint16_t kAddr);
+
+/**
+ * @brief Runs a list of messages as one transaction
+ *
+ * @param kTarget Target device
+ * @param msgs Messages
+ * @param kNum Number of messages
+ * @return int 0 on success, negative errno otherwise
+ */
+int drv_i2c_transfer(const drv_i2c_target_t *const kTarget,
+                     struct i2c_msg *const msgs, const uint8_t kNum);
+
+/**
+ * @brief Reads registers of a device
+ *
+ * @param kTarget Target device
+ * @param kReg First register address
+ * @param buf Destination
+ * @param kSize Number of bytes to read
+ * @return int 0 on success, negative errno otherwise
+ */
+int drv_i2c_reg_read(const drv_i2c_target_t *const kTarget,
+                     const uint16_t kReg, uint8_t *const buf,
+                     const size_t kSize);
+
+/**
+ * @brief Writes registers of a device
+ *
+ * @param kTarget Target device
+ * @param kReg First register address
+ * @param kData Data
+ * @param kSize Number of bytes to write (up to DRV_I2C_DATA_MAX)
+ * @return int 0 on success, negative errno otherwise
+ */
+int drv_i2c_reg_write(const drv_i2c_target_t *const kTarget,
+                      const uint16_t kReg, const uint8_t *const kData,
+                      const size_t kSize);
+
+#endif
@@ -5,44 +5,331 @@
 /**
  * @file pwm.c
  * @brief Implementation of PWM driver
- * @details Implements functions for PWM control
+ * @details Implements functions for PWM control. PWM.set uses the Zephyr
+ * driver on pwm1; the sequence player drives PWM2 directly through nrfx so
+ * that EasyDMA can play a duty cycle table without interrupts.
  */
 #include "pwm.h"
 
+#include <hal/nrf_gpio.h>
+#include <nrfx_pwm.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include <zephyr/device.h>
 #include <zephyr/drivers/pwm.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 
 #include "../lib/fn.h"
+#include "gpio.h"
 
 LOG_MODULE_REGISTER(drv_pwm, LOG_LEVEL_DBG);
 
+/**
+ * @brief Largest COUNTERTOP value of the nRF PWM
+ */
+#define DRV_PWM_COUNTERTOP_MAX 32767U
+
+/**
+ * @brief Polarity bit of a sequence value (set: high for the compare count)
+ */
+#define DRV_PWM_SEQ_POLARITY 0x8000U
+
 static const struct device *pwm1_dev = DEVICE_DT_GET(DT_NODELABEL(pwm1));
 
+/** @brief PWM2 instance driven by the sequence player */
+static const nrfx_pwm_t seq_pwm = NRFX_PWM_INSTANCE(2);
+
+/** @brief EasyDMA sequence buffer (must stay in RAM while playing) */
+static nrf_pwm_values_individual_t seq_values[DRV_PWM_SEQ_MAX_STEPS];
+
+/** @brief true while seq_pwm is initialized */
+static bool seq_initialized = false;
+
+/** @brief Pins of the sequence, claimed from the GPIO driver while it plays */
+static uint8_t seq_pins[DRV_PWM_SEQ_CHANNELS];
+
+/** @brief Number of entries of seq_pins claimed */
+static size_t seq_num_pins = 0U;
+
+/** @brief Frequency of the cached period, 0 if none */
+static uint32_t period_cache_hz = 0U;
+
+/** @brief Cached period in DRV_PWM_CLOCK_HZ cycles */
+static uint32_t period_cache_cycles = 0U;
+
+/**
+ * @brief Converts a frequency to a period in DRV_PWM_CLOCK_HZ cycles
+ *
+ * @details The division is done only when the frequency changes; PWM.set is
+ * typically called repeatedly with the same frequency and a new duty cycle
+ *
+ * @param kHz Frequency in Hz
+ * @param cycles Period in cycles
+ * @return fn_t kSuccess if successful, kFailure if out of range
+ */
+static fn_t pwm_period_cycles(const uint32_t kHz, uint32_t *const cycles) {
+  if ((DRV_PWM_HZ_MIN > kHz) || (DRV_PWM_HZ_MAX < kHz)) {
+    LOG_ERR("PWM frequency %u Hz out of range", kHz);
+    return kFailure;
+  }
+  if (period_cache_hz != kHz) {
+    period_cache_cycles = DRV_PWM_CLOCK_HZ / kHz;
+    period_cache_hz = kHz;
+  }
+  *cycles = period_cache_cycles;
+  return kSuccess;
+}
+
+/**
+ * @brief Selects the PWM base clock and counter top for a period
+ *
+ * @details Uses the fastest clock whose counter top fits in COUNTERTOP, which
+ * gives the finest duty resolution. The Zephyr nRF PWM driver applies the
+ * same rule, so this also tells the resolution PWM.set gets.
+ *
+ * @param kCycles Period in DRV_PWM_CLOCK_HZ cycles
+ * @param clock Selected base clock
+ * @param top Selected counter top
+ * @return fn_t kSuccess if successful, kFailure if out of range
+ */
+static fn_t pwm_clock_select(const uint32_t kCycles,
+                             nrf_pwm_clk_t *const clock,
+                             uint16_t *const top) {
+  for (uint32_t prescaler = 0U; NRF_PWM_CLK_125kHz >= prescaler;
+       prescaler++) {
+    const uint32_t kTop = kCycles >> prescaler;
+    if (DRV_PWM_COUNTERTOP_MAX >= kTop) {
+      if (DRV_PWM_COUNTERTOP_MIN > kTop) {
+        return kFailure;
+      }
+      *clock = (nrf_pwm_clk_t)prescaler;
+      *top = (uint16_t)kTop;
+      return kSuccess;
+    }
+  }
+  return kFailure;
+}
+
+/**
+ * @brief Drives pwm1 channel 0 with a period and pulse in clock cycles
+ *
+ * @param kPeriod Period in DRV_PWM_CLOCK_HZ cycles
+ * @param kPulse Pulse width in DRV_PWM_CLOCK_HZ cycles
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+static fn_t pwm_output_set(const uint32_t kPeriod, const uint32_t kPulse) {
+  nrf_pwm_clk_t clock;
+  uint16_t top;
+
+  if ((kPulse > kPeriod) ||
+      (kSuccess != pwm_clock_select(kPeriod, &clock, &top))) {
+    return kFailure;
+  }
+  if (false == device_is_ready(pwm1_dev)) {
+    return kFailure;
+  }
+  // The nRF PWM driver counts in 16 MHz cycles before prescaling
+  const int kErr =
+      pwm_set_cycles(pwm1_dev, 0U, kPeriod, kPulse, PWM_POLARITY_NORMAL);
+  if (0 != kErr) {
+    LOG_ERR("pwm_set_cycles() failed with err %d", kErr);
+    return kFailure;
+  }
+  return kSuccess;
+}
+
 /**
  * @brief Sets the PWM frequency and duty cycle
  *
- * @param kHz Frequency in kHz
+ * @param kHz Frequency in Hz
  * @param kDuty Duty cycle (0-100)
  * @return fn_t kSuccess if successful, kFailure otherwise
  */
 fn_t drv_pwm_set(const uint32_t kHz, const uint8_t kDuty) {
-  int err;
-  if (100 < kDuty) {
-    LOG_ERR("duty must be less than 100\n");
+  if (100U < kDuty) {
+    LOG_ERR("duty must be less than 100");
     return kFailure;
   }
-  uint32_t kPeriod = (1000U * 1000U * 1000U) / (uint32_t)kHz;
-  uint32_t kPulse = (kPeriod * kDuty) / 100U;
-  if (true == device_is_ready(pwm1_dev)) {
-    err = pwm_set(pwm1_dev, 0U, kPeriod, kPulse, PWM_POLARITY_NORMAL);
-    if (0 == err) {
-      return kSuccess;
-    } else {
-      LOG_ERR("pwm_set() failed with err %d\n", err);
+  return drv_pwm_set_permille(kHz, (uint16_t)kDuty * 10U);
+}
+
+/**
+ * @brief Sets the PWM frequency and duty cycle in permille
+ *
+ * @param kHz Frequency in Hz (DRV_PWM_HZ_MIN to DRV_PWM_HZ_MAX)
+ * @param kPermille Duty cycle (0-1000)
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_pwm_set_permille(const uint32_t kHz, const uint16_t kPermille) {
+  uint32_t period;
+  if ((1000U < kPermille) || (kSuccess != pwm_period_cycles(kHz, &period))) {
+    return kFailure;
+  }
+  return pwm_output_set(period, (uint32_t)(((uint64_t)period * kPermille) /
+                                           1000U));
+}
+
+/**
+ * @brief Sets the PWM period and pulse width in nanoseconds
+ *
+ * @details Both are rounded down to DRV_PWM_CLOCK_HZ cycles
+ *
+ * @param kPeriodNs Period in nanoseconds
+ * @param kPulseNs Pulse width in nanoseconds (up to kPeriodNs)
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_pwm_set_ns(const uint32_t kPeriodNs, const uint32_t kPulseNs) {
+  const uint64_t kNsPerSec = 1000U * 1000U * 1000U;
+  const uint32_t kPeriod =
+      (uint32_t)(((uint64_t)kPeriodNs * DRV_PWM_CLOCK_HZ) / kNsPerSec);
+  const uint32_t kPulse =
+      (uint32_t)(((uint64_t)kPulseNs * DRV_PWM_CLOCK_HZ) / kNsPerSec);
+  if (kPulseNs > kPeriodNs) {
+    return kFailure;
+  }
+  return pwm_output_set(kPeriod, kPulse);
+}
+
+/**
+ * @brief Checks whether a pin is claimed by the playing sequence
+ *
+ * @param kPin Pin number (port * 32 + pin)
+ * @return true if claimed
+ */
+static bool seq_pin_claimed(const uint8_t kPin) {
+  for (size_t i = 0; seq_num_pins > i; i++) {
+    if (kPin == seq_pins[i]) {
+      return true;
     }
   }
-  return kFailure;
+  return false;
+}
+
+/**
+ * @brief Gives the pins of the sequence back to the GPIO driver
+ */
+static void seq_pins_unclaim(void) {
+  for (size_t i = 0; seq_num_pins > i; i++) {
+    drv_gpio_pin_unclaim(seq_pins[i]);
+  }
+  seq_num_pins = 0U;
+}
+
+/**
+ * @brief Plays a duty cycle sequence on the PWM2 peripheral
+ *
+ * @details The table is copied into the EasyDMA buffer; playback then runs
+ * without CPU involvement. A running sequence is stopped first.
+ *
+ * @param kSeq Sequence definition
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_pwm_seq_play(const drv_pwm_seq_t *const kSeq) {
+  nrf_pwm_clk_t clock;
+  uint16_t top;
+  uint32_t period;
+
+  if ((0U == kSeq->num_pins) || (DRV_PWM_SEQ_CHANNELS < kSeq->num_pins) ||
+      (0U == kSeq->num_steps) || (DRV_PWM_SEQ_MAX_STEPS < kSeq->num_steps) ||
+      (0U == kSeq->step_periods) ||
+      ((PWM_REFRESH_CNT_Msk >> PWM_REFRESH_CNT_Pos) + 1U <
+       kSeq->step_periods) ||
+      (kSuccess != pwm_period_cycles(kSeq->hz, &period)) ||
+      (kSuccess != pwm_clock_select(period, &clock, &top))) {
+    return kFailure;
+  }
+  for (size_t i = 0; kSeq->num_pins > i; i++) {
+    if ((DRV_PWM_SEQ_RESERVED_PIN == kSeq->pins[i]) ||
+        (false == nrf_gpio_pin_present_check(kSeq->pins[i])) ||
+        ((false == drv_gpio_pin_available(kSeq->pins[i])) &&
+         (false == seq_pin_claimed(kSeq->pins[i])))) {
+      LOG_ERR("PWM sequence pin %u not available", kSeq->pins[i]);
+      return kFailure;
+    }
+  }
+  (void)drv_pwm_seq_stop();
+  for (size_t i = 0; kSeq->num_pins > i; i++) {
+    // A pin given twice is claimed once
+    if (kSuccess == drv_gpio_pin_claim(kSeq->pins[i])) {
+      seq_pins[seq_num_pins++] = kSeq->pins[i];
+    }
+  }
+
+  // Unused channels stay at 0% on a disconnected output
+  memset(seq_values, 0, sizeof(seq_values));
+  for (size_t step = 0; kSeq->num_steps > step; step++) {
+    uint16_t *const channel = (uint16_t *)&seq_values[step];
+    for (size_t ch = 0; kSeq->num_pins > ch; ch++) {
+      const uint32_t kPermille =
+          MIN(kSeq->duty[(step * kSeq->num_pins) + ch], 1000U);
+      channel[ch] =
+          (uint16_t)((top * kPermille) / 1000U) | DRV_PWM_SEQ_POLARITY;
+    }
+  }
+
+  nrfx_pwm_config_t config = NRFX_PWM_DEFAULT_CONFIG(
+      NRF_PWM_PIN_NOT_CONNECTED, NRF_PWM_PIN_NOT_CONNECTED,
+      NRF_PWM_PIN_NOT_CONNECTED, NRF_PWM_PIN_NOT_CONNECTED);
+  for (size_t i = 0; kSeq->num_pins > i; i++) {
+    config.output_pins[i] = kSeq->pins[i];
+    // Keep the GPIO configuration when the player releases the pin; only
+    // make sure it is an output
+    nrf_gpio_cfg_output(kSeq->pins[i]);
+  }
+  config.base_clock = clock;
+  config.count_mode = NRF_PWM_MODE_UP;
+  config.top_value = top;
+  config.load_mode = NRF_PWM_LOAD_INDIVIDUAL;
+  config.step_mode = NRF_PWM_STEP_AUTO;
+  config.skip_gpio_cfg = true;
+
+  // No handler: no interrupts, completion is polled in drv_pwm_seq_is_running
+  if (NRFX_SUCCESS != nrfx_pwm_init(&seq_pwm, &config, NULL, NULL)) {
+    LOG_ERR("nrfx_pwm_init() failed");
+    seq_pins_unclaim();
+    return kFailure;
+  }
+  seq_initialized = true;
+
+  const nrf_pwm_sequence_t kSequence = {
+      .values.p_individual = seq_values,
+      .length = (uint16_t)(kSeq->num_steps * DRV_PWM_SEQ_CHANNELS),
+      .repeats = kSeq->step_periods - 1U,
+      .end_delay = 0U,
+  };
+  (void)nrfx_pwm_simple_playback(
+      &seq_pwm, &kSequence, (0U == kSeq->loops) ? 1U : kSeq->loops,
+      (0U == kSeq->loops) ? NRFX_PWM_FLAG_LOOP : NRFX_PWM_FLAG_STOP);
+  LOG_DBG("PWM sequence: %u steps, %u pins, top %u, clock %u",
+          kSeq->num_steps, kSeq->num_pins, top, clock);
+  return kSuccess;
+}
+
+/**
+ * @brief Stops the sequence player and releases its pins
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_pwm_seq_stop(void) {
+  if (false == seq_initialized) {
+    return kSuccess;
+  }
+  (void)nrfx_pwm_stop(&seq_pwm, true);
+  nrfx_pwm_uninit(&seq_pwm);
+  seq_initialized = false;
+  seq_pins_unclaim();
+  return kSuccess;
+}
+
+/**
+ * @brief Checks whether a sequence is playing
+ *
+ * @return true if playing
+ * @return false otherwise
+ */
+bool drv_pwm_seq_is_running(void) {
+  return (true == seq_initialized) && (false == nrfx_pwm_is_stopped(&seq_pwm));
 }
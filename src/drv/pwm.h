@@ -10,17 +10,114 @@
 #ifndef DRV_PWM_H
 #define DRV_PWM_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "../lib/fn.h"
 
+/**
+ * @brief PWM clock before prescaling
+ */
+#define DRV_PWM_CLOCK_HZ 16000000U
+
+/**
+ * @brief Smallest counter top accepted (duty resolution of 1%)
+ */
+#define DRV_PWM_COUNTERTOP_MIN 100U
+
+/**
+ * @brief Highest PWM frequency (counter top of DRV_PWM_COUNTERTOP_MIN)
+ */
+#define DRV_PWM_HZ_MAX (DRV_PWM_CLOCK_HZ / DRV_PWM_COUNTERTOP_MIN)
+
+/**
+ * @brief Lowest PWM frequency (125 kHz clock, 15-bit counter top)
+ */
+#define DRV_PWM_HZ_MIN 4U
+
+/**
+ * @brief Number of outputs of the sequence player
+ */
+#define DRV_PWM_SEQ_CHANNELS 4U
+
+/**
+ * @brief Maximum number of steps of a sequence
+ */
+#define DRV_PWM_SEQ_MAX_STEPS 256U
+
+/**
+ * @brief Pin driven by PWM.set (pwm1 OUT0 in app.overlay), not available to
+ * the sequence player
+ */
+#define DRV_PWM_SEQ_RESERVED_PIN 16U
+
+/**
+ * @brief Sequence definition
+ */
+typedef struct {
+  uint8_t pins[DRV_PWM_SEQ_CHANNELS]; /**< Pins (port * 32 + pin) */
+  size_t num_pins;                    /**< Number of pins used */
+  uint32_t hz;                        /**< PWM frequency */
+  const uint16_t *duty;               /**< Permille per step, interleaved */
+  size_t num_steps;                   /**< Number of steps */
+  uint32_t step_periods;              /**< PWM periods per step */
+  uint16_t loops;                     /**< Playbacks, 0 = forever */
+} drv_pwm_seq_t;
+
 /**
  * @brief Sets the PWM frequency and duty cycle
  *
- * @param kHz Frequency in kHz
+ * @param kHz Frequency in Hz
  * @param kDuty Duty cycle (0-100)
  * @return fn_t kSuccess if successful, kFailure otherwise
  */
 fn_t drv_pwm_set(const uint32_t kHz, const uint8_t kDuty);
 
+/**
+ * @brief Sets the PWM frequency and duty cycle in permille
+ *
+ * @param kHz Frequency in Hz (DRV_PWM_HZ_MIN to DRV_PWM_HZ_MAX)
+ * @param kPermille Duty cycle (0-1000)
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_pwm_set_permille(const uint32_t kHz, const uint16_t kPermille);
+
+/**
+ * @brief Sets the PWM period and pulse width in nanoseconds
+ *
+ * @details Both are rounded down to DRV_PWM_CLOCK_HZ cycles
+ *
+ * @param kPeriodNs Period in nanoseconds
+ * @param kPulseNs Pulse width in nanoseconds (up to kPeriodNs)
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_pwm_set_ns(const uint32_t kPeriodNs, const uint32_t kPulseNs);
+
+/**
+ * @brief Plays a duty cycle sequence on the PWM2 peripheral
+ *
+ * @details The table is copied into the EasyDMA buffer; playback then runs
+ * without CPU involvement. A running sequence is stopped first.
+ *
+ * @param kSeq Sequence definition
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_pwm_seq_play(const drv_pwm_seq_t *const kSeq);
+
+/**
+ * @brief Stops the sequence player and releases its pins
+ *
+ * @return fn_t kSuccess if successful, kFailure otherwise
+ */
+fn_t drv_pwm_seq_stop(void);
+
+/**
+ * @brief Checks whether a sequence is playing
+ *
+ * @return true if playing
+ * @return false otherwise
+ */
+bool drv_pwm_seq_is_running(void);
+
 #endif
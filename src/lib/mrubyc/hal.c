@@ -5,12 +5,14 @@
  */
 #include "hal.h"
 
+#include <stdbool.h>
 #include <stdlib.h>
 #include <zephyr/irq.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 
 #include "../../../mrubyc/src/mrubyc.h"
+#include "../../app/profiler.h"
 #include "../../drv/ble.h"
 
 LOG_MODULE_REGISTER(lib_mrubyc_hal, LOG_LEVEL_DBG);
@@ -18,6 +20,12 @@ LOG_MODULE_REGISTER(lib_mrubyc_hal, LOG_LEVEL_DBG);
 /** @brief Maximum buffer size for hal_write operations */
 #define HAL_WRITE_BUFFER_SIZE 255
 
+/** @brief Function called before the CPU idles, NULL if none */
+static void (*hal_idle_hook)(void) = NULL;
+
+/** @brief true while hal_write() drops the output */
+static bool hal_write_muted = false;
+
 #if !defined(MRBC_NO_TIMER)
 /* ===== use timer ===== */
 /** @brief Storage for IRQ lock key when interrupts are disabled */
@@ -26,9 +34,11 @@ static unsigned int hal_irq_lock_key;
 /**
  * @brief Enable interrupts
  *
- * @details Unlocks interrupts and the scheduler
+ * @details Unlocks interrupts and the scheduler; the profiler sees the task
+ * states the scheduler left
  */
 void hal_enable_irq(void) {
+  profiler_sched_unlock();
   irq_unlock(hal_irq_lock_key);
   k_sched_unlock();
 }
@@ -41,6 +51,7 @@ void hal_enable_irq(void) {
 void hal_disable_irq(void) {
   k_sched_lock();
   hal_irq_lock_key = irq_lock();
+  profiler_sched_lock();
 }
 
 /**
@@ -84,6 +95,36 @@ K_THREAD_DEFINE(mrubyc_halthread, 384, mrubyc_halmain, NULL, NULL, NULL, -2,
                 K_ESSENTIAL, 0);
 #endif
 
+/**
+ * @brief Idle the CPU for one tick unit
+ *
+ * @details Called by the scheduler in the VM thread when no task is ready;
+ * the hook runs first
+ */
+void hal_idle_cpu(void) {
+  if (NULL != hal_idle_hook) {
+    hal_idle_hook();
+  }
+  k_msleep(MRBC_TICK_UNIT);
+  profiler_idle();
+}
+
+/**
+ * @brief Set the function called before the CPU idles
+ *
+ * @param hook Function, or NULL
+ */
+void hal_set_idle_hook(void (*hook)(void)) { hal_idle_hook = hook; }
+
+/**
+ * @brief Drop the output of hal_write()
+ *
+ * @details For the VM thread, around allocations that are expected to fail
+ *
+ * @param kMute true to drop, false to send again
+ */
+void hal_mute_write(const bool kMute) { hal_write_muted = kMute; }
+
 /**
  * @brief Write data to a file descriptor
  *
@@ -99,6 +140,9 @@ int hal_write(int fd, const void *buf, int nbytes) {
   if (HAL_WRITE_BUFFER_SIZE < nbytes) {
     return -1;
   }
+  if (true == hal_write_muted) {
+    return nbytes;
+  }
   for (int i = 0; i < nbytes; i++) {
     buffer[i] = ((char *)buf)[i];
   }
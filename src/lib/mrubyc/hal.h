@@ -20,6 +20,7 @@
 #ifndef MRBC_SRC_HAL_H_
 #define MRBC_SRC_HAL_H_
 
+#include <stdbool.h>
 #include <zephyr/kernel.h>
 
 /** @brief Time unit for mruby/c VM tick in milliseconds */
@@ -40,8 +41,6 @@ void hal_enable_irq(void);
  * @brief Disable interrupts
  */
 void hal_disable_irq(void);
-/** @brief Idle the CPU for one tick unit */
-#define hal_idle_cpu() ((k_msleep(MRBC_TICK_UNIT)))  // delay 1ms
 
 #else
 
@@ -52,11 +51,26 @@ void hal_disable_irq(void);
 #define hal_enable_irq() (k_sched_unlock())
 /** @brief Disable interrupts by locking the scheduler */
 #define hal_disable_irq() (k_sched_lock())
-/** @brief Idle the CPU for one tick unit */
-#define hal_idle_cpu() ((k_msleep(MRBC_TICK_UNIT)))  // delay 1ms
 
 #endif
 
+/**
+ * @brief Idle the CPU for one tick unit
+ */
+void hal_idle_cpu(void);
+/**
+ * @brief Set the function called before the CPU idles
+ *
+ * @param hook Function, or NULL
+ */
+void hal_set_idle_hook(void (*hook)(void));
+/**
+ * @brief Drop the output of hal_write()
+ *
+ * @param kMute true to drop, false to send again
+ */
+void hal_mute_write(const bool kMute);
+
 /**
  * @brief Write data to a file descriptor
  *
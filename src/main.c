@@ -32,6 +32,8 @@ static void debug_lib_hmac(void);
  */
 int main(void) {
   debug_lib_hmac();
+  watchdog_thread_hearbeat(kAppWatchDogThreadMain);
+  (void)init_wait(INIT_STAGE_BIT(kInitStageGpio));
   while (1) {
     watchdog_thread_hearbeat(kAppWatchDogThreadMain);
     judge_factory_reset();
@@ -48,27 +50,29 @@ int main(void) {
  *          - 3-5 seconds: LED2 blinks to indicate pending factory reset
  *          - >5 seconds: Factory reset is performed, LED2 stays on for 1
  * second
+ * The blinking runs from a timer, so LED2 is touched here only when the
+ * state changes.
  */
 static void judge_factory_reset(void) {
+  static const drv_gpio_pattern_t kPending = {
+      .on_ms = 100U, .off_ms = 100U, .pause_ms = 0U, .count = 1U, .repeat = 0U};
   static bool factory_reset_flag = false;
   static uint16_t duration = 0;
   if ((true == drv_gpio_get(kDrvGpioSW1)) &&
       (true == drv_gpio_get(kDrvGpioSW4))) {
     duration += 1;
   } else {
+    if (30 <= duration) {
+      drv_gpio_set(kDrvGpioLED2, false);
+    }
     duration = 0;
-    drv_gpio_set(kDrvGpioLED2, false);
     if (true == factory_reset_flag) {
       drv_gpio_set(kDrvGpioLED2, false);
       init_reboot();
     }
   }
-  if ((30 <= duration) && (50 > duration)) {
-    if (0 == (duration % 2)) {
-      drv_gpio_set(kDrvGpioLED2, true);
-    } else {
-      drv_gpio_set(kDrvGpioLED2, false);
-    }
+  if (30 == duration) {
+    (void)drv_gpio_pattern_start(kDrvGpioLED2, &kPending);
   } else if (50 <= duration) {
     if (false == factory_reset_flag) {
       factory_reset_flag = true;
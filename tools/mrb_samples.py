@@ -0,0 +1,423 @@
+#!/usr/bin/env python3
+#
+# SPDX-License-Identifier: BSD-3-Clause
+# SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+#
+"""Maps the histogram of the bytecode sampler to methods and lines.
+
+The firmware (CONFIG_OPENBLINK_SAMPLER=y) prints the histogram as
+
+    smp begin <period_us> <samples> <other> <dropped>
+    smp <slot> <offset> <count>
+    ...
+    smp end
+
+where offset is the program counter of the slot task in its bytecode. This
+tool reads the bytecode of the slots (.mrb files as written by mrbc, or C
+sources as written by mrbc -B such as src/rb/slot1.h), finds the IREP and the
+instruction of each offset, names the IREP from the instructions that define
+it and looks up the line in the debug info (mrbc -g).
+
+    python3 tools/mrb_samples.py --slot1 slot1.mrb --slot2 slot2.mrb log.txt
+"""
+
+import argparse
+import re
+import struct
+import sys
+from collections import defaultdict
+
+# mruby 3 opcodes (RITE0300) and their operands: B byte, S 16 bits, W 24 bits
+OPCODES = [
+    ("NOP", "Z"), ("MOVE", "BB"), ("LOADL", "BB"), ("LOADI", "BB"),
+    ("LOADINEG", "BB"), ("LOADI__1", "B"), ("LOADI_0", "B"),
+    ("LOADI_1", "B"), ("LOADI_2", "B"), ("LOADI_3", "B"), ("LOADI_4", "B"),
+    ("LOADI_5", "B"), ("LOADI_6", "B"), ("LOADI_7", "B"),
+    ("LOADI16", "BS"), ("LOADI32", "BSS"), ("LOADSYM", "BB"),
+    ("LOADNIL", "B"), ("LOADSELF", "B"), ("LOADT", "B"), ("LOADF", "B"),
+    ("GETGV", "BB"), ("SETGV", "BB"), ("GETSV", "BB"), ("SETSV", "BB"),
+    ("GETIV", "BB"), ("SETIV", "BB"), ("GETCV", "BB"), ("SETCV", "BB"),
+    ("GETCONST", "BB"), ("SETCONST", "BB"), ("GETMCNST", "BB"),
+    ("SETMCNST", "BB"), ("GETUPVAR", "BBB"), ("SETUPVAR", "BBB"),
+    ("GETIDX", "B"), ("SETIDX", "B"), ("JMP", "S"), ("JMPIF", "BS"),
+    ("JMPNOT", "BS"), ("JMPNIL", "BS"), ("JMPUW", "S"), ("EXCEPT", "B"),
+    ("RESCUE", "BB"), ("RAISEIF", "B"), ("SSEND", "BBB"),
+    ("SSENDB", "BBB"), ("SEND", "BBB"), ("SENDB", "BBB"), ("CALL", "Z"),
+    ("SUPER", "BB"), ("ARGARY", "BS"), ("ENTER", "W"), ("KEY_P", "BB"),
+    ("KEYEND", "Z"), ("KARG", "BB"), ("RETURN", "B"), ("RETURN_BLK", "B"),
+    ("BREAK", "B"), ("BLKPUSH", "BS"), ("ADD", "B"), ("ADDI", "BB"),
+    ("SUB", "B"), ("SUBI", "BB"), ("MUL", "B"), ("DIV", "B"), ("EQ", "B"),
+    ("LT", "B"), ("LE", "B"), ("GT", "B"), ("GE", "B"), ("ARRAY", "BB"),
+    ("ARRAY2", "BBB"), ("ARYCAT", "B"), ("ARYPUSH", "BB"), ("ARYDUP", "B"),
+    ("AREF", "BBB"), ("ASET", "BBB"), ("APOST", "BBB"), ("INTERN", "B"),
+    ("SYMBOL", "BB"), ("STRING", "BB"), ("STRCAT", "B"), ("HASH", "BB"),
+    ("HASHADD", "BB"), ("HASHCAT", "B"), ("LAMBDA", "BB"), ("BLOCK", "BB"),
+    ("METHOD", "BB"), ("RANGE_INC", "B"), ("RANGE_EXC", "B"),
+    ("OCLASS", "B"), ("CLASS", "BB"), ("MODULE", "BB"), ("EXEC", "BB"),
+    ("DEF", "BB"), ("ALIAS", "BB"), ("UNDEF", "B"), ("SCLASS", "B"),
+    ("TCLASS", "B"), ("DEBUG", "BBB"), ("ERR", "B"), ("EXT1", "Z"),
+    ("EXT2", "Z"), ("EXT3", "Z"), ("STOP", "Z"),
+]
+assert 0x69 == len(OPCODES) - 1  # STOP
+
+OPERAND_SIZES = {"B": 1, "S": 2, "W": 3}
+EXT_WIDE = {"EXT1": (True, False), "EXT2": (False, True),
+            "EXT3": (True, True)}
+
+# Pool entry types and their sizes after the type byte
+POOL_STR, POOL_INT32, POOL_SSTR, POOL_INT64, POOL_FLOAT, POOL_BIGINT = (
+    0, 1, 2, 3, 5, 7)
+
+NULL_SYM_LEN = 0xFFFF
+
+
+class Irep:
+    """One IREP of a bytecode file."""
+
+    def __init__(self, index):
+        self.index = index
+        self.iseq_start = 0
+        self.iseq_end = 0
+        self.syms = []
+        self.children = []
+        self.name = None
+        self.context = "Object"
+        self.files = []  # (start_pos, filename, [(pos, line), ...])
+
+    def line(self, pc):
+        """Gets (filename, line) of a pc relative to the ISEQ."""
+        entry = None
+        for file in self.files:
+            if file[0] <= pc:
+                entry = file
+        if entry is None:
+            return None
+        line = None
+        for pos, value in entry[2]:
+            if pc < pos:
+                break
+            line = value
+        return (entry[1], line)
+
+
+class Reader:
+    """Big endian reader over a bytecode image."""
+
+    def __init__(self, data, pos=0):
+        self.data = data
+        self.pos = pos
+
+    def u8(self):
+        value = self.data[self.pos]
+        self.pos += 1
+        return value
+
+    def u16(self):
+        (value,) = struct.unpack_from(">H", self.data, self.pos)
+        self.pos += 2
+        return value
+
+    def u32(self):
+        (value,) = struct.unpack_from(">I", self.data, self.pos)
+        self.pos += 4
+        return value
+
+    def skip(self, size):
+        self.pos += size
+
+    def bytes(self, size):
+        value = self.data[self.pos:self.pos + size]
+        self.pos += size
+        return value
+
+
+def packed_int(reader):
+    """Decodes an unsigned LEB128 value of a packed line map."""
+    value = 0
+    shift = 0
+    while True:
+        byte = reader.u8()
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if (0 == (byte & 0x80)) or (32 <= shift):
+            return value
+
+
+class Bytecode:
+    """IREP tree and debug info of a .mrb image."""
+
+    def __init__(self, data):
+        if (22 > len(data)) or (b"RITE" != data[0:4]):
+            raise ValueError("not an mruby bytecode file")
+        if b"0300" != data[4:8]:
+            raise ValueError("unsupported bytecode version %s"
+                             % data[4:8].decode(errors="replace"))
+        self.data = data
+        self.ireps = []
+        self.root = None
+        pos = 20
+        while pos + 8 <= len(data):
+            ident = data[pos:pos + 4]
+            (size,) = struct.unpack_from(">I", data, pos + 4)
+            if b"IREP" == ident:
+                self.root = self._read_irep(Reader(data, pos + 12))
+            elif b"DBG\0" == ident:
+                self._read_debug(Reader(data, pos + 8))
+            elif b"END\0" == ident:
+                break
+            if 8 > size:
+                break
+            pos += size
+        if self.root is None:
+            raise ValueError("no IREP section")
+        self.root.name = "<main>"
+        self._name(self.root)
+
+    def _read_irep(self, reader):
+        irep = Irep(len(self.ireps))
+        self.ireps.append(irep)
+        reader.skip(4)  # Record size
+        reader.skip(4)  # nlocals, nregs
+        rlen = reader.u16()
+        clen = reader.u16()
+        ilen = reader.u32()
+        irep.iseq_start = reader.pos
+        irep.iseq_end = reader.pos + ilen
+        reader.skip(ilen + (13 * clen))
+        for _ in range(reader.u16()):
+            kind = reader.u8()
+            if kind in (POOL_STR, POOL_SSTR):
+                reader.skip(reader.u16() + 1)
+            elif POOL_INT32 == kind:
+                reader.skip(4)
+            elif kind in (POOL_INT64, POOL_FLOAT):
+                reader.skip(8)
+            elif POOL_BIGINT == kind:
+                reader.skip(reader.u8() + 1)
+            else:
+                raise ValueError("unknown pool type %d" % kind)
+        for _ in range(reader.u16()):
+            length = reader.u16()
+            if NULL_SYM_LEN == length:
+                irep.syms.append(None)
+                continue
+            irep.syms.append(reader.bytes(length).decode(errors="replace"))
+            reader.skip(1)
+        for _ in range(rlen):
+            irep.children.append(self._read_irep(reader))
+        return irep
+
+    def _read_debug(self, reader):
+        filenames = []
+        for _ in range(reader.u16()):
+            filenames.append(reader.bytes(reader.u16()).decode(
+                errors="replace"))
+        for irep in self.ireps:
+            reader.skip(4)  # Record size
+            for _ in range(reader.u16()):
+                start_pos = reader.u32()
+                filename = filenames[reader.u16()]
+                count = reader.u32()
+                kind = reader.u8()
+                lines = []
+                if 0 == kind:  # Array, one line per instruction byte
+                    for i in range(count):
+                        lines.append((start_pos + i, reader.u16()))
+                elif 1 == kind:  # Flat map
+                    for _ in range(count):
+                        pos = reader.u32()
+                        lines.append((pos, reader.u16()))
+                elif 2 == kind:  # Packed map, count is the size in bytes
+                    end = reader.pos + count
+                    pos = 0
+                    line = 0
+                    while reader.pos < end:
+                        pos += packed_int(reader)
+                        line = (line + packed_int(reader)) & 0xFFFFFFFF
+                        lines.append((pos, line))
+                else:
+                    raise ValueError("unknown line type %d" % kind)
+                irep.files.append((start_pos, filename, lines))
+
+    def instructions(self, irep):
+        """Yields (pc, name, operands) of the instructions of an IREP."""
+        pc = irep.iseq_start
+        wide = (False, False)
+        while pc < irep.iseq_end:
+            start = pc
+            code = self.data[pc]
+            pc += 1
+            if len(OPCODES) <= code:
+                return
+            name, operands = OPCODES[code]
+            values = []
+            for i, kind in enumerate(operands.strip("Z")):
+                size = OPERAND_SIZES[kind]
+                if ("B" == kind) and (2 > i) and wide[i]:
+                    size = 2
+                values.append(int.from_bytes(self.data[pc:pc + size], "big"))
+                pc += size
+            if name in EXT_WIDE:
+                wide = EXT_WIDE[name]
+                continue
+            wide = (False, False)
+            yield (start - irep.iseq_start, name, values)
+
+    def _name(self, irep):
+        pending = {}
+        classes = {}
+        singleton = set()
+        for _, name, values in self.instructions(irep):
+            if name in ("METHOD", "LAMBDA", "BLOCK"):
+                if values[1] < len(irep.children):
+                    child = irep.children[values[1]]
+                    pending[values[0]] = child
+                    if "METHOD" != name:
+                        kind = "block" if "BLOCK" == name else "lambda"
+                        child.name = "%s in %s" % (kind, irep.name)
+                        child.context = irep.context
+            elif name in ("CLASS", "MODULE"):
+                classes[values[0]] = irep.syms[values[1]]
+            elif "SCLASS" == name:
+                singleton.add(values[0])
+            elif "EXEC" == name:
+                if values[1] < len(irep.children):
+                    child = irep.children[values[1]]
+                    cls = classes.get(values[0], "?")
+                    if "Object" != irep.context:
+                        cls = "%s::%s" % (irep.context, cls)
+                    child.name = "<class:%s>" % cls
+                    child.context = cls
+            elif "DEF" == name:
+                child = pending.get(values[0] + 1)
+                if child is not None:
+                    sep = "." if values[0] in singleton else "#"
+                    child.name = "%s%s%s" % (irep.context, sep,
+                                             irep.syms[values[1]])
+                    child.context = irep.context
+            elif name in ("MOVE", "LOADSELF", "TCLASS", "OCLASS"):
+                singleton.discard(values[0])
+        for child in irep.children:
+            if child.name is None:
+                child.name = "irep %d in %s" % (child.index, irep.name)
+            self._name(child)
+
+    def locate(self, offset):
+        """Gets (irep, pc) of a sampled program counter offset.
+
+        The program counter points after the instruction being run, or after
+        the send of the C method being run, so the sample is charged to the
+        instruction before it.
+        """
+        for irep in self.ireps:
+            if irep.iseq_start < offset <= irep.iseq_end:
+                pc = None
+                for start, _, _ in self.instructions(irep):
+                    if start >= offset - irep.iseq_start:
+                        break
+                    pc = start
+                return (irep, pc)
+            if irep.iseq_start == offset:
+                return (irep, 0)
+        return (None, None)
+
+
+def load_bytecode(path):
+    """Reads a .mrb file, or the byte array of a C source."""
+    with open(path, "rb") as file:
+        data = file.read()
+    if b"RITE" != data[0:4]:
+        text = data.decode(errors="replace")
+        body = text[text.find("{") + 1:text.rfind("}")]
+        data = bytes(int(value, 0) for value in
+                     re.findall(r"0[xX][0-9a-fA-F]+|\b\d+\b", body))
+    return Bytecode(data)
+
+
+def read_histogram(lines, merge):
+    """Reads the last (or all, if merge) histogram of a console log."""
+    result = None
+    current = None
+    for line in lines:
+        fields = line.split()
+        if (0 == len(fields)) or ("smp" != fields[0]):
+            index = line.find("smp ")
+            if 0 > index:
+                continue
+            fields = line[index:].split()
+        if (2 <= len(fields)) and ("begin" == fields[1]):
+            current = {"period_us": int(fields[2]), "samples": int(fields[3]),
+                       "other": int(fields[4]), "dropped": int(fields[5]),
+                       "counts": defaultdict(int)}
+        elif (2 <= len(fields)) and ("end" == fields[1]):
+            if current is None:
+                continue
+            if merge and (result is not None):
+                for key in ("samples", "other", "dropped"):
+                    result[key] += current[key]
+                for key, count in current["counts"].items():
+                    result["counts"][key] += count
+            else:
+                result = current
+            current = None
+        elif (current is not None) and (4 == len(fields)):
+            key = (int(fields[1]), int(fields[2]))
+            current["counts"][key] += int(fields[3])
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("log", nargs="?", help="console log (default: stdin)")
+    parser.add_argument("--slot1", help="bytecode of slot 1")
+    parser.add_argument("--slot2", help="bytecode of slot 2")
+    parser.add_argument("--lines", action="store_true",
+                        help="break the methods down by line")
+    parser.add_argument("--all", action="store_true",
+                        help="sum all histograms in the log, not the last")
+    args = parser.parse_args()
+
+    slots = {}
+    for number, path in ((1, args.slot1), (2, args.slot2)):
+        if path is not None:
+            slots[number] = load_bytecode(path)
+
+    if args.log is None:
+        histogram = read_histogram(sys.stdin, args.all)
+    else:
+        with open(args.log, encoding="utf-8", errors="replace") as file:
+            histogram = read_histogram(file, args.all)
+    if histogram is None:
+        sys.exit("no complete sampler histogram (smp begin ... smp end)")
+
+    totals = defaultdict(int)
+    for (slot, offset), count in histogram["counts"].items():
+        bytecode = slots.get(slot)
+        if bytecode is None:
+            key = ("slot%d" % slot, "offset %d" % offset)
+        else:
+            irep, pc = bytecode.locate(offset)
+            if irep is None:
+                key = ("slot%d" % slot, "offset %d" % offset)
+            else:
+                where = None if pc is None else irep.line(pc)
+                location = "-"
+                if (where is not None) and (where[1] is not None):
+                    location = "%s:%d" % where
+                key = ("slot%d %s" % (slot, irep.name),
+                       location if args.lines else "")
+        totals[key] += count
+
+    samples = histogram["samples"]
+    print("%d samples every %d us, %d without a slot task, %d dropped"
+          % (samples, histogram["period_us"], histogram["other"],
+             histogram["dropped"]))
+    print("%7s %8s  %s" % ("self%", "samples", "method"))
+    for key, count in sorted(totals.items(), key=lambda item: -item[1]):
+        share = (100.0 * count / samples) if (0 < samples) else 0.0
+        name = key[0] if "" == key[1] else "%s  %s" % key
+        print("%6.1f%% %8d  %s" % (share, count, name))
+
+
+if "__main__" == __name__:
+    main()